@@ -18,6 +18,46 @@ AggregateStrategy::~AggregateStrategy() {}
  */
 void AggregateStrategy::move(double seconds, AggregateObject &obj) {}
 
+/**
+ * Writes the state of obj's members after the given number of seconds
+ * into their slots of next, leaving obj itself untouched
+ */
+void AggregateStrategy::advance(double seconds, const AggregateObject &obj,
+                                BodyStore &next) {
+    std::for_each(obj.begin(), obj.end(), [&](Object* innerObj){
+        size_t first, last;
+        innerObj->getSlots(first, last);
+        next.set(first, innerObj->getPosition(), innerObj->getVelocity(),
+            innerObj->getMass());
+    });
+}
+
+/**
+ * Adds the force on obj's members times the given number of seconds,
+ * divided by their mass, to their velocities
+ */
+void AggregateStrategy::kick(double seconds, AggregateObject &obj) {}
+
+/**
+ * Moves obj's members by their velocity times the given number of
+ * seconds
+ */
+void AggregateStrategy::drift(double seconds, AggregateObject &obj) {}
+
+/**
+ * Writes force / mass for each of obj's members into the member's slot
+ * of ax and ay
+ */
+void AggregateStrategy::accelerate(const AggregateObject &obj,
+                                   std::vector<double> &ax,
+                                   std::vector<double> &ay) {
+    std::for_each(obj.begin(), obj.end(), [&](Object* innerObj){
+        size_t first, last;
+        innerObj->getSlots(first, last);
+        ax[first] = ay[first] = 0;
+    });
+}
+
 /**
  * Destructor
  */
@@ -35,10 +75,7 @@ AggregateStrategy* RigidStrategy::clone() {
  */
 void RigidStrategy::move(double seconds, AggregateObject &obj) {
     Universe* univ(Universe::instance());
-    vector2 totalForce;
-    std::for_each(univ->begin(), univ->end(), [&](Object* otherObj){
-        totalForce += Universe::getForce(obj, *otherObj);
-    });
+    vector2 totalForce = univ->getTotalForce(obj);
     vector2 accel = totalForce / obj.getMass();
     vector2 changeVel = accel * seconds;
     vector2 vel = obj.getVelocity() + changeVel;
@@ -47,6 +84,65 @@ void RigidStrategy::move(double seconds, AggregateObject &obj) {
     obj.setPosition(pos);
 }
 
+/**
+ * Writes the state of obj's members after the given number of seconds
+ * into their slots of next, leaving obj itself untouched
+ */
+void RigidStrategy::advance(double seconds, const AggregateObject &obj,
+                            BodyStore &next) {
+    Universe* univ(Universe::instance());
+    vector2 totalForce = univ->getTotalForce(obj);
+    vector2 changeVel = totalForce / obj.getMass() * seconds;
+    vector2 changePos = (obj.getVelocity() + changeVel) * seconds;
+    std::for_each(obj.begin(), obj.end(), [&](Object* innerObj){
+        size_t first, last;
+        innerObj->getSlots(first, last);
+        next.set(first, innerObj->getPosition() + changePos,
+            innerObj->getVelocity() + changeVel, innerObj->getMass());
+    });
+}
+
+/**
+ * Adds the force on obj's members times the given number of seconds,
+ * divided by their mass, to their velocities
+ */
+void RigidStrategy::kick(double seconds, AggregateObject &obj) {
+    Universe* univ(Universe::instance());
+    vector2 totalForce = univ->getTotalForce(obj);
+    vector2 changeVel = totalForce / obj.getMass() * seconds;
+    std::for_each(obj.begin(), obj.end(), [&](Object* innerObj){
+        innerObj->setVelocity(innerObj->getVelocity() + changeVel);
+    });
+}
+
+/**
+ * Moves obj's members by their velocity times the given number of
+ * seconds
+ */
+void RigidStrategy::drift(double seconds, AggregateObject &obj) {
+    vector2 changePos = obj.getVelocity() * seconds;
+    std::for_each(obj.begin(), obj.end(), [&](Object* innerObj){
+        innerObj->setPosition(innerObj->getPosition() + changePos);
+    });
+}
+
+/**
+ * Writes force / mass for each of obj's members into the member's slot
+ * of ax and ay
+ */
+void RigidStrategy::accelerate(const AggregateObject &obj,
+                               std::vector<double> &ax,
+                               std::vector<double> &ay) {
+    Universe* univ(Universe::instance());
+    vector2 accel = univ->getTotalForce(obj) / obj.getMass();
+    std::for_each(obj.begin(), obj.end(), [&](Object* innerObj){
+        size_t first, last;
+        innerObj->getSlots(first, last);
+        ax[first] = accel[0];
+        ay[first] = accel[1];
+    });
+}
+
 /**
  * Destructor
  */
@@ -65,15 +161,7 @@ AggregateStrategy* RealisticStrategy::clone() {
 void RealisticStrategy::move(double seconds, AggregateObject &obj) {
     Universe* univ(Universe::instance());
     std::for_each(obj.begin(), obj.end(), [&](Object* innerObj){
-        vector2 totalForce;
-        std::for_each(univ->begin(), univ->end(), [&](Object* otherObj){
-            if (*otherObj != obj) {
-                totalForce += Universe::getForce(*innerObj, *otherObj);
-            }
-        });
-        std::for_each(obj.begin(), obj.end(), [&](Object* innerObjSecond){
-            totalForce += Universe::getForce(*innerObj, *innerObjSecond);
-        });
+        vector2 totalForce = univ->getTotalForce(*innerObj);
         vector2 accel = totalForce / innerObj->getMass();
         vector2 changeVel = accel * seconds;
         vector2 vel = innerObj->getVelocity() + changeVel;
@@ -81,4 +169,63 @@ void RealisticStrategy::move(double seconds, AggregateObject &obj) {
         vector2 pos = innerObj->getPosition() + vel * seconds;
         innerObj->setPosition(pos);
     });
+}
+
+/**
+ * Writes the state of obj's members after the given number of seconds
+ * into their slots of next, leaving obj itself untouched
+ */
+void RealisticStrategy::advance(double seconds, const AggregateObject &obj,
+                                BodyStore &next) {
+    Universe* univ(Universe::instance());
+    std::for_each(obj.begin(), obj.end(), [&](Object* innerObj){
+        vector2 totalForce = univ->getTotalForce(*innerObj);
+        vector2 accel = totalForce / innerObj->getMass();
+        vector2 vel = innerObj->getVelocity() + accel * seconds;
+        vector2 pos = innerObj->getPosition() + vel * seconds;
+        size_t first, last;
+        innerObj->getSlots(first, last);
+        next.set(first, pos, vel, innerObj->getMass());
+    });
+}
+
+/**
+ * Adds the force on obj's members times the given number of seconds,
+ * divided by their mass, to their velocities
+ */
+void RealisticStrategy::kick(double seconds, AggregateObject &obj) {
+    Universe* univ(Universe::instance());
+    std::for_each(obj.begin(), obj.end(), [&](Object* innerObj){
+        vector2 totalForce = univ->getTotalForce(*innerObj);
+        vector2 accel = totalForce / innerObj->getMass();
+        innerObj->setVelocity(innerObj->getVelocity() + accel * seconds);
+    });
+}
+
+/**
+ * Moves obj's members by their velocity times the given number of
+ * seconds
+ */
+void RealisticStrategy::drift(double seconds, AggregateObject &obj) {
+    std::for_each(obj.begin(), obj.end(), [&](Object* innerObj){
+        innerObj->setPosition(innerObj->getPosition()
+            + innerObj->getVelocity() * seconds);
+    });
+}
+
+/**
+ * Writes force / mass for each of obj's members into the member's slot
+ * of ax and ay
+ */
+void RealisticStrategy::accelerate(const AggregateObject &obj,
+                                   std::vector<double> &ax,
+                                   std::vector<double> &ay) {
+    Universe* univ(Universe::instance());
+    std::for_each(obj.begin(), obj.end(), [&](Object* innerObj){
+        vector2 accel = univ->getTotalForce(*innerObj) / innerObj->getMass();
+        size_t first, last;
+        innerObj->getSlots(first, last);
+        ax[first] = accel[0];
+        ay[first] = accel[1];
+    });
 }
\ No newline at end of file
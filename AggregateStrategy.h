@@ -11,6 +11,7 @@
 
 #include <vector>
 #include "Vector.h"
+#include "BodyStore.h"
 #include "Universe.h"
 #include "Object.h"
 
@@ -36,6 +37,33 @@ public:
      */
     virtual void move(double seconds, AggregateObject &obj);
 
+    /**
+     * Writes the state of obj's members after the given number of seconds
+     * into their slots of next, leaving obj itself untouched
+     */
+    virtual void advance(double seconds, const AggregateObject &obj,
+                         BodyStore &next);
+
+    /**
+     * Adds the force on obj's members times the given number of seconds,
+     * divided by their mass, to their velocities
+     */
+    virtual void kick(double seconds, AggregateObject &obj);
+
+    /**
+     * Moves obj's members by their velocity times the given number of
+     * seconds
+     */
+    virtual void drift(double seconds, AggregateObject &obj);
+
+    /**
+     * Writes force / mass for each of obj's members into the member's slot
+     * of ax and ay
+     */
+    virtual void accelerate(const AggregateObject &obj,
+                            std::vector<double> &ax,
+                            std::vector<double> &ay);
+
 };
 
 class RigidStrategy : public AggregateStrategy {
@@ -56,6 +84,32 @@ public:
      */
     void move(double seconds, AggregateObject &obj);
 
+    /**
+     * Writes the state of obj's members after the given number of seconds
+     * into their slots of next, leaving obj itself untouched
+     */
+    void advance(double seconds, const AggregateObject &obj,
+                 BodyStore &next);
+
+    /**
+     * Adds the force on obj's members times the given number of seconds,
+     * divided by their mass, to their velocities
+     */
+    void kick(double seconds, AggregateObject &obj);
+
+    /**
+     * Moves obj's members by their velocity times the given number of
+     * seconds
+     */
+    void drift(double seconds, AggregateObject &obj);
+
+    /**
+     * Writes force / mass for each of obj's members into the member's slot
+     * of ax and ay
+     */
+    void accelerate(const AggregateObject &obj, std::vector<double> &ax,
+                    std::vector<double> &ay);
+
 };
 
 class RealisticStrategy : public AggregateStrategy {
@@ -76,6 +130,32 @@ public:
      */
     void move(double seconds, AggregateObject &obj);
 
+    /**
+     * Writes the state of obj's members after the given number of seconds
+     * into their slots of next, leaving obj itself untouched
+     */
+    void advance(double seconds, const AggregateObject &obj,
+                 BodyStore &next);
+
+    /**
+     * Adds the force on obj's members times the given number of seconds,
+     * divided by their mass, to their velocities
+     */
+    void kick(double seconds, AggregateObject &obj);
+
+    /**
+     * Moves obj's members by their velocity times the given number of
+     * seconds
+     */
+    void drift(double seconds, AggregateObject &obj);
+
+    /**
+     * Writes force / mass for each of obj's members into the member's slot
+     * of ax and ay
+     */
+    void accelerate(const AggregateObject &obj, std::vector<double> &ax,
+                    std::vector<double> &ay);
+
 };
 
 #endif
\ No newline at end of file
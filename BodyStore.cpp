@@ -0,0 +1,202 @@
+/**
+ * @file: BodyStore.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the BodyStore class and instantiates
+    it for 2 and 3 dimensions
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "BodyStore.h"
+#include "GravityKernel.h"
+#include "Universe.h"
+#include <algorithm>
+
+std::vector<double> BodyColumns<2>::* const BodyColumns<2>::POSITIONS[2] = {
+    &BodyColumns<2>::x, &BodyColumns<2>::y
+};
+
+std::vector<double> BodyColumns<2>::* const BodyColumns<2>::VELOCITIES[2] = {
+    &BodyColumns<2>::vx, &BodyColumns<2>::vy
+};
+
+std::vector<double> BodyColumns<3>::* const BodyColumns<3>::POSITIONS[3] = {
+    &BodyColumns<3>::x, &BodyColumns<3>::y, &BodyColumns<3>::z
+};
+
+std::vector<double> BodyColumns<3>::* const BodyColumns<3>::VELOCITIES[3] = {
+    &BodyColumns<3>::vx, &BodyColumns<3>::vy, &BodyColumns<3>::vz
+};
+
+/**
+ *  Returns the number of slots.
+ */
+template <size_t D>
+size_t BasicBodyStore<D>::size() const {
+    return mass.size();
+}
+
+/**
+ *  Resizes every array to n slots.
+ */
+template <size_t D>
+void BasicBodyStore<D>::resize(size_t n) {
+    for (size_t k = 0; k < D; ++k) {
+        position(k).resize(n);
+    }
+    for (size_t k = 0; k < D; ++k) {
+        velocity(k).resize(n);
+    }
+    mass.resize(n);
+}
+
+/**
+ *  Removes every slot.
+ */
+template <size_t D>
+void BasicBodyStore<D>::clear() {
+    resize(0);
+}
+
+/**
+ *  Exchanges the contents of the two stores without copying.
+ */
+template <size_t D>
+void BasicBodyStore<D>::swap(BasicBodyStore &other) {
+    for (size_t k = 0; k < D; ++k) {
+        position(k).swap(other.position(k));
+    }
+    for (size_t k = 0; k < D; ++k) {
+        velocity(k).swap(other.velocity(k));
+    }
+    mass.swap(other.mass);
+}
+
+/**
+ *  Writes a body into the slot, growing the arrays if needed.
+ */
+template <size_t D>
+void BasicBodyStore<D>::set(size_t slot, const vector &pos,
+                            const vector &vel, double m) {
+    if (slot >= size()) {
+        resize(slot + 1);
+    }
+    setPosition(slot, pos);
+    setVelocity(slot, vel);
+    mass[slot] = m;
+}
+
+/**
+ *  Returns the position stored in the slot.
+ */
+template <size_t D>
+typename BasicBodyStore<D>::vector BasicBodyStore<D>::getPosition(
+        size_t slot) const {
+    vector pos;
+    for (size_t k = 0; k < D; ++k) {
+        pos[k] = position(k)[slot];
+    }
+    return pos;
+}
+
+/**
+ *  Returns the velocity stored in the slot.
+ */
+template <size_t D>
+typename BasicBodyStore<D>::vector BasicBodyStore<D>::getVelocity(
+        size_t slot) const {
+    vector vel;
+    for (size_t k = 0; k < D; ++k) {
+        vel[k] = velocity(k)[slot];
+    }
+    return vel;
+}
+
+/**
+ *  Sets the position stored in the slot.
+ */
+template <size_t D>
+void BasicBodyStore<D>::setPosition(size_t slot, const vector &pos) {
+    for (size_t k = 0; k < D; ++k) {
+        position(k)[slot] = pos[k];
+    }
+}
+
+/**
+ *  Sets the velocity stored in the slot.
+ */
+template <size_t D>
+void BasicBodyStore<D>::setVelocity(size_t slot, const vector &vel) {
+    for (size_t k = 0; k < D; ++k) {
+        velocity(k)[slot] = vel[k];
+    }
+}
+
+/**
+ *  Returns the column of the given coordinate of the positions or of
+ *  the velocities.
+ */
+template <size_t D>
+std::vector<double>& BasicBodyStore<D>::position(size_t k) {
+    return this->*BodyColumns<D>::POSITIONS[k];
+}
+
+template <size_t D>
+const std::vector<double>& BasicBodyStore<D>::position(size_t k) const {
+    return this->*BodyColumns<D>::POSITIONS[k];
+}
+
+template <size_t D>
+std::vector<double>& BasicBodyStore<D>::velocity(size_t k) {
+    return this->*BodyColumns<D>::VELOCITIES[k];
+}
+
+template <size_t D>
+const std::vector<double>& BasicBodyStore<D>::velocity(size_t k) const {
+    return this->*BodyColumns<D>::VELOCITIES[k];
+}
+
+/**
+ *  Adds sum(m[j] * d / |d|^3) over the bodies j outside the slots
+ *  [first, last) to field, where d is the vector from p to body j.
+ *  Multiply by G and a mass at p to obtain the force on it.
+ */
+template <size_t D>
+void BasicBodyStore<D>::accumulate(const double *p, size_t first,
+                                   size_t last, double *field) const {
+    size_t n = size();
+    first = std::min(first, n);
+    last = std::max(first, std::min(last, n));
+    const double *before[D], *after[D];
+    for (size_t k = 0; k < D; ++k) {
+        before[k] = position(k).data();
+        after[k] = before[k] + last;
+    }
+    const double *m = mass.data();
+    GravityKernel::accumulate<D>(before, m, first, p, field);
+    GravityKernel::accumulate<D>(after, m + last, n - last, p, field);
+}
+
+/**
+ *  Advances every body by the double-buffered step, with the forces
+ *  of all pairs summed directly, using next as the back buffer. For a
+ *  store of mobile bodies, it matches the Universe's double-buffered
+ *  step with AllPairsStrategy bit for bit.
+ */
+template <size_t D>
+void BasicBodyStore<D>::step(double seconds, BasicBodyStore &next) {
+    next.resize(size());
+    for (size_t slot = 0; slot < size(); ++slot) {
+        vector pos = getPosition(slot), force;
+        double field[D] = {};
+        accumulate(&pos[0], slot, slot + 1, field);
+        for (size_t k = 0; k < D; ++k) {
+            force[k] = Universe::G * mass[slot] * field[k];
+        }
+        advance(slot, force / mass[slot], seconds, next);
+    }
+    swap(next);
+}
+
+template struct BasicBodyStore<2>;
+template struct BasicBodyStore<3>;
@@ -0,0 +1,193 @@
+/**
+ * @file: BodyStore.h
+ * @author Ethan Raymond
+ * @Description: This file declares the BodyStore class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef _BODY_STORE_H_
+#define _BODY_STORE_H_
+
+#include <vector>
+#include "Vector.h"
+
+/**
+ *  The named coordinate columns of a store in D dimensions, with tables
+ *  of them by coordinate for the code written for any D. Only 2 and 3
+ *  dimensions are defined.
+ */
+template <size_t D>
+struct BodyColumns;
+
+template <>
+struct BodyColumns<2> {
+
+    /**
+     *  Positions in meters.
+     */
+    std::vector<double> x, y;
+
+    /**
+     *  Velocities in meters/second.
+     */
+    std::vector<double> vx, vy;
+
+    /**
+     *  The position and the velocity columns, by coordinate.
+     */
+    static std::vector<double> BodyColumns::* const POSITIONS[2];
+    static std::vector<double> BodyColumns::* const VELOCITIES[2];
+
+};
+
+template <>
+struct BodyColumns<3> {
+
+    /**
+     *  Positions in meters.
+     */
+    std::vector<double> x, y, z;
+
+    /**
+     *  Velocities in meters/second.
+     */
+    std::vector<double> vx, vy, vz;
+
+    /**
+     *  The position and the velocity columns, by coordinate.
+     */
+    static std::vector<double> BodyColumns::* const POSITIONS[3];
+    static std::vector<double> BodyColumns::* const VELOCITIES[3];
+
+};
+
+/**
+ *  Structure-of-arrays storage for point masses in D dimensions. Every
+ *  ImmobileObject and SimpleObject registered with the Universe, including
+ *  the members of aggregates, owns one slot of its 2D store, BodyStore.
+ *  The objects read and write their state through their slot, while the
+ *  force loops walk the arrays directly. The arrays are public on purpose
+ *  so that hot loops can take their data().
+ *
+ *  The field sum and the double-buffered step of a body are written once
+ *  for any D: the Universe runs their 2D instantiation, and step() runs
+ *  them for a bare store of any dimension. Only BasicBodyStore<2> and
+ *  BasicBodyStore<3> are instantiated.
+ */
+template <size_t D>
+struct BasicBodyStore : BodyColumns<D> {
+
+    /**
+     *  Coordinates of a body.
+     */
+    typedef Vector<D> vector;
+
+    /**
+     *  Returns the number of slots.
+     */
+    size_t size() const;
+
+    /**
+     *  Resizes every array to n slots.
+     */
+    void resize(size_t n);
+
+    /**
+     *  Removes every slot.
+     */
+    void clear();
+
+    /**
+     *  Exchanges the contents of the two stores without copying.
+     */
+    void swap(BasicBodyStore &other);
+
+    /**
+     *  Writes a body into the slot, growing the arrays if needed.
+     */
+    void set(size_t slot, const vector &pos, const vector &vel, double m);
+
+    /**
+     *  Returns the position stored in the slot.
+     */
+    vector getPosition(size_t slot) const;
+
+    /**
+     *  Returns the velocity stored in the slot.
+     */
+    vector getVelocity(size_t slot) const;
+
+    /**
+     *  Sets the position stored in the slot.
+     */
+    void setPosition(size_t slot, const vector &pos);
+
+    /**
+     *  Sets the velocity stored in the slot.
+     */
+    void setVelocity(size_t slot, const vector &vel);
+
+    /**
+     *  Returns the column of the given coordinate of the positions or of
+     *  the velocities.
+     */
+    std::vector<double>& position(size_t k);
+    const std::vector<double>& position(size_t k) const;
+    std::vector<double>& velocity(size_t k);
+    const std::vector<double>& velocity(size_t k) const;
+
+    /**
+     *  Adds sum(m[j] * d / |d|^3) over the bodies j outside the slots
+     *  [first, last) to field, where d is the vector from p to body j.
+     *  Multiply by G and a mass at p to obtain the force on it.
+     */
+    void accumulate(const double *p, size_t first, size_t last,
+                    double *field) const;
+
+    /**
+     *  Writes the body in the slot into the same slot of next, kicked by
+     *  accel times seconds and then drifted by its new velocity times
+     *  seconds: one body of the double-buffered step.
+     */
+    void advance(size_t slot, const vector &accel, double seconds,
+                 BasicBodyStore &next) const;
+
+    /**
+     *  Advances every body by the double-buffered step, with the forces
+     *  of all pairs summed directly, using next as the back buffer. For a
+     *  store of mobile bodies, it matches the Universe's double-buffered
+     *  step with AllPairsStrategy bit for bit.
+     */
+    void step(double seconds, BasicBodyStore &next);
+
+    /**
+     *  Masses in kilograms.
+     */
+    std::vector<double> mass;
+
+};
+
+/**
+ *  Writes the body in the slot into the same slot of next, kicked by
+ *  accel times seconds and then drifted by its new velocity times
+ *  seconds: one body of the double-buffered step.
+ */
+template <size_t D>
+inline void BasicBodyStore<D>::advance(size_t slot, const vector &accel,
+                                       double seconds,
+                                       BasicBodyStore &next) const {
+    vector vel = getVelocity(slot) + accel * seconds;
+    vector pos = getPosition(slot) + vel * seconds;
+    next.set(slot, pos, vel, mass[slot]);
+}
+
+extern template struct BasicBodyStore<2>;
+extern template struct BasicBodyStore<3>;
+
+/**
+ *  The store of the Universe.
+ */
+typedef BasicBodyStore<2> BodyStore;
+
+#endif
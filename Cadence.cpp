@@ -0,0 +1,47 @@
+/**
+ * @file: Cadence.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the Cadence class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "Cadence.h"
+#include <cmath>
+
+/**
+ *  Creates a cadence outputting every steps-th step and, if seconds is
+ *  positive, at most one step per that many simulated seconds.
+ */
+Cadence::Cadence(uint64_t steps, double seconds) :
+    every_(steps > 0 ? steps : 1), seconds_(seconds > 0 ? seconds : 0),
+    next_(-INFINITY), steps_(0), due_(0) {}
+
+/**
+ *  Counts a step that brought the simulated time to time, and returns
+ *  true if it is due.
+ */
+bool Cadence::due(double time) {
+    if (++steps_ % every_ != 0) {
+        return false;
+    }
+    if (seconds_ > 0) {
+        if (time < next_) {
+            return false;
+        }
+        next_ = (std::floor(time / seconds_) + 1) * seconds_;
+    }
+    ++due_;
+    return true;
+}
+
+/**
+ *  Returns the number of steps counted, and of the steps due.
+ */
+uint64_t Cadence::getStepCount() const {
+    return steps_;
+}
+
+uint64_t Cadence::getDueCount() const {
+    return due_;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file: Cadence.h
+ * @author Ethan Raymond
+ * @Description: This file declares the Cadence class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef _CADENCE_H_
+#define _CADENCE_H_
+
+#include <cstdint>
+
+/**
+ *  Decides which steps of a run are output, so that a long run can be
+ *  drawn or recorded at a fraction of its steps. A step is due when its
+ *  number is a multiple of the step interval and, if a time interval is
+ *  set, when the simulated time has reached the next multiple of that
+ *  interval. Time marks are multiples of the interval rather than offsets
+ *  from the first step, so a run resumed from a checkpoint keeps the same
+ *  grid. The default cadence outputs every step.
+ */
+class Cadence {
+public:
+
+    /**
+     *  Creates a cadence outputting every steps-th step and, if seconds is
+     *  positive, at most one step per that many simulated seconds.
+     */
+    explicit Cadence(uint64_t steps = 1, double seconds = 0);
+
+    /**
+     *  Counts a step that brought the simulated time to time, and returns
+     *  true if it is due.
+     */
+    bool due(double time);
+
+    /**
+     *  Returns the number of steps counted, and of the steps due.
+     */
+    uint64_t getStepCount() const;
+    uint64_t getDueCount() const;
+
+private:
+
+    /**
+     *  Step interval and time interval, 0 for none.
+     */
+    uint64_t every_;
+    double seconds_;
+
+    /**
+     *  Simulated time of the next time mark.
+     */
+    double next_;
+
+    /**
+     *  Steps counted, and steps due.
+     */
+    uint64_t steps_, due_;
+
+};
+
+#endif
@@ -0,0 +1,432 @@
+/**
+ * @file: Checkpoint.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the Checkpoint class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "Checkpoint.h"
+#include "Universe.h"
+#include "Object.h"
+#include "Visitor.h"
+#include "AggregateStrategy.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ *  "UCKP" read as a little-endian uint32.
+ */
+const uint32_t MAGIC = 0x504b4355;
+
+/**
+ *  Version of the file layout.
+ */
+const uint32_t VERSION = 1;
+
+/**
+ *  Deepest nesting of aggregates a checkpoint may hold.
+ */
+const int MAX_DEPTH = 1000;
+
+/**
+ *  Object types of the tree records.
+ */
+enum Type { IMMOBILE, SIMPLE, AGGREGATE };
+
+/**
+ *  Start of a checkpoint file.
+ */
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    double time;
+    uint64_t objects;
+    uint64_t records;
+    uint64_t bodies;
+    uint64_t hash;
+};
+
+static_assert(sizeof(Header) == 48, "Header must not be padded");
+
+/**
+ *  Returns the 64-bit FNV-1a hash of [data, data + size).
+ */
+uint64_t hash(const char *data, size_t size) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        h = (h ^ uint8_t(data[i])) * 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ *  Appends raw bytes to buffer.
+ */
+void put(std::vector<char> &buffer, const void *data, size_t size) {
+    const char *bytes = static_cast<const char*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+/**
+ *  A visitor that appends the tree records of the visited objects to a
+ *  buffer.
+ */
+class TreeEncoder : public Visitor {
+public:
+
+    /**
+     *  Creates an encoder appending to buffer.
+     */
+    TreeEncoder(std::vector<char> &buffer) : buffer_(buffer), records_(0) {}
+
+    /**
+     *  Appends an immobile record.
+     */
+    void visit(ImmobileObject &object) {
+        record(IMMOBILE, 0, object);
+    }
+
+    /**
+     *  Appends a simple record.
+     */
+    void visit(SimpleObject &object) {
+        record(SIMPLE, 0, object);
+    }
+
+    /**
+     *  Appends an aggregate record followed by its members.
+     */
+    void visit(AggregateObject &object) {
+        bool realistic =
+            dynamic_cast<RealisticStrategy*>(object.getStrategy()) != nullptr;
+        record(AGGREGATE, realistic, object);
+        uint32_t members = object.end() - object.begin();
+        put(buffer_, &members, sizeof(members));
+        std::for_each(object.begin(), object.end(), [&](Object* obj){
+            obj->accept(*this);
+        });
+    }
+
+    /**
+     *  Returns the number of records appended.
+     */
+    uint64_t getRecords() const {
+        return records_;
+    }
+
+private:
+
+    /**
+     *  Appends the fields every record starts with.
+     */
+    void record(uint8_t type, uint8_t strategy, const Object &object) {
+        const std::string &name = object.getName();
+        uint32_t length = name.size();
+        put(buffer_, &type, sizeof(type));
+        put(buffer_, &strategy, sizeof(strategy));
+        put(buffer_, &length, sizeof(length));
+        put(buffer_, name.data(), length);
+        ++records_;
+    }
+
+    std::vector<char> &buffer_;
+    uint64_t records_;
+
+};
+
+/**
+ *  Rebuilds objects from the tree records and body columns of a
+ *  checkpoint. Throws std::runtime_error on malformed input.
+ */
+class TreeDecoder {
+public:
+
+    /**
+     *  Creates a decoder for the records in [tree, columns) and the bodies
+     *  columns that follow them.
+     */
+    TreeDecoder(const char *tree, const char *columns, uint64_t bodies) :
+        p_(tree), end_(columns), columns_(columns), bodies_(bodies),
+        body_(0), records_(0) {}
+
+    /**
+     *  Returns the next object, with its members if it is an aggregate.
+     */
+    Object* read(int depth = 0) {
+        uint8_t type = get<uint8_t>();
+        uint8_t strategy = get<uint8_t>();
+        uint32_t length = get<uint32_t>();
+        if (size_t(end_ - p_) < length) {
+            fail();
+        }
+        std::string name(p_, length);
+        p_ += length;
+        ++records_;
+
+        if (type == IMMOBILE || type == SIMPLE) {
+            if (body_ == bodies_) {
+                fail();
+            }
+            vector2 pos, vel;
+            pos[0] = value(0);
+            pos[1] = value(1);
+            vel[0] = value(2);
+            vel[1] = value(3);
+            double mass = value(4);
+            ++body_;
+            if (type == IMMOBILE) {
+                return new ImmobileObject(name, mass, pos);
+            }
+            return new SimpleObject(name, mass, pos, vel);
+        }
+
+        uint32_t count = get<uint32_t>();
+        if (type != AGGREGATE || strategy > 1 || count == 0
+                || depth == MAX_DEPTH) {
+            fail();
+        }
+        std::vector<Object*> members;
+        try {
+            for (uint32_t i = 0; i < count; ++i) {
+                members.push_back(read(depth + 1));
+            }
+        } catch (...) {
+            std::for_each(members.begin(), members.end(),
+                std::default_delete<Object>());
+            throw;
+        }
+        AggregateObject* aggregate = new AggregateObject(name, members);
+        if (strategy == 1) {
+            aggregate->setAggregateStrategy(new RealisticStrategy());
+        }
+        return aggregate;
+    }
+
+    /**
+     *  Returns true if every record and body has been read.
+     */
+    bool done() const {
+        return p_ == end_ && body_ == bodies_;
+    }
+
+    /**
+     *  Returns the number of records read.
+     */
+    uint64_t getRecords() const {
+        return records_;
+    }
+
+    /**
+     *  Throws the error for malformed input.
+     */
+    static void fail() {
+        throw std::runtime_error("corrupt checkpoint");
+    }
+
+private:
+
+    /**
+     *  Reads a T from the tree.
+     */
+    template <typename T>
+    T get() {
+        T value;
+        if (size_t(end_ - p_) < sizeof(value)) {
+            fail();
+        }
+        std::memcpy(&value, p_, sizeof(value));
+        p_ += sizeof(value);
+        return value;
+    }
+
+    /**
+     *  Returns the current body's entry of the given column.
+     */
+    double value(size_t column) const {
+        double value;
+        std::memcpy(&value, columns_ + (column * bodies_ + body_)
+            * sizeof(double), sizeof(double));
+        return value;
+    }
+
+    const char *p_;
+    const char *end_;
+    const char *columns_;
+    uint64_t bodies_;
+    uint64_t body_;
+    uint64_t records_;
+
+};
+
+}
+
+/**
+ *  Creates a checkpoint with no write pending.
+ */
+Checkpoint::Checkpoint() {}
+
+/**
+ *  Waits for the pending write, ignoring its outcome.
+ */
+Checkpoint::~Checkpoint() {
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+/**
+ *  Encodes the universe's current state and writes it to filename on a
+ *  background thread, returning once the state is encoded. The file is
+ *  written next to filename and renamed over it when complete, so a
+ *  crash never leaves a partial checkpoint behind. Waits for the
+ *  previous write first, rethrowing its failure.
+ */
+void Checkpoint::save(const Universe &universe,
+                      const std::string &filename) {
+    wait();
+    buffer_.assign(sizeof(Header), 0);
+    TreeEncoder encoder(buffer_);
+    std::for_each(universe.begin(), universe.end(), [&](Object* obj){
+        obj->accept(encoder);
+    });
+    const BodyStore &bodies = universe.getBodies();
+    const std::vector<double> *columns[] = {&bodies.x, &bodies.y,
+        &bodies.vx, &bodies.vy, &bodies.mass};
+    std::for_each(columns, columns + 5, [&](const std::vector<double> *c){
+        put(buffer_, c->data(), bodies.size() * sizeof(double));
+    });
+
+    // The hash is filled in by the writing thread.
+    Header header = {MAGIC, VERSION, universe.getTime(),
+                     uint64_t(universe.end() - universe.begin()),
+                     encoder.getRecords(), bodies.size(), 0};
+    std::memcpy(buffer_.data(), &header, sizeof(header));
+    filename_ = filename;
+    thread_ = std::thread(&Checkpoint::write, this);
+}
+
+/**
+ *  Waits for the pending write. Throws std::runtime_error if it failed.
+ */
+void Checkpoint::wait() {
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (!error_.empty()) {
+        std::string error;
+        error.swap(error_);
+        throw std::runtime_error(error);
+    }
+}
+
+/**
+ *  Reads the checkpoint in filename into new, unregistered objects and
+ *  returns its simulated time. Throws std::runtime_error if the file
+ *  cannot be read or is not a valid checkpoint, in which case objects
+ *  is left unchanged.
+ */
+double Checkpoint::load(const std::string &filename,
+                        std::vector<Object*> &objects) {
+    std::vector<char> data;
+    FILE *file = std::fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        throw std::runtime_error(filename + ": " + std::strerror(errno));
+    }
+    char chunk[65536];
+    for (size_t n; (n = std::fread(chunk, 1, sizeof(chunk), file)) > 0; ) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    bool failed = std::ferror(file) != 0;
+    std::fclose(file);
+    if (failed) {
+        throw std::runtime_error(filename + ": read failed");
+    }
+
+    Header header;
+    if (data.size() < sizeof(header)) {
+        throw std::runtime_error(filename + ": not a checkpoint");
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != MAGIC) {
+        throw std::runtime_error(filename + ": not a checkpoint");
+    }
+    if (header.version != VERSION) {
+        throw std::runtime_error(filename + ": unsupported version "
+            + std::to_string(header.version));
+    }
+    size_t size = data.size() - sizeof(header);
+    const char *tree = data.data() + sizeof(header);
+    if (hash(tree, size) != header.hash
+            || header.bodies > size / (5 * sizeof(double))) {
+        throw std::runtime_error(filename + ": corrupt checkpoint");
+    }
+
+    const char *columns = data.data() + data.size()
+        - header.bodies * 5 * sizeof(double);
+    TreeDecoder decoder(tree, columns, header.bodies);
+    std::vector<Object*> loaded;
+    try {
+        for (uint64_t i = 0; i < header.objects; ++i) {
+            loaded.push_back(decoder.read());
+        }
+        if (!decoder.done() || decoder.getRecords() != header.records) {
+            TreeDecoder::fail();
+        }
+    } catch (const std::runtime_error &e) {
+        std::for_each(loaded.begin(), loaded.end(),
+            std::default_delete<Object>());
+        throw std::runtime_error(filename + ": " + e.what());
+    }
+    objects.insert(objects.end(), loaded.begin(), loaded.end());
+    return header.time;
+}
+
+/**
+ *  Writes buffer_ to filename_ and records any failure in error_. Runs
+ *  on thread_.
+ */
+void Checkpoint::write() {
+    uint64_t h = hash(buffer_.data() + sizeof(Header),
+        buffer_.size() - sizeof(Header));
+    std::memcpy(buffer_.data() + offsetof(Header, hash), &h, sizeof(h));
+
+    std::string temporary = filename_ + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = fd >= 0;
+    for (size_t done = 0; ok && done < buffer_.size(); ) {
+        ssize_t n = ::write(fd, buffer_.data() + done, buffer_.size() - done);
+        if (n > 0) {
+            done += n;
+        } else if (n < 0 && errno != EINTR) {
+            ok = false;
+        }
+    }
+    if (ok) {
+        PROFILE_COUNT(BYTES_WRITTEN, buffer_.size());
+    }
+    ok = ok && fsync(fd) == 0;
+    int error = errno;
+    if (fd >= 0 && close(fd) != 0 && ok) {
+        ok = false;
+        error = errno;
+    }
+    if (ok && std::rename(temporary.c_str(), filename_.c_str()) != 0) {
+        ok = false;
+        error = errno;
+    }
+    if (!ok) {
+        error_ = filename_ + ": " + std::strerror(error);
+        unlink(temporary.c_str());
+    }
+}
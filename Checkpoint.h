@@ -0,0 +1,110 @@
+/**
+ * @file: Checkpoint.h
+ * @author Ethan Raymond
+ * @Description: This file declares the Checkpoint class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Forward declaration
+class Object;
+class Universe;
+
+/**
+ *  Saves the Universe's objects to a binary file on a background thread,
+ *  and loads them back. Numbers are stored as their raw bits, so a loaded
+ *  Universe continues the saved trajectory exactly. Values are written in
+ *  the host's byte order, like FrameWriter's.
+ *
+ *  A file holds a header, the object tree and the bodies:
+ *
+ *  The header is the magic "UCKP", the uint32 version (1), the simulated
+ *  time as a double, the uint64 counts of top-level objects, of tree
+ *  records and of bodies, and the uint64 FNV-1a hash of everything after
+ *  the header.
+ *
+ *  The tree lists the objects depth first. Each record is the type as a
+ *  uint8 (0 immobile, 1 simple, 2 aggregate), the aggregate strategy as a
+ *  uint8 (0 rigid, 1 realistic, 0 for the other types), the name length as
+ *  a uint32 and the name; aggregates follow it with their member count as
+ *  a uint32 and then their members.
+ *
+ *  The bodies are the x, y, vx, vy and mass columns of the BodyStore, one
+ *  double per body each, in the order the immobile and simple objects
+ *  appear in the tree.
+ */
+class Checkpoint {
+public:
+
+    /**
+     *  Creates a checkpoint with no write pending.
+     */
+    Checkpoint();
+
+    /**
+     *  Waits for the pending write, ignoring its outcome.
+     */
+    ~Checkpoint();
+
+    /**
+     *  Encodes the universe's current state and writes it to filename on a
+     *  background thread, returning once the state is encoded. The file is
+     *  written next to filename and renamed over it when complete, so a
+     *  crash never leaves a partial checkpoint behind. Waits for the
+     *  previous write first, rethrowing its failure.
+     */
+    void save(const Universe &universe, const std::string &filename);
+
+    /**
+     *  Waits for the pending write. Throws std::runtime_error if it failed.
+     */
+    void wait();
+
+    /**
+     *  Reads the checkpoint in filename into new, unregistered objects and
+     *  returns its simulated time. Throws std::runtime_error if the file
+     *  cannot be read or is not a valid checkpoint, in which case objects
+     *  is left unchanged.
+     */
+    static double load(const std::string &filename,
+                       std::vector<Object*> &objects);
+
+private:
+
+    /**
+     *  Writes buffer_ to filename_ and records any failure in error_. Runs
+     *  on thread_.
+     */
+    void write();
+
+    /**
+     *  Thread running the pending write, if any.
+     */
+    std::thread thread_;
+
+    /**
+     *  Encoded checkpoint, reused between saves.
+     */
+    std::vector<char> buffer_;
+
+    /**
+     *  File the pending write goes to.
+     */
+    std::string filename_;
+
+    /**
+     *  Failure of the last write, empty if it succeeded.
+     */
+    std::string error_;
+
+};
+
+#endif
@@ -0,0 +1,506 @@
+/**
+ * @file: FmmTree.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the FmmTree used by the fast multipole
+    force strategy
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "FmmTree.h"
+#include "GravityKernel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+/**
+ *  Deepest level of the tree; cell coordinates must fit in 32 bits.
+ */
+const int MAX_DEPTH = 20;
+
+/**
+ *  Cells within this many columns and rows of each other are neighbors.
+ */
+const int64_t SEPARATION = 2;
+
+/**
+ *  Number of columns of interaction offsets, which span twice the
+ *  separation plus one on each side.
+ */
+const int64_t SPAN = 4 * SEPARATION + 3;
+
+/**
+ *  Spreads the low 32 bits of v to the even bits of the result.
+ */
+uint64_t spread(uint64_t v) {
+    v &= 0xffffffffULL;
+    v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+    v = (v | (v << 8)) & 0x00ff00ff00ff00ffULL;
+    v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    v = (v | (v << 2)) & 0x3333333333333333ULL;
+    v = (v | (v << 1)) & 0x5555555555555555ULL;
+    return v;
+}
+
+/**
+ *  Gathers the even bits of v into the low 32 bits of the result.
+ */
+uint64_t compact(uint64_t v) {
+    v &= 0x5555555555555555ULL;
+    v = (v | (v >> 1)) & 0x3333333333333333ULL;
+    v = (v | (v >> 2)) & 0x0f0f0f0f0f0f0f0fULL;
+    v = (v | (v >> 4)) & 0x00ff00ff00ff00ffULL;
+    v = (v | (v >> 8)) & 0x0000ffff0000ffffULL;
+    v = (v | (v >> 16)) & 0x00000000ffffffffULL;
+    return v;
+}
+
+/**
+ *  Returns the Morton key of the cell at column ix and row iy.
+ */
+uint64_t interleave(uint64_t ix, uint64_t iy) {
+    return spread(ix) | (spread(iy) << 1);
+}
+
+/**
+ *  Sets px and py to the powers 0 through order of x and y.
+ */
+void powers(double x, double y, int order, double *px, double *py) {
+    px[0] = py[0] = 1;
+    for (int i = 1; i <= order; ++i) {
+        px[i] = px[i - 1] * x;
+        py[i] = py[i - 1] * y;
+    }
+}
+
+}
+
+/**
+ *  Creates an empty tree with expansions of the given order.
+ */
+FmmTree::FmmTree(int order) : minX_(0), minY_(0), side_(1) {
+    setOrder(order);
+}
+
+/**
+ *  Destroys the tree.
+ */
+FmmTree::~FmmTree() {}
+
+/**
+ *  Returns the order of the expansions.
+ */
+int FmmTree::getOrder() const {
+    return order_;
+}
+
+/**
+ *  Sets the order of the expansions, from 0 to MAX_ORDER.
+ */
+void FmmTree::setOrder(int order) {
+    order_ = std::min(std::max(order, 0), int(MAX_ORDER));
+    int p = order_;
+    terms_ = (p + 1) * (p + 2) / 2;
+
+    // Coefficients are ordered by total degree, then by the power of y.
+    index_.assign((p + 1) * (p + 1), -1);
+    powerX_.resize(terms_);
+    powerY_.resize(terms_);
+    for (int degree = 0; degree <= p; ++degree) {
+        for (int b = 0; b <= degree; ++b) {
+            int i = degree * (degree + 1) / 2 + b;
+            index_[(degree - b) * (p + 1) + b] = i;
+            powerX_[i] = degree - b;
+            powerY_[i] = b;
+        }
+    }
+
+    binomial_.assign((p + 1) * (p + 1), 0);
+    for (int n = 0; n <= p; ++n) {
+        binomial_[n * (p + 1)] = 1;
+        for (int k = 1; k <= n; ++k) {
+            binomial_[n * (p + 1) + k] = binomial_[(n - 1) * (p + 1) + k - 1]
+                + (k < n ? binomial_[(n - 1) * (p + 1) + k] : 0);
+        }
+    }
+
+    // local[n] = (-1)^|n| sum over k of (k + n)! / (k! n!) multipole[k]
+    // taylor[k + n], keeping |k| + |n| up to the order.
+    translation_.clear();
+    for (int n = 0; n < terms_; ++n) {
+        for (int k = 0; k < terms_; ++k) {
+            int a = powerX_[n] + powerX_[k];
+            int b = powerY_[n] + powerY_[k];
+            if (a + b > p) {
+                continue;
+            }
+            double sign = (powerX_[n] + powerY_[n]) % 2 == 0 ? 1 : -1;
+            Term term = {n, k, index_[a * (p + 1) + b], sign
+                * binomial_[a * (p + 1) + powerX_[n]]
+                * binomial_[b * (p + 1) + powerY_[n]]};
+            translation_.push_back(term);
+        }
+    }
+}
+
+/**
+ *  Discards the previous contents and computes the field at every body
+ *  of the store.
+ */
+void FmmTree::build(const BodyStore &bodies) {
+    size_t n = bodies.size();
+    ax_.assign(n, 0);
+    ay_.assign(n, 0);
+    levels_.clear();
+    if (n == 0) {
+        return;
+    }
+
+    const double *x = bodies.x.data();
+    const double *y = bodies.y.data();
+    double minX = x[0], minY = y[0], maxX = x[0], maxY = y[0];
+    for (size_t i = 1; i < n; ++i) {
+        minX = std::min(minX, x[i]);
+        maxX = std::max(maxX, x[i]);
+        minY = std::min(minY, y[i]);
+        maxY = std::max(maxY, y[i]);
+    }
+    // Pad the root slightly so bodies on the boundary fall inside it.
+    side_ = std::max(maxX - minX, maxY - minY) * (1 + 1e-9) + 1;
+    minX_ = minX;
+    minY_ = minY;
+
+    int depth = 2;
+    while (depth < MAX_DEPTH && (size_t(1) << 2 * depth) * LEAF_SIZE < n) {
+        ++depth;
+    }
+    uint64_t cells = uint64_t(1) << depth;
+    keys_.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t ix = std::min<uint64_t>(cells - 1,
+            uint64_t((x[i] - minX_) / side_ * cells));
+        uint64_t iy = std::min<uint64_t>(cells - 1,
+            uint64_t((y[i] - minY_) / side_ * cells));
+        keys_[i] = std::make_pair(interleave(ix, iy), i);
+    }
+    std::sort(keys_.begin(), keys_.end());
+
+    x_.resize(n);
+    y_.resize(n);
+    m_.resize(n);
+    slot_.resize(n);
+    levels_.resize(depth + 1);
+    Level &leaves = levels_[depth];
+    for (size_t i = 0; i < n; ++i) {
+        size_t s = keys_[i].second;
+        x_[i] = (x[s] - minX_) / side_;
+        y_[i] = (y[s] - minY_) / side_;
+        m_[i] = bodies.mass[s];
+        slot_[i] = s;
+        if (i == 0 || keys_[i].first != keys_[i - 1].first) {
+            leaves.key.push_back(keys_[i].first);
+            leaves.first.push_back(i);
+            leaves.last.push_back(i);
+        }
+        ++leaves.last.back();
+    }
+
+    // Parents group consecutive children sharing all but the last two bits.
+    for (int l = depth - 1; l >= 0; --l) {
+        Level &parents = levels_[l];
+        const Level &children = levels_[l + 1];
+        for (size_t c = 0; c < children.key.size(); ++c) {
+            uint64_t key = children.key[c] >> 2;
+            if (parents.key.empty() || parents.key.back() != key) {
+                parents.key.push_back(key);
+                parents.first.push_back(children.first[c]);
+                parents.last.push_back(children.last[c]);
+                parents.child.push_back(c);
+            }
+            parents.last.back() = children.last[c];
+        }
+        parents.child.push_back(children.key.size());
+    }
+    for (int l = 0; l <= depth; ++l) {
+        levels_[l].multipole.assign(levels_[l].key.size() * terms_, 0);
+        levels_[l].local.assign(levels_[l].key.size() * terms_, 0);
+    }
+
+    upward();
+    downward();
+    evaluate();
+}
+
+/**
+ *  Sets ax and ay to the field at the body in the slot, left out of its
+ *  own sum together with any other body at the same position.
+ */
+void FmmTree::getField(size_t slot, double &ax, double &ay) const {
+    ax = ax_[slot];
+    ay = ay_[slot];
+}
+
+/**
+ *  Returns the number of occupied cells.
+ */
+size_t FmmTree::size() const {
+    size_t cells = 0;
+    std::for_each(levels_.begin(), levels_.end(), [&](const Level &level){
+        cells += level.key.size();
+    });
+    return cells;
+}
+
+/**
+ *  Returns the index of the cell with the given key in the level, or
+ *  -1 if it is not occupied.
+ */
+long FmmTree::find(const Level &level, uint64_t key) const {
+    std::vector<uint64_t>::const_iterator i =
+        std::lower_bound(level.key.begin(), level.key.end(), key);
+    if (i == level.key.end() || *i != key) {
+        return -1;
+    }
+    return i - level.key.begin();
+}
+
+/**
+ *  Sets cx and cy to the center of the cell with the given key at the
+ *  level.
+ */
+void FmmTree::center(int level, uint64_t key, double &cx, double &cy) const {
+    double width = 1.0 / (uint64_t(1) << level);
+    cx = (compact(key) + 0.5) * width;
+    cy = (compact(key >> 1) + 0.5) * width;
+}
+
+/**
+ *  Sets out to the Taylor coefficients (-1)^|k| / k! d^k (1 / |r|) of
+ *  the inverse distance at r = (x, y), for every |k| up to the order.
+ */
+void FmmTree::taylor(double x, double y, double *out) const {
+    // With n = |k|: n r^2 c(k) = (2n - 1) (x c(k - e1) + y c(k - e2))
+    //                           - (n - 1) (c(k - 2 e1) + c(k - 2 e2)).
+    int p = order_;
+    double distSq = x * x + y * y;
+    out[0] = 1 / std::sqrt(distSq);
+    for (int degree = 1; degree <= p; ++degree) {
+        for (int b = 0; b <= degree; ++b) {
+            int a = degree - b;
+            double first = 0, second = 0;
+            if (a >= 1) {
+                first += x * out[index_[(a - 1) * (p + 1) + b]];
+            }
+            if (b >= 1) {
+                first += y * out[index_[a * (p + 1) + b - 1]];
+            }
+            if (a >= 2) {
+                second += out[index_[(a - 2) * (p + 1) + b]];
+            }
+            if (b >= 2) {
+                second += out[index_[a * (p + 1) + b - 2]];
+            }
+            out[index_[a * (p + 1) + b]] = ((2 * degree - 1) * first
+                - (degree - 1) * second) / (degree * distSq);
+        }
+    }
+}
+
+/**
+ *  Forms the leaves' multipole expansions and passes them up the tree.
+ */
+void FmmTree::upward() {
+    int p = order_, depth = levels_.size() - 1;
+    std::vector<double> px(p + 1), py(p + 1);
+
+    Level &leaves = levels_[depth];
+    for (size_t c = 0; c < leaves.key.size(); ++c) {
+        double cx, cy;
+        center(depth, leaves.key[c], cx, cy);
+        double *multipole = &leaves.multipole[c * terms_];
+        for (size_t i = leaves.first[c]; i < leaves.last[c]; ++i) {
+            powers(x_[i] - cx, y_[i] - cy, p, px.data(), py.data());
+            for (int k = 0; k < terms_; ++k) {
+                multipole[k] += m_[i] * px[powerX_[k]] * py[powerY_[k]];
+            }
+        }
+    }
+
+    // Shifting the center by d turns (s - c')^l into sum over k >= l of
+    // k! / (l! (k - l)!) d^(k - l) (s - c)^l.
+    for (int l = depth - 1; l >= 0; --l) {
+        Level &parents = levels_[l];
+        const Level &children = levels_[l + 1];
+        for (size_t c = 0; c < parents.key.size(); ++c) {
+            double cx, cy;
+            center(l, parents.key[c], cx, cy);
+            double *multipole = &parents.multipole[c * terms_];
+            for (size_t h = parents.child[c]; h < parents.child[c + 1]; ++h) {
+                double hx, hy;
+                center(l + 1, children.key[h], hx, hy);
+                powers(hx - cx, hy - cy, p, px.data(), py.data());
+                const double *from = &children.multipole[h * terms_];
+                for (int k = 0; k < terms_; ++k) {
+                    int a = powerX_[k], b = powerY_[k];
+                    double sum = 0;
+                    for (int i = 0; i <= a; ++i) {
+                        for (int j = 0; j <= b; ++j) {
+                            sum += binomial_[a * (p + 1) + i]
+                                * binomial_[b * (p + 1) + j] * px[a - i]
+                                * py[b - j] * from[index_[i * (p + 1) + j]];
+                        }
+                    }
+                    multipole[k] += sum;
+                }
+            }
+        }
+    }
+}
+
+/**
+ *  Translates the well-separated cells' expansions into local ones and
+ *  passes them down the tree.
+ */
+void FmmTree::downward() {
+    int p = order_, depth = levels_.size() - 1;
+    std::vector<double> px(p + 1), py(p + 1), table(SPAN * SPAN * terms_);
+    for (int l = 2; l <= depth; ++l) {
+        Level &level = levels_[l];
+        const Level &parents = levels_[l - 1];
+        int64_t cells = int64_t(1) << l;
+        double width = 1.0 / cells;
+
+        // Cells only interact with cells a few columns or rows away, so the
+        // Taylor coefficients take SPAN * SPAN distinct offsets per level.
+        int64_t reach = SPAN / 2;
+        for (int64_t ox = -reach; ox <= reach; ++ox) {
+            for (int64_t oy = -reach; oy <= reach; ++oy) {
+                if (std::abs(ox) > SEPARATION || std::abs(oy) > SEPARATION) {
+                    taylor(ox * width, oy * width,
+                        &table[((ox + reach) * SPAN + oy + reach) * terms_]);
+                }
+            }
+        }
+
+        size_t parent = 0;
+        for (size_t c = 0; c < level.key.size(); ++c) {
+            double *local = &level.local[c * terms_];
+            while (parents.child[parent + 1] <= c) {
+                ++parent;
+            }
+
+            // Shifting the center by d turns (t - c)^n into sum over l <= n
+            // of n! / (l! (n - l)!) d^(n - l) (t - c')^l.
+            if (l > 2) {
+                double cx, cy, hx, hy;
+                center(l - 1, parents.key[parent], cx, cy);
+                center(l, level.key[c], hx, hy);
+                powers(hx - cx, hy - cy, p, px.data(), py.data());
+                const double *from = &parents.local[parent * terms_];
+                for (int k = 0; k < terms_; ++k) {
+                    int a = powerX_[k], b = powerY_[k];
+                    double sum = 0;
+                    for (int i = a; i <= p; ++i) {
+                        for (int j = b; i + j <= p; ++j) {
+                            sum += binomial_[i * (p + 1) + a]
+                                * binomial_[j * (p + 1) + b] * px[i - a]
+                                * py[j - b] * from[index_[i * (p + 1) + j]];
+                        }
+                    }
+                    local[k] += sum;
+                }
+            }
+
+            // The interaction list: children of the parent's neighbors that
+            // are not neighbors themselves.
+            int64_t ix = compact(level.key[c]), iy = compact(level.key[c] >> 1);
+            int64_t fromX = std::max<int64_t>(ix / 2 - SEPARATION, 0) * 2;
+            int64_t toX = std::min(ix / 2 + SEPARATION + 1, cells / 2) * 2;
+            int64_t fromY = std::max<int64_t>(iy / 2 - SEPARATION, 0) * 2;
+            int64_t toY = std::min(iy / 2 + SEPARATION + 1, cells / 2) * 2;
+            for (int64_t sx = fromX; sx < toX; ++sx) {
+                for (int64_t sy = fromY; sy < toY; ++sy) {
+                    if (std::abs(sx - ix) <= SEPARATION
+                            && std::abs(sy - iy) <= SEPARATION) {
+                        continue;
+                    }
+                    long s = find(level, interleave(sx, sy));
+                    if (s < 0) {
+                        continue;
+                    }
+                    const double *multipole = &level.multipole[s * terms_];
+                    const double *coefficients =
+                        &table[((ix - sx + reach) * SPAN + iy - sy + reach)
+                               * terms_];
+                    std::for_each(translation_.begin(), translation_.end(),
+                        [&](const Term &term){
+                            local[term.n] += term.scale
+                                * multipole[term.k] * coefficients[term.kn];
+                        });
+                }
+            }
+        }
+    }
+}
+
+/**
+ *  Evaluates the leaves' local expansions and near fields at their
+ *  bodies.
+ */
+void FmmTree::evaluate() {
+    int p = order_, depth = levels_.size() - 1;
+    const Level &leaves = levels_[depth];
+    int64_t cells = int64_t(1) << depth;
+    double scale = 1 / (side_ * side_);
+    std::vector<double> px(p + 1), py(p + 1);
+    std::vector<long> near;
+    for (size_t c = 0; c < leaves.key.size(); ++c) {
+        double cx, cy;
+        center(depth, leaves.key[c], cx, cy);
+        const double *local = &leaves.local[c * terms_];
+        int64_t ix = compact(leaves.key[c]);
+        int64_t iy = compact(leaves.key[c] >> 1);
+        near.clear();
+        size_t nearBodies = 0;
+        for (int64_t sx = std::max<int64_t>(ix - SEPARATION, 0);
+                sx <= std::min(ix + SEPARATION, cells - 1); ++sx) {
+            for (int64_t sy = std::max<int64_t>(iy - SEPARATION, 0);
+                    sy <= std::min(iy + SEPARATION, cells - 1); ++sy) {
+                long s = find(leaves, interleave(sx, sy));
+                if (s >= 0) {
+                    near.push_back(s);
+                    nearBodies += leaves.last[s] - leaves.first[s];
+                }
+            }
+        }
+
+        for (size_t i = leaves.first[c]; i < leaves.last[c]; ++i) {
+            // The field is the gradient of sum(local[n] (t - c)^n).
+            powers(x_[i] - cx, y_[i] - cy, p, px.data(), py.data());
+            double ax = 0, ay = 0;
+            for (int k = 1; k < terms_; ++k) {
+                int a = powerX_[k], b = powerY_[k];
+                if (a > 0) {
+                    ax += local[k] * a * px[a - 1] * py[b];
+                }
+                if (b > 0) {
+                    ay += local[k] * b * px[a] * py[b - 1];
+                }
+            }
+            std::for_each(near.begin(), near.end(), [&](long s){
+                size_t first = leaves.first[s];
+                GravityKernel::accumulate(&x_[first], &y_[first], &m_[first],
+                    leaves.last[s] - first, x_[i], y_[i], ax, ay);
+            });
+            ax_[slot_[i]] = ax * scale;
+            ay_[slot_[i]] = ay * scale;
+        }
+        // Each body meets every other body of the near cells, its own
+        // included.
+        PROFILE_COUNT(PAIRS,
+            (leaves.last[c] - leaves.first[c]) * (nearBodies - 1));
+    }
+}
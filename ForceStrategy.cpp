@@ -0,0 +1,576 @@
+/**
+ * @file: ForceStrategy.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the force strategy classes
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "ForceStrategy.h"
+#include "Universe.h"
+#include "GravityKernel.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Destructor
+ */
+ForceStrategy::~ForceStrategy() {}
+
+/**
+ * Called once per step with the bodies in their pre-step state
+ */
+void ForceStrategy::prepare(const BodyStore &bodies) {}
+
+/**
+ * Called instead of prepare() when only the given number of bodies
+ * will be queried, e.g. the active bodies of a block time step.
+ * Calls prepare() unless overridden.
+ */
+void ForceStrategy::prepareFor(const BodyStore &bodies, size_t targets) {
+    prepare(bodies);
+}
+
+/**
+ * Sets the slots [first[a], last[a]) of each aggregate of the store
+ * passed to prepare(), in increasing order. Ignored unless
+ * overridden. The Universe calls it whenever its layout changes.
+ */
+void ForceStrategy::setAggregates(const std::vector<size_t> &first,
+                                  const std::vector<size_t> &last) {}
+
+/**
+ * Lends the strategy a pool to run its own work on, or takes it back
+ * when null. The Universe lends its pool so that a step runs on one
+ * set of threads. Ignored unless overridden.
+ */
+void ForceStrategy::setThreadPool(ThreadPool *pool) {}
+
+/**
+ * Constructor
+ */
+AllPairsStrategy::AllPairsStrategy() : bodies_(nullptr), direct_(false) {}
+
+/**
+ * Destructor
+ */
+AllPairsStrategy::~AllPairsStrategy() {}
+
+/**
+ * Remembers the bodies to sum over
+ */
+void AllPairsStrategy::prepare(const BodyStore &bodies) {
+    bodies_ = &bodies;
+    direct_ = false;
+}
+
+/**
+ * Remembers the bodies and sums the queries directly when there are
+ * fewer targets than getBreakEven(), skipping a subclass's prepare();
+ * calls prepare() otherwise
+ */
+void AllPairsStrategy::prepareFor(const BodyStore &bodies, size_t targets) {
+    if (targets < getBreakEven(bodies.size())) {
+        bodies_ = &bodies;
+        direct_ = true;
+    } else {
+        prepare(bodies);
+    }
+}
+
+/**
+ * Returns the number of targets below which summing their forces
+ * directly costs less than prepare() over the given number of bodies
+ */
+size_t AllPairsStrategy::getBreakEven(size_t bodies) const {
+    return 0;
+}
+
+/**
+ * Returns the force on a point of the given mass at pos from every body
+ * outside the slots [first, last). Bodies at pos exert no force.
+ */
+vector2 AllPairsStrategy::getForce(const vector2 &pos, double mass,
+                                   size_t first, size_t last) const {
+    size_t n = bodies_->size();
+    size_t begin = std::min(first, n);
+    size_t end = std::max(begin, std::min(last, n));
+    PROFILE_COUNT(PAIRS, n - (end - begin));
+    double field[2] = {0, 0};
+    bodies_->accumulate(&pos[0], first, last, field);
+    vector2 totalForce;
+    totalForce[0] = Universe::G * mass * field[0];
+    totalForce[1] = Universe::G * mass * field[1];
+    return totalForce;
+}
+
+namespace {
+
+/**
+ * Number of parts the pairs are split into
+ */
+const size_t PARTS = 16;
+
+}
+
+/**
+ * Creates a strategy summing the pairs on the given number of threads,
+ * 0 meaning hardware threads, unless it is lent a pool
+ */
+SymmetricPairsStrategy::SymmetricPairsStrategy(size_t threads) :
+    threads_(threads), pool_(nullptr), ownPool_(nullptr) {}
+
+/**
+ * Destructor
+ */
+SymmetricPairsStrategy::~SymmetricPairsStrategy() {
+    delete ownPool_;
+}
+
+/**
+ * Sums the pairs on the given pool, or on a pool of its own when null
+ */
+void SymmetricPairsStrategy::setThreadPool(ThreadPool *pool) {
+    pool_ = pool;
+    if (pool_ != nullptr) {
+        delete ownPool_;
+        ownPool_ = nullptr;
+    }
+}
+
+/**
+ * Sums the pull of every pair of bodies into each body's total
+ */
+void SymmetricPairsStrategy::prepare(const BodyStore &bodies) {
+    AllPairsStrategy::prepare(bodies);
+    ThreadPool *pool = pool_;
+    if (pool == nullptr) {
+        if (ownPool_ == nullptr) {
+            ownPool_ = new ThreadPool(threads_);
+        }
+        pool = ownPool_;
+    }
+
+    // Rows before r hold r * n - r * (r + 1) / 2 pairs, about n^2 / 2 times
+    // 1 - (1 - r / n)^2, so equal shares of pairs start at these rows.
+    size_t n = bodies.size();
+    size_t parts = std::max<size_t>(1, std::min(PARTS, n / 64));
+    rows_.resize(parts + 1);
+    for (size_t p = 0; p < parts; ++p) {
+        rows_[p] = n - size_t(std::sqrt(1 - double(p) / parts) * n);
+    }
+    rows_[0] = 0;
+    rows_[parts] = n;
+    partX_.resize(parts);
+    partY_.resize(parts);
+
+    auto sum = [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p) {
+            sumPart(p);
+        }
+    };
+    pool->parallelFor(parts, 1, sum);
+
+    ax_.resize(n);
+    ay_.resize(n);
+    auto reduce = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            double sx = 0, sy = 0;
+            for (size_t p = 0; p < parts && rows_[p] <= i; ++p) {
+                sx += partX_[p][i];
+                sy += partY_[p][i];
+            }
+            ax_[i] = sx;
+            ay_[i] = sy;
+        }
+    };
+    pool->parallelFor(n, 4096, reduce);
+}
+
+/**
+ * Returns the force on a point of the given mass at pos from every body
+ * outside the slots [first, last). Bodies at pos exert no force.
+ */
+vector2 SymmetricPairsStrategy::getForce(const vector2 &pos, double mass,
+                                         size_t first, size_t last) const {
+    if (direct_ || last != first + 1 || first >= ax_.size()
+            || bodies_->x[first] != pos[0] || bodies_->y[first] != pos[1]) {
+        return AllPairsStrategy::getForce(pos, mass, first, last);
+    }
+    vector2 totalForce;
+    totalForce[0] = Universe::G * mass * ax_[first];
+    totalForce[1] = Universe::G * mass * ay_[first];
+    return totalForce;
+}
+
+/**
+ * Returns half the bodies: prepare() sums all N^2 / 2 pairs, the cost
+ * of summing N / 2 targets directly
+ */
+size_t SymmetricPairsStrategy::getBreakEven(size_t bodies) const {
+    return bodies / 2;
+}
+
+/**
+ * Sums the pairs of the part's rows into the part's accumulators
+ */
+void SymmetricPairsStrategy::sumPart(size_t part) {
+    const double *x = bodies_->x.data();
+    const double *y = bodies_->y.data();
+    const double *m = bodies_->mass.data();
+    size_t n = bodies_->size();
+    std::vector<double> &sx = partX_[part];
+    std::vector<double> &sy = partY_[part];
+    sx.resize(n);
+    sy.resize(n);
+    std::fill(sx.begin() + rows_[part], sx.end(), 0);
+    std::fill(sy.begin() + rows_[part], sy.end(), 0);
+    for (size_t i = rows_[part]; i < rows_[part + 1]; ++i) {
+        double ax = 0, ay = 0;
+        GravityKernel::scatter(x + i + 1, y + i + 1, m + i + 1, n - i - 1,
+            x[i], y[i], m[i], ax, ay, sx.data() + i + 1, sy.data() + i + 1);
+        sx[i] += ax;
+        sy[i] += ay;
+    }
+    size_t a = rows_[part], b = rows_[part + 1];
+    PROFILE_COUNT(PAIRS, (b - a) * (2 * n - a - b - 1) / 2);
+}
+
+/**
+ * Creates a strategy with expansions of the given order
+ */
+FastMultipoleStrategy::FastMultipoleStrategy(int order) : tree_(order) {}
+
+/**
+ * Destructor
+ */
+FastMultipoleStrategy::~FastMultipoleStrategy() {}
+
+/**
+ * Returns the order of the expansions
+ */
+int FastMultipoleStrategy::getOrder() const {
+    return tree_.getOrder();
+}
+
+/**
+ * Sets the order of the expansions, from 0 to FmmTree::MAX_ORDER
+ */
+void FastMultipoleStrategy::setOrder(int order) {
+    tree_.setOrder(order);
+}
+
+/**
+ * Computes the field at every body
+ */
+void FastMultipoleStrategy::prepare(const BodyStore &bodies) {
+    AllPairsStrategy::prepare(bodies);
+    tree_.build(bodies);
+}
+
+/**
+ * Returns the force on a point of the given mass at pos from every body
+ * outside the slots [first, last). Bodies at pos exert no force.
+ */
+vector2 FastMultipoleStrategy::getForce(const vector2 &pos, double mass,
+                                        size_t first, size_t last) const {
+    if (direct_ || last != first + 1 || first >= bodies_->size()
+            || bodies_->x[first] != pos[0] || bodies_->y[first] != pos[1]) {
+        return AllPairsStrategy::getForce(pos, mass, first, last);
+    }
+    double ax, ay;
+    tree_.getField(first, ax, ay);
+    vector2 totalForce;
+    totalForce[0] = Universe::G * mass * ax;
+    totalForce[1] = Universe::G * mass * ay;
+    return totalForce;
+}
+
+/**
+ * Returns 1024, about what building the tree costs in direct sums at
+ * the default order
+ */
+size_t FastMultipoleStrategy::getBreakEven(size_t bodies) const {
+    return 1024;
+}
+
+/**
+ * Creates a strategy with the given distance threshold
+ */
+FarFieldStrategy::FarFieldStrategy(double theta) : theta_(theta) {}
+
+/**
+ * Destructor
+ */
+FarFieldStrategy::~FarFieldStrategy() {}
+
+/**
+ * Returns the distance threshold
+ */
+double FarFieldStrategy::getTheta() const {
+    return theta_;
+}
+
+/**
+ * Sets the distance threshold
+ */
+void FarFieldStrategy::setTheta(double theta) {
+    theta_ = theta;
+}
+
+/**
+ * Sets the slots [first[a], last[a]) of each aggregate of the store
+ * passed to prepare(), in increasing order
+ */
+void FarFieldStrategy::setAggregates(const std::vector<size_t> &first,
+                                     const std::vector<size_t> &last) {
+    aggregateFirst_ = first;
+    aggregateLast_ = last;
+}
+
+/**
+ * Finds the aggregates' centers of mass and builds the tree over them
+ */
+void FarFieldStrategy::prepare(const BodyStore &bodies) {
+    AllPairsStrategy::prepare(bodies);
+    runFirst_.clear();
+    runLast_.clear();
+    first_.clear();
+    last_.clear();
+    nodes_.clear();
+
+    // The slots between the aggregates form the runs.
+    size_t n = bodies.size(), end = 0;
+    for (size_t a = 0; a < aggregateFirst_.size(); ++a) {
+        if (aggregateLast_[a] > n) {
+            break;
+        }
+        if (aggregateFirst_[a] > end) {
+            runFirst_.push_back(end);
+            runLast_.push_back(aggregateFirst_[a]);
+        }
+        first_.push_back(aggregateFirst_[a]);
+        last_.push_back(aggregateLast_[a]);
+        end = aggregateLast_[a];
+    }
+    if (end < n) {
+        runFirst_.push_back(end);
+        runLast_.push_back(n);
+    }
+
+    const double *x = bodies.x.data();
+    const double *y = bodies.y.data();
+    const double *m = bodies.mass.data();
+    size_t count = first_.size();
+    x_.assign(count, 0);
+    y_.assign(count, 0);
+    m_.assign(count, 0);
+    radiusSq_.assign(count, 0);
+    leaf_.assign(count, -1);
+    order_.clear();
+    for (size_t a = 0; a < count; ++a) {
+        for (size_t i = first_[a]; i < last_[a]; ++i) {
+            x_[a] += m[i] * x[i];
+            y_[a] += m[i] * y[i];
+            m_[a] += m[i];
+        }
+        if (m_[a] == 0) {
+            // Massless aggregates exert no force.
+            continue;
+        }
+        x_[a] /= m_[a];
+        y_[a] /= m_[a];
+        for (size_t i = first_[a]; i < last_[a]; ++i) {
+            double dx = x[i] - x_[a], dy = y[i] - y_[a];
+            radiusSq_[a] = std::max(radiusSq_[a], dx * dx + dy * dy);
+        }
+        order_.push_back(a);
+    }
+    if (!order_.empty()) {
+        nodes_.reserve(2 * order_.size());
+        build(0, order_.size());
+    }
+}
+
+/**
+ * Returns the force on a point of the given mass at pos from every body
+ * outside the slots [first, last). Bodies at pos exert no force.
+ */
+vector2 FarFieldStrategy::getForce(const vector2 &pos, double mass,
+                                   size_t first, size_t last) const {
+    if (direct_) {
+        return AllPairsStrategy::getForce(pos, mass, first, last);
+    }
+    const double *x = bodies_->x.data();
+    const double *y = bodies_->y.data();
+    const double *m = bodies_->mass.data();
+    // Find the aggregate holding the queried slots, if any. Queries that
+    // straddle aggregates are summed directly.
+    int own = -1;
+    size_t a = std::upper_bound(first_.begin(), first_.end(), first)
+        - first_.begin();
+    if (a > 0 && first < last_[a - 1]) {
+        if (last > last_[a - 1]) {
+            return AllPairsStrategy::getForce(pos, mass, first, last);
+        }
+        own = leaf_[a - 1];
+    } else if (a < first_.size() && first_[a] < last) {
+        return AllPairsStrategy::getForce(pos, mass, first, last);
+    }
+
+    double ax = 0, ay = 0;
+    uint64_t pairs = 0;
+    auto direct = [&](size_t lo, size_t hi) {
+        size_t cut = std::max(lo, std::min(first, hi));
+        size_t resume = std::min(hi, std::max(last, cut));
+        pairs += (cut - lo) + (hi - resume);
+        GravityKernel::accumulate(x + lo, y + lo, m + lo, cut - lo, pos[0],
+                                  pos[1], ax, ay);
+        GravityKernel::accumulate(x + resume, y + resume, m + resume,
+                                  hi - resume, pos[0], pos[1], ax, ay);
+    };
+    for (size_t r = 0; r < runFirst_.size(); ++r) {
+        direct(runFirst_[r], runLast_[r]);
+    }
+    if (nodes_.empty()) {
+        PROFILE_COUNT(PAIRS, pairs);
+        vector2 totalForce;
+        totalForce[0] = Universe::G * mass * ax;
+        totalForce[1] = Universe::G * mass * ay;
+        return totalForce;
+    }
+
+    // A node that is far enough stands in for its subtree, which is then
+    // skipped; any other node is opened by moving on to its first child.
+    double thetaSq = theta_ * theta_;
+    for (int i = 0; i < int(nodes_.size()); ) {
+        const Node &node = nodes_[i];
+        double dx = node.x - pos[0], dy = node.y - pos[1];
+        double distSq = dx * dx + dy * dy;
+        bool holds = i <= own && own < node.skip;
+        if (!holds && node.radiusSq < thetaSq * distSq) {
+            double inv = node.mass / (distSq * std::sqrt(distSq));
+            ax += dx * inv;
+            ay += dy * inv;
+            ++pairs;
+            i = node.skip;
+        } else if (node.aggregate >= 0) {
+            direct(first_[node.aggregate], last_[node.aggregate]);
+            i = node.skip;
+        } else {
+            ++i;
+        }
+    }
+    PROFILE_COUNT(PAIRS, pairs);
+    vector2 totalForce;
+    totalForce[0] = Universe::G * mass * ax;
+    totalForce[1] = Universe::G * mass * ay;
+    return totalForce;
+}
+
+/**
+ * Returns 4, about what finding the aggregates costs in direct sums
+ */
+size_t FarFieldStrategy::getBreakEven(size_t bodies) const {
+    return 4;
+}
+
+/**
+ * Appends the subtree over order_[begin, end) to nodes_
+ */
+void FarFieldStrategy::build(size_t begin, size_t end) {
+    size_t index = nodes_.size();
+    double cx = 0, cy = 0, mass = 0;
+    double minX = x_[order_[begin]], maxX = minX;
+    double minY = y_[order_[begin]], maxY = minY;
+    for (size_t i = begin; i < end; ++i) {
+        size_t a = order_[i];
+        cx += m_[a] * x_[a];
+        cy += m_[a] * y_[a];
+        mass += m_[a];
+        minX = std::min(minX, x_[a]);
+        maxX = std::max(maxX, x_[a]);
+        minY = std::min(minY, y_[a]);
+        maxY = std::max(maxY, y_[a]);
+    }
+    cx /= mass;
+    cy /= mass;
+
+    // Every body of an aggregate is within its radius of its center, so
+    // within that plus the center's distance of the node's.
+    double radius = 0;
+    for (size_t i = begin; i < end; ++i) {
+        size_t a = order_[i];
+        radius = std::max(radius, std::hypot(x_[a] - cx, y_[a] - cy)
+            + std::sqrt(radiusSq_[a]));
+    }
+    Node node = {cx, cy, mass, radius * radius, 0, -1};
+    nodes_.push_back(node);
+    if (end - begin == 1) {
+        nodes_[index].aggregate = order_[begin];
+        leaf_[order_[begin]] = index;
+    } else {
+        // Split at the median along the wider side of the centers' box.
+        size_t middle = begin + (end - begin) / 2;
+        bool alongX = maxX - minX >= maxY - minY;
+        std::nth_element(order_.begin() + begin, order_.begin() + middle,
+            order_.begin() + end, [&](size_t a, size_t b){
+                return alongX ? x_[a] < x_[b] : y_[a] < y_[b];
+            });
+        build(begin, middle);
+        build(middle, end);
+    }
+    nodes_[index].skip = nodes_.size();
+}
+
+/**
+ * Creates a strategy with the given opening angle
+ */
+BarnesHutStrategy::BarnesHutStrategy(double theta) : theta_(theta) {}
+
+/**
+ * Destructor
+ */
+BarnesHutStrategy::~BarnesHutStrategy() {}
+
+/**
+ * Returns the opening angle
+ */
+double BarnesHutStrategy::getTheta() const {
+    return theta_;
+}
+
+/**
+ * Sets the opening angle
+ */
+void BarnesHutStrategy::setTheta(double theta) {
+    theta_ = theta;
+}
+
+/**
+ * Rebuilds the quadtree over the bodies
+ */
+void BarnesHutStrategy::prepare(const BodyStore &bodies) {
+    AllPairsStrategy::prepare(bodies);
+    tree_.build(bodies);
+}
+
+/**
+ * Returns the force on a point of the given mass at pos from every body
+ * outside the slots [first, last). Bodies at pos exert no force.
+ */
+vector2 BarnesHutStrategy::getForce(const vector2 &pos, double mass,
+                                    size_t first, size_t last) const {
+    if (direct_) {
+        return AllPairsStrategy::getForce(pos, mass, first, last);
+    }
+    return tree_.getForce(pos, mass, first, last, theta_);
+}
+
+/**
+ * Returns 128, about what building the tree costs in direct sums
+ */
+size_t BarnesHutStrategy::getBreakEven(size_t bodies) const {
+    return 128;
+}
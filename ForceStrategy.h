@@ -0,0 +1,469 @@
+/**
+ * @file: ForceStrategy.h
+ * @author Ethan Raymond
+ * @Description: This file declares the force strategy classes
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef _FORCE_STRATEGY_H_
+#define _FORCE_STRATEGY_H_
+
+#include "Vector.h"
+#include "BodyStore.h"
+#include "QuadTree.h"
+#include "FmmTree.h"
+#include "ThreadPool.h"
+#include <vector>
+
+/**
+ *  Computes the net gravitational force the bodies of a BodyStore exert on a
+ *  point mass. The Universe calls prepare() with its store once at the start
+ *  of every step, before any object is moved, and the movers then query
+ *  getForce() for each object.
+ */
+class ForceStrategy {
+public:
+
+    /**
+     * Destructor
+     */
+    virtual ~ForceStrategy() = 0;
+
+    /**
+     * Called once per step with the bodies in their pre-step state
+     */
+    virtual void prepare(const BodyStore &bodies);
+
+    /**
+     * Called instead of prepare() when only the given number of bodies
+     * will be queried, e.g. the active bodies of a block time step.
+     * Calls prepare() unless overridden.
+     */
+    virtual void prepareFor(const BodyStore &bodies, size_t targets);
+
+    /**
+     * Sets the slots [first[a], last[a]) of each aggregate of the store
+     * passed to prepare(), in increasing order. Ignored unless
+     * overridden. The Universe calls it whenever its layout changes.
+     */
+    virtual void setAggregates(const std::vector<size_t> &first,
+                               const std::vector<size_t> &last);
+
+    /**
+     * Lends the strategy a pool to run its own work on, or takes it back
+     * when null. The Universe lends its pool so that a step runs on one
+     * set of threads. Ignored unless overridden.
+     */
+    virtual void setThreadPool(ThreadPool *pool);
+
+    /**
+     * Returns the force on a point of the given mass at pos from every body
+     * outside the slots [first, last). Bodies at pos exert no force.
+     */
+    virtual vector2 getForce(const vector2 &pos, double mass, size_t first,
+                             size_t last) const = 0;
+
+};
+
+/**
+ *  Sums the force of every body directly from the store's arrays. This is
+ *  exact and costs O(N) per object, O(N^2) per step. The sums run through
+ *  GravityKernel, which uses the widest vector unit the CPU has.
+ */
+class AllPairsStrategy : public ForceStrategy {
+public:
+
+    /**
+     * Constructor
+     */
+    AllPairsStrategy();
+
+    /**
+     * Destructor
+     */
+    ~AllPairsStrategy();
+
+    /**
+     * Remembers the bodies to sum over
+     */
+    void prepare(const BodyStore &bodies);
+
+    /**
+     * Remembers the bodies and sums the queries directly when there are
+     * fewer targets than getBreakEven(), skipping a subclass's prepare();
+     * calls prepare() otherwise
+     */
+    void prepareFor(const BodyStore &bodies, size_t targets);
+
+    /**
+     * Returns the force on a point of the given mass at pos from every body
+     * outside the slots [first, last). Bodies at pos exert no force.
+     */
+    vector2 getForce(const vector2 &pos, double mass, size_t first,
+                     size_t last) const;
+
+protected:
+
+    /**
+     * Returns the number of targets below which summing their forces
+     * directly costs less than prepare() over the given number of bodies
+     */
+    virtual size_t getBreakEven(size_t bodies) const;
+
+    /**
+     * The bodies passed to the last prepare()
+     */
+    const BodyStore *bodies_;
+
+    /**
+     * True if the last preparation was prepareFor() a few targets, whose
+     * queries a subclass's getForce() must then sum directly
+     */
+    bool direct_;
+
+};
+
+/**
+ *  Evaluates each unordered pair of bodies once per step, by Newton's third
+ *  law: prepare() adds the pull of body j to body i's sum and the opposite
+ *  pull, scaled by the masses, to body j's, which halves the square roots
+ *  and divisions of AllPairsStrategy. getForce() then answers queries for
+ *  a single body at its own position, as simple objects and the members of
+ *  realistic aggregates make, from those sums; any other query, such as a
+ *  rigid aggregate taken as a point mass at its center, is summed directly.
+ *
+ *  The pairs are split into a fixed number of parts of about equal size,
+ *  each summed by one thread into its own accumulators, which are then
+ *  added up in part order. The result is the same for every thread count
+ *  but differs from AllPairsStrategy's by rounding. The immobile sun is an
+ *  ordinary body here: its pull on every other body is counted once per
+ *  pair, and the pull on it is summed but never read, so it stays put.
+ */
+class SymmetricPairsStrategy : public AllPairsStrategy {
+public:
+
+    /**
+     * Creates a strategy summing the pairs on the given number of threads,
+     * 0 meaning hardware threads, unless it is lent a pool
+     */
+    explicit SymmetricPairsStrategy(size_t threads = 0);
+
+    /**
+     * Destructor
+     */
+    ~SymmetricPairsStrategy();
+
+    /**
+     * Sums the pairs on the given pool, or on a pool of its own when null
+     */
+    void setThreadPool(ThreadPool *pool);
+
+    /**
+     * Sums the pull of every pair of bodies into each body's total
+     */
+    void prepare(const BodyStore &bodies);
+
+    /**
+     * Returns the force on a point of the given mass at pos from every body
+     * outside the slots [first, last). Bodies at pos exert no force.
+     */
+    vector2 getForce(const vector2 &pos, double mass, size_t first,
+                     size_t last) const;
+
+protected:
+
+    /**
+     * Returns half the bodies: prepare() sums all N^2 / 2 pairs, the cost
+     * of summing N / 2 targets directly
+     */
+    size_t getBreakEven(size_t bodies) const;
+
+private:
+
+    /**
+     * Sums the pairs of the part's rows into the part's accumulators
+     */
+    void sumPart(size_t part);
+
+    /**
+     * Number of threads of its own pool, 0 meaning hardware threads
+     */
+    size_t threads_;
+
+    /**
+     * Lent pool, and its own pool, created on first use without one
+     */
+    ThreadPool *pool_, *ownPool_;
+
+    /**
+     * First row of each part, followed by the number of bodies. Row i
+     * holds the pairs of body i with the bodies after it.
+     */
+    std::vector<size_t> rows_;
+
+    /**
+     * Per-part accumulators. A part only writes the bodies from its first
+     * row on.
+     */
+    std::vector<std::vector<double> > partX_, partY_;
+
+    /**
+     * sum(m[j] * d / |d|^3) over every other body j, for each body
+     */
+    std::vector<double> ax_, ay_;
+
+};
+
+/**
+ *  Computes the field at every body with the fast multipole method of
+ *  FmmTree in prepare(), in O(N) time for a given order, and answers
+ *  queries for a single body at its own position from it like
+ *  SymmetricPairsStrategy; any other query is summed directly. The error
+ *  falls geometrically with the order: at the default order of 8 the
+ *  field at each body of a sun and 20k orbiting bodies differs from the
+ *  all-pairs one by about 1e-4 of the largest field, and each order of 4
+ *  more divides that by about 20.
+ */
+class FastMultipoleStrategy : public AllPairsStrategy {
+public:
+
+    /**
+     * Creates a strategy with expansions of the given order
+     */
+    explicit FastMultipoleStrategy(int order = 8);
+
+    /**
+     * Destructor
+     */
+    ~FastMultipoleStrategy();
+
+    /**
+     * Returns the order of the expansions
+     */
+    int getOrder() const;
+
+    /**
+     * Sets the order of the expansions, from 0 to FmmTree::MAX_ORDER
+     */
+    void setOrder(int order);
+
+    /**
+     * Computes the field at every body
+     */
+    void prepare(const BodyStore &bodies);
+
+    /**
+     * Returns the force on a point of the given mass at pos from every body
+     * outside the slots [first, last). Bodies at pos exert no force.
+     */
+    vector2 getForce(const vector2 &pos, double mass, size_t first,
+                     size_t last) const;
+
+protected:
+
+    /**
+     * Returns 1024, about what building the tree costs in direct sums at
+     * the default order
+     */
+    size_t getBreakEven(size_t bodies) const;
+
+private:
+
+    /**
+     * Field at the bodies as of the last prepare()
+     */
+    FmmTree tree_;
+
+};
+
+/**
+ *  Sums the force of the Universe's top-level aggregates through a tree
+ *  over their centers of mass. A node whose aggregates' bodies all lie
+ *  within r of the node's center of mass is taken as one point mass there
+ *  when r < theta * d, d being its distance from the query point; an
+ *  aggregate that is not is summed body by body. Objects that are not
+ *  aggregates are always summed directly, and so are the members of the
+ *  queried aggregate itself, so nearby members still interact pairwise
+ *  while a distant group of clusters costs one term. With C aggregates a
+ *  member's force costs O(log C) plus its near field rather than O(N).
+ *
+ *  About its center of mass a node has no dipole moment, so the error of
+ *  the point mass is the quadrupole term, of order theta^2 of the node's
+ *  force; at the default theta of 0.1 the net force on every body of a
+ *  field of clusters stays within 1% of the all-pairs result. A theta of
+ *  0 reproduces AllPairsStrategy up to summation order, as does a store
+ *  with no aggregates set, which is summed directly.
+ */
+class FarFieldStrategy : public AllPairsStrategy {
+public:
+
+    /**
+     * Creates a strategy with the given distance threshold
+     */
+    explicit FarFieldStrategy(double theta = 0.1);
+
+    /**
+     * Destructor
+     */
+    ~FarFieldStrategy();
+
+    /**
+     * Returns the distance threshold
+     */
+    double getTheta() const;
+
+    /**
+     * Sets the distance threshold
+     */
+    void setTheta(double theta);
+
+    /**
+     * Sets the slots [first[a], last[a]) of each aggregate of the store
+     * passed to prepare(), in increasing order
+     */
+    void setAggregates(const std::vector<size_t> &first,
+                       const std::vector<size_t> &last);
+
+    /**
+     * Finds the aggregates' centers of mass and builds the tree over them
+     */
+    void prepare(const BodyStore &bodies);
+
+    /**
+     * Returns the force on a point of the given mass at pos from every body
+     * outside the slots [first, last). Bodies at pos exert no force.
+     */
+    vector2 getForce(const vector2 &pos, double mass, size_t first,
+                     size_t last) const;
+
+protected:
+
+    /**
+     * Returns 4, about what finding the aggregates costs in direct sums
+     */
+    size_t getBreakEven(size_t bodies) const;
+
+private:
+
+    /**
+     * A node of the tree. Its bodies lie within sqrt(radiusSq) of its
+     * center of mass. The nodes are stored in depth-first order, so a
+     * node's subtree ends at index skip. Leaves hold one aggregate; other
+     * nodes have an aggregate of -1.
+     */
+    struct Node {
+        double x, y, mass, radiusSq;
+        int skip, aggregate;
+    };
+
+    /**
+     * Appends the subtree over order_[begin, end) to nodes_
+     */
+    void build(size_t begin, size_t end);
+
+    /**
+     * Distance threshold
+     */
+    double theta_;
+
+    /**
+     * Slots [runFirst_[r], runLast_[r]) of each run of consecutive objects
+     * that are not aggregates
+     */
+    std::vector<size_t> runFirst_, runLast_;
+
+    /**
+     * Slots of each aggregate as set, and [first_[a], last_[a]) of each
+     * that lies within the store passed to prepare()
+     */
+    std::vector<size_t> aggregateFirst_, aggregateLast_, first_, last_;
+
+    /**
+     * Center of mass, mass and squared radius of each aggregate
+     */
+    std::vector<double> x_, y_, m_, radiusSq_;
+
+    /**
+     * The aggregates in the order of the tree's leaves
+     */
+    std::vector<size_t> order_;
+
+    /**
+     * Index of each aggregate's leaf, -1 for massless aggregates
+     */
+    std::vector<int> leaf_;
+
+    /**
+     * Node storage in depth-first order. Index 0 is the root.
+     */
+    std::vector<Node> nodes_;
+
+};
+
+/**
+ *  Approximates the net force with a Barnes-Hut quadtree built once per step.
+ *  A cell of side s whose center of mass is at distance d is used as a point
+ *  mass when s / d < theta, so each query costs O(log N). A theta of 0 opens
+ *  every cell and reproduces AllPairsStrategy up to summation order. The
+ *  monopole error of an accepted cell is of order theta^2 of its force; at
+ *  the default theta of 0.5 the net force on every mobile body stays within
+ *  1% of the all-pairs result.
+ */
+class BarnesHutStrategy : public AllPairsStrategy {
+public:
+
+    /**
+     * Creates a strategy with the given opening angle
+     */
+    BarnesHutStrategy(double theta = 0.5);
+
+    /**
+     * Destructor
+     */
+    ~BarnesHutStrategy();
+
+    /**
+     * Returns the opening angle
+     */
+    double getTheta() const;
+
+    /**
+     * Sets the opening angle
+     */
+    void setTheta(double theta);
+
+    /**
+     * Rebuilds the quadtree over the bodies
+     */
+    void prepare(const BodyStore &bodies);
+
+    /**
+     * Returns the force on a point of the given mass at pos from every body
+     * outside the slots [first, last). Bodies at pos exert no force.
+     */
+    vector2 getForce(const vector2 &pos, double mass, size_t first,
+                     size_t last) const;
+
+protected:
+
+    /**
+     * Returns 128, about what building the tree costs in direct sums
+     */
+    size_t getBreakEven(size_t bodies) const;
+
+private:
+
+    /**
+     * Opening angle
+     */
+    double theta_;
+
+    /**
+     * Tree over the bodies as of the last prepare()
+     */
+    QuadTree tree_;
+
+};
+
+#endif
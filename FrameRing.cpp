@@ -0,0 +1,265 @@
+/**
+ * @file: FrameRing.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the FrameRing class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "FrameRing.h"
+#include <algorithm>
+#include <thread>
+
+namespace {
+
+/**
+ *  Largest decimation; one frame in this many still reaches the drawer.
+ */
+const size_t MAX_STRIDE = 1024;
+
+/**
+ *  Number of times a side yields before it sleeps, about as long as a
+ *  fast drawer takes to free a slot.
+ */
+const int SPINS = 64;
+
+}
+
+/**
+ *  Creates a ring of at least the given number of slots, rounded up to
+ *  a power of two.
+ */
+FrameRing::FrameRing(size_t capacity, Policy policy) : policy_(policy),
+    closed_(false), sleepers_(0), head_(0), stride_(1), offered_(0),
+    published_(0), dropped_(0), decimated_(0), maxDepth_(0), depthSum_(0),
+    tail_(0) {
+    size_t count = 1;
+    while (count < capacity) {
+        count *= 2;
+    }
+    slots_.resize(count);
+    mask_ = count - 1;
+}
+
+/**
+ *  Returns the number of slots.
+ */
+size_t FrameRing::getCapacity() const {
+    return slots_.size();
+}
+
+/**
+ *  Returns the policy for a full ring.
+ */
+FrameRing::Policy FrameRing::getPolicy() const {
+    return policy_;
+}
+
+/**
+ *  Producer side. Offers a frame and returns the slot to fill, with an
+ *  empty body list, or nullptr if the frame is skipped: because the
+ *  ring is full or decimating, or because it is closed.
+ */
+FrameRing::Frame* FrameRing::acquire() {
+    if (closed_.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    uint64_t offer = offered_.load(std::memory_order_relaxed);
+    offered_.store(offer + 1, std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t depth = head - tail_.load(std::memory_order_acquire);
+    maxDepth_ = std::max(maxDepth_, depth);
+    depthSum_ += depth;
+
+    if (policy_ == DECIMATE) {
+        if (stride_ > 1 && depth <= slots_.size() / 4) {
+            stride_ /= 2;
+        }
+        if (offer % stride_ != 0) {
+            decimated_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    }
+    if (depth == slots_.size()) {
+        if (policy_ == BLOCK) {
+            if (!waitForSpace()) {
+                return nullptr;
+            }
+        } else {
+            if (policy_ == DECIMATE) {
+                stride_ = std::min(2 * stride_, MAX_STRIDE);
+            }
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    }
+    Frame &frame = slots_[head & mask_];
+    frame.bodies.clear();
+    return &frame;
+}
+
+/**
+ *  Producer side. Hands the slot returned by the last acquire() to the
+ *  consumer.
+ */
+void FrameRing::publish() {
+    published_.fetch_add(1, std::memory_order_relaxed);
+    head_.store(head_.load(std::memory_order_relaxed) + 1,
+        std::memory_order_release);
+    wake();
+}
+
+/**
+ *  Consumer side. Waits for the oldest published frame and returns
+ *  it, or returns nullptr once the ring is closed and drained.
+ */
+const FrameRing::Frame* FrameRing::front() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    await([&]() {
+        return head_.load(std::memory_order_acquire) != tail
+            || closed_.load(std::memory_order_acquire);
+    });
+    // The producer publishes before it closes, so a frame published
+    // before the close is seen by the check after it.
+    if (head_.load(std::memory_order_acquire) == tail) {
+        return nullptr;
+    }
+    return &slots_[tail & mask_];
+}
+
+/**
+ *  Consumer side. Releases the frame returned by front().
+ */
+void FrameRing::pop() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+        std::memory_order_release);
+    wake();
+}
+
+/**
+ *  Closes the ring, from either side. The producer's acquire() fails
+ *  from then on, and the consumer's front() fails once the published
+ *  frames are drained.
+ */
+void FrameRing::close() {
+    closed_.store(true, std::memory_order_release);
+    wake();
+}
+
+/**
+ *  Returns true once the ring is closed.
+ */
+bool FrameRing::isClosed() const {
+    return closed_.load(std::memory_order_acquire);
+}
+
+/**
+ *  Returns the number of frames published and not yet popped.
+ */
+size_t FrameRing::getDepth() const {
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return head_.load(std::memory_order_acquire) - tail;
+}
+
+/**
+ *  Returns the number of frames offered by the producer.
+ */
+uint64_t FrameRing::getOfferedCount() const {
+    return offered_.load(std::memory_order_relaxed);
+}
+
+/**
+ *  Returns the number of frames published.
+ */
+uint64_t FrameRing::getPublishedCount() const {
+    return published_.load(std::memory_order_relaxed);
+}
+
+/**
+ *  Returns the number of frames skipped because the ring was full.
+ */
+uint64_t FrameRing::getDroppedCount() const {
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+/**
+ *  Returns the number of frames skipped by decimation.
+ */
+uint64_t FrameRing::getDecimatedCount() const {
+    return decimated_.load(std::memory_order_relaxed);
+}
+
+/**
+ *  Returns the largest depth seen by the producer. Like the mean depth
+ *  and the stride, it is only read safely by the producer or once the
+ *  producer has stopped.
+ */
+size_t FrameRing::getMaxDepth() const {
+    return maxDepth_;
+}
+
+/**
+ *  Returns the mean depth seen by the producer at each offer.
+ */
+double FrameRing::getMeanDepth() const {
+    uint64_t offers = getOfferedCount();
+    return offers == 0 ? 0 : depthSum_ / offers;
+}
+
+/**
+ *  Returns the current decimation: one frame in this many is offered
+ *  to the ring.
+ */
+size_t FrameRing::getStride() const {
+    return stride_;
+}
+
+/**
+ *  Waits until the ring has a free slot or is closed, returning false
+ *  if it was closed.
+ */
+bool FrameRing::waitForSpace() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    await([&]() {
+        return head - tail_.load(std::memory_order_acquire) != slots_.size()
+            || closed_.load(std::memory_order_acquire);
+    });
+    return head - tail_.load(std::memory_order_acquire) != slots_.size();
+}
+
+/**
+ *  Returns once ready() is true, yielding at first and then sleeping
+ *  until wake() is called.
+ */
+template <typename F>
+void FrameRing::await(F ready) {
+    for (int i = 0; i < SPINS; ++i) {
+        if (ready()) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+    // The sleeper counts itself before its last check and the waker
+    // changes the state before it reads the count, so with the fences
+    // either the check sees the change or the waker sees the sleeper.
+    // The sleeper holds the lock from the check until it waits, so the
+    // wake-up cannot fall in between.
+    std::unique_lock<std::mutex> lock(mutex_);
+    sleepers_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!ready()) {
+        woken_.wait(lock);
+    }
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ *  Wakes the sides sleeping in await().
+ */
+void FrameRing::wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        woken_.notify_all();
+    }
+}
@@ -0,0 +1,237 @@
+/**
+ * @file: FrameRing.h
+ * @author Ethan Raymond
+ * @Description: This file declares the FrameRing class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef _FRAME_RING_H_
+#define _FRAME_RING_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+/**
+ *  Lock-free single-producer/single-consumer ring of position snapshots,
+ *  handing the frames of the physics thread to the drawing thread so that
+ *  a slow drawer no longer throttles the simulation. The slots and their
+ *  body lists are reused, so the ring stops allocating once every slot
+ *  has held the largest frame.
+ *
+ *  The producer calls acquire(), fills the slot and calls publish(); the
+ *  consumer calls front(), draws the frame and calls pop(). Each side
+ *  writes only its own index, kept on its own cache line. A side that
+ *  has to wait yields for a while and then sleeps on a condition
+ *  variable; the other side takes the lock to wake it only while it
+ *  sleeps, so an idle drawer costs no CPU and a busy ring takes no lock.
+ *
+ *  When the ring is full the policy decides what the producer does:
+ *  BLOCK waits for the consumer, so every frame is drawn; DROP skips the
+ *  frame; DECIMATE skips it and halves the rate at which frames are
+ *  offered, then doubles the rate back once the consumer has caught up,
+ *  so a lagging drawer sees evenly spaced frames instead of bursts.
+ */
+class FrameRing {
+public:
+
+    /**
+     *  Policies for a full ring.
+     */
+    enum Policy { BLOCK, DROP, DECIMATE };
+
+    /**
+     *  A body in a frame: its position in meters, the radius it is drawn
+     *  with and the ID of its name in the ObjectPool.
+     */
+    struct Body {
+        double x, y;
+        int radius;
+        uint32_t nameId;
+    };
+
+    /**
+     *  A snapshot of the bodies after a step.
+     */
+    struct Frame {
+        uint64_t step;
+        double time;
+        std::vector<Body> bodies;
+    };
+
+    /**
+     *  Creates a ring of at least the given number of slots, rounded up to
+     *  a power of two.
+     */
+    FrameRing(size_t capacity, Policy policy);
+
+    /**
+     *  Returns the number of slots.
+     */
+    size_t getCapacity() const;
+
+    /**
+     *  Returns the policy for a full ring.
+     */
+    Policy getPolicy() const;
+
+    /**
+     *  Producer side. Offers a frame and returns the slot to fill, with an
+     *  empty body list, or nullptr if the frame is skipped: because the
+     *  ring is full or decimating, or because it is closed.
+     */
+    Frame* acquire();
+
+    /**
+     *  Producer side. Hands the slot returned by the last acquire() to the
+     *  consumer.
+     */
+    void publish();
+
+    /**
+     *  Consumer side. Waits for the oldest published frame and returns
+     *  it, or returns nullptr once the ring is closed and drained.
+     */
+    const Frame* front();
+
+    /**
+     *  Consumer side. Releases the frame returned by front().
+     */
+    void pop();
+
+    /**
+     *  Closes the ring, from either side. The producer's acquire() fails
+     *  from then on, and the consumer's front() fails once the published
+     *  frames are drained.
+     */
+    void close();
+
+    /**
+     *  Returns true once the ring is closed.
+     */
+    bool isClosed() const;
+
+    /**
+     *  Returns the number of frames published and not yet popped.
+     */
+    size_t getDepth() const;
+
+    /**
+     *  Returns the number of frames offered by the producer.
+     */
+    uint64_t getOfferedCount() const;
+
+    /**
+     *  Returns the number of frames published.
+     */
+    uint64_t getPublishedCount() const;
+
+    /**
+     *  Returns the number of frames skipped because the ring was full.
+     */
+    uint64_t getDroppedCount() const;
+
+    /**
+     *  Returns the number of frames skipped by decimation.
+     */
+    uint64_t getDecimatedCount() const;
+
+    /**
+     *  Returns the largest depth seen by the producer. Like the mean depth
+     *  and the stride, it is only read safely by the producer or once the
+     *  producer has stopped.
+     */
+    size_t getMaxDepth() const;
+
+    /**
+     *  Returns the mean depth seen by the producer at each offer.
+     */
+    double getMeanDepth() const;
+
+    /**
+     *  Returns the current decimation: one frame in this many is offered
+     *  to the ring.
+     */
+    size_t getStride() const;
+
+private:
+
+    /**
+     *  Size of a cache line, separating the two sides' indices.
+     */
+    static const size_t LINE = 64;
+
+    /**
+     *  Waits until the ring has a free slot or is closed, returning false
+     *  if it was closed.
+     */
+    bool waitForSpace();
+
+    /**
+     *  Returns once ready() is true, yielding at first and then sleeping
+     *  until wake() is called.
+     */
+    template <typename F>
+    void await(F ready);
+
+    /**
+     *  Wakes the sides sleeping in await().
+     */
+    void wake();
+
+    /**
+     *  Slots, indexed by an index modulo their count.
+     */
+    std::vector<Frame> slots_;
+
+    /**
+     *  Number of slots minus one.
+     */
+    size_t mask_;
+
+    /**
+     *  Policy for a full ring.
+     */
+    Policy policy_;
+
+    /**
+     *  Set by close().
+     */
+    std::atomic<bool> closed_;
+
+    /**
+     *  Number of sides sleeping in await(), the lock they sleep under and
+     *  the condition they wait for.
+     */
+    std::atomic<int> sleepers_;
+    std::mutex mutex_;
+    std::condition_variable woken_;
+
+    char pad0_[LINE];
+
+    /**
+     *  Producer's state: the index of the next slot to publish, the
+     *  decimation and the counters.
+     */
+    std::atomic<size_t> head_;
+    size_t stride_;
+    std::atomic<uint64_t> offered_, published_, dropped_, decimated_;
+    size_t maxDepth_;
+    double depthSum_;
+
+    char pad1_[LINE];
+
+    /**
+     *  Consumer's state: the index of the next slot to pop.
+     */
+    std::atomic<size_t> tail_;
+
+    char pad2_[LINE];
+
+};
+
+#endif
@@ -0,0 +1,156 @@
+/**
+ * @file: FrameWriter.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the FrameWriter class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "FrameWriter.h"
+#include "ObjectPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ *  Size of the FRAMED header.
+ */
+const size_t HEADER_SIZE = 16;
+
+/**
+ *  "UFRM" read as a little-endian uint32.
+ */
+const uint32_t MAGIC = 0x4d524655;
+
+}
+
+/**
+ *  Creates a writer for the given descriptor and format.
+ */
+FrameWriter::FrameWriter(int fd, Format format) : fd_(fd), format_(format),
+    size_(format == FRAMED ? HEADER_SIZE : 0), count_(0), frames_(0),
+    lastSize_(0) {
+    buffer_.resize(4096);
+}
+
+/**
+ *  Returns the wire format.
+ */
+FrameWriter::Format FrameWriter::getFormat() const {
+    return format_;
+}
+
+/**
+ *  Adds an object drawn as a circle of the given radius around (x, y)
+ *  in screen coordinates, labeled with the name with the given ID, to
+ *  the current frame. The name is only looked up when it is sent.
+ */
+void FrameWriter::add(int x, int y, int radius, uint32_t nameId) {
+    ++count_;
+    if (format_ == FRAMED) {
+        putInt(x);
+        putInt(y);
+        putInt(radius);
+        putInt(nameId);
+        if (nameId < sent_.size() && sent_[nameId]) {
+            putInt(0);
+            return;
+        }
+        if (nameId >= sent_.size()) {
+            sent_.resize(nameId + 1);
+        }
+        sent_[nameId] = true;
+        const std::string &name = ObjectPool::instance().getName(nameId);
+        putInt(name.size());
+        put(name.data(), name.size());
+        return;
+    }
+
+    const std::string &name = ObjectPool::instance().getName(nameId);
+    const char circle = 1, label = 2;
+    int d = radius / 2;
+    put(&circle, 1);
+    putInt(x - d);
+    putInt(y - d);
+    putInt(2 * radius);
+    putInt(2 * radius);
+    put(&label, 1);
+    put(name.c_str(), name.size() + 1);
+    putInt(x);
+    putInt(y);
+}
+
+/**
+ *  Writes the current frame and starts the next one, waiting for a
+ *  non-blocking descriptor to accept it. Returns false if the
+ *  descriptor refused the write, e.g. because the drawer exited.
+ */
+bool FrameWriter::endFrame() {
+    if (format_ == FRAMED) {
+        uint32_t header[4] = {MAGIC, frames_, count_,
+                              uint32_t(size_ - HEADER_SIZE)};
+        std::memcpy(buffer_.data(), header, HEADER_SIZE);
+    } else {
+        const char end = 0;
+        put(&end, 1);
+    }
+
+    bool ok = true;
+    for (size_t done = 0; done < size_ && ok; ) {
+        ssize_t n = ::write(fd_, buffer_.data() + done, size_ - done);
+        if (n > 0) {
+            done += n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // A non-blocking descriptor is full: waits until the drawer
+            // reads, and lets the next write report a closed pipe.
+            pollfd writable = {fd_, POLLOUT, 0};
+            ok = poll(&writable, 1, -1) >= 0 || errno == EINTR;
+        } else if (n == 0 || errno != EINTR) {
+            ok = false;
+        }
+    }
+
+    PROFILE_COUNT(BYTES_WRITTEN, size_);
+    lastSize_ = size_;
+    size_ = format_ == FRAMED ? HEADER_SIZE : 0;
+    count_ = 0;
+    ++frames_;
+    return ok;
+}
+
+/**
+ *  Returns the number of frames written.
+ */
+uint32_t FrameWriter::getFrameCount() const {
+    return frames_;
+}
+
+/**
+ *  Returns the size in bytes of the last frame written.
+ */
+size_t FrameWriter::getFrameSize() const {
+    return lastSize_;
+}
+
+/**
+ *  Appends raw bytes to the frame.
+ */
+void FrameWriter::put(const void *data, size_t size) {
+    if (size_ + size > buffer_.size()) {
+        buffer_.resize(std::max(2 * buffer_.size(), size_ + size));
+    }
+    std::memcpy(buffer_.data() + size_, data, size);
+    size_ += size;
+}
+
+/**
+ *  Appends a 4-byte integer to the frame.
+ */
+void FrameWriter::putInt(int32_t value) {
+    put(&value, sizeof(value));
+}
@@ -0,0 +1,134 @@
+/**
+ * @file: FrameWriter.h
+ * @author Ethan Raymond
+ * @Description: This file declares the FrameWriter class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef _FRAME_WRITER_H_
+#define _FRAME_WRITER_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+/**
+ *  Encodes the drawer's frames into a buffer and writes each frame to a
+ *  file descriptor with a single write call, instead of flushing after
+ *  every field. Integers are written in the host's byte order, which the
+ *  drivers check is little-endian with 4-byte ints.
+ *
+ *  Two formats are supported:
+ *
+ *  OPCODES is the original drawer stream, byte for byte: per object a
+ *  circle (opcode 1 and four ints: left, top, width, height) and a label
+ *  (opcode 2, the NUL-terminated name and two ints: x, y), and a 0 byte
+ *  ending the frame. drawer5c.jar reads this format.
+ *
+ *  FRAMED starts every frame with a header of four uint32: the magic
+ *  "UFRM", the frame id counting from 0, the object count and the number
+ *  of record bytes that follow. Each record is the object's center x and
+ *  y and radius as int32, the name's ID in the ObjectPool as uint32, the
+ *  name length as uint32, and the name without a terminator. A name is
+ *  sent once per writer, in the first record with its ID; later records
+ *  with that ID have a length of 0 and the reader reuses the name.
+ */
+class FrameWriter {
+public:
+
+    /**
+     *  Wire formats.
+     */
+    enum Format { OPCODES, FRAMED };
+
+    /**
+     *  Creates a writer for the given descriptor and format.
+     */
+    FrameWriter(int fd, Format format);
+
+    /**
+     *  Returns the wire format.
+     */
+    Format getFormat() const;
+
+    /**
+     *  Adds an object drawn as a circle of the given radius around (x, y)
+     *  in screen coordinates, labeled with the name with the given ID, to
+     *  the current frame. The name is only looked up when it is sent.
+     */
+    void add(int x, int y, int radius, uint32_t nameId);
+
+    /**
+     *  Writes the current frame and starts the next one, waiting for a
+     *  non-blocking descriptor to accept it. Returns false if the
+     *  descriptor refused the write, e.g. because the drawer exited.
+     */
+    bool endFrame();
+
+    /**
+     *  Returns the number of frames written.
+     */
+    uint32_t getFrameCount() const;
+
+    /**
+     *  Returns the size in bytes of the last frame written.
+     */
+    size_t getFrameSize() const;
+
+private:
+
+    /**
+     *  Appends raw bytes to the frame.
+     */
+    void put(const void *data, size_t size);
+
+    /**
+     *  Appends a 4-byte integer to the frame.
+     */
+    void putInt(int32_t value);
+
+    /**
+     *  Descriptor the frames are written to.
+     */
+    int fd_;
+
+    /**
+     *  Wire format.
+     */
+    Format format_;
+
+    /**
+     *  Encoded frame, reused between frames so that it stops allocating
+     *  once it has grown to the largest frame.
+     */
+    std::vector<char> buffer_;
+
+    /**
+     *  Number of bytes of buffer_ in use.
+     */
+    size_t size_;
+
+    /**
+     *  Objects in the current frame.
+     */
+    uint32_t count_;
+
+    /**
+     *  Frames written so far.
+     */
+    uint32_t frames_;
+
+    /**
+     *  Size of the last frame written.
+     */
+    size_t lastSize_;
+
+    /**
+     *  True at the IDs of the names already sent in the FRAMED format.
+     */
+    std::vector<bool> sent_;
+
+};
+
+#endif
@@ -0,0 +1,446 @@
+/**
+ * @file: GravityKernel.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the batched gravity kernel
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "GravityKernel.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GRAVITY_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+typedef void (*Kernel)(const double *x, const double *y, const double *m,
+                       size_t count, double px, double py, double &ax,
+                       double &ay);
+
+typedef void (*Scatter)(const double *x, const double *y, const double *m,
+                        size_t count, double px, double py, double pm,
+                        double &ax, double &ay, double *sx, double *sy);
+
+/**
+ *  Portable variant, also used for the tails of the vector variants.
+ */
+void scalarKernel(const double *x, const double *y, const double *m,
+                  size_t count, double px, double py, double &ax,
+                  double &ay) {
+    double sx = 0, sy = 0;
+    for (size_t j = 0; j < count; ++j) {
+        double dx = x[j] - px;
+        double dy = y[j] - py;
+        double distSq = dx * dx + dy * dy;
+        if (distSq > 0) {
+            double scale = m[j] / (distSq * std::sqrt(distSq));
+            sx += dx * scale;
+            sy += dy * scale;
+        }
+    }
+    ax += sx;
+    ay += sy;
+}
+
+/**
+ *  Portable scatter variant, also used for the tails of the vector
+ *  variants.
+ */
+void scalarScatter(const double *x, const double *y, const double *m,
+                   size_t count, double px, double py, double pm,
+                   double &ax, double &ay, double *sx, double *sy) {
+    double tx = 0, ty = 0;
+    for (size_t j = 0; j < count; ++j) {
+        double dx = x[j] - px;
+        double dy = y[j] - py;
+        double distSq = dx * dx + dy * dy;
+        if (distSq > 0) {
+            double inv = 1 / (distSq * std::sqrt(distSq));
+            tx += dx * (m[j] * inv);
+            ty += dy * (m[j] * inv);
+            sx[j] -= dx * (pm * inv);
+            sy[j] -= dy * (pm * inv);
+        }
+    }
+    ax += tx;
+    ay += ty;
+}
+
+#ifdef GRAVITY_KERNEL_X86
+
+/**
+ *  Two sources per iteration. Coincident sources give 0/0 or m/0, which the
+ *  r^2 > 0 mask clears before it can reach the sums.
+ */
+__attribute__((target("sse2")))
+void sse2Kernel(const double *x, const double *y, const double *m,
+                size_t count, double px, double py, double &ax,
+                double &ay) {
+    __m128d vpx = _mm_set1_pd(px);
+    __m128d vpy = _mm_set1_pd(py);
+    __m128d zero = _mm_setzero_pd();
+    __m128d sx = zero, sy = zero;
+    size_t j = 0;
+    for (; j + 2 <= count; j += 2) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(x + j), vpx);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(y + j), vpy);
+        __m128d distSq = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+        __m128d scale = _mm_div_pd(_mm_loadu_pd(m + j),
+            _mm_mul_pd(distSq, _mm_sqrt_pd(distSq)));
+        scale = _mm_and_pd(scale, _mm_cmpgt_pd(distSq, zero));
+        sx = _mm_add_pd(sx, _mm_mul_pd(dx, scale));
+        sy = _mm_add_pd(sy, _mm_mul_pd(dy, scale));
+    }
+    double lx[2], ly[2];
+    _mm_storeu_pd(lx, sx);
+    _mm_storeu_pd(ly, sy);
+    double rx = lx[0] + lx[1];
+    double ry = ly[0] + ly[1];
+    scalarKernel(x + j, y + j, m + j, count - j, px, py, rx, ry);
+    ax += rx;
+    ay += ry;
+}
+
+/**
+ *  Four sources per iteration, with fused multiply-adds.
+ */
+__attribute__((target("avx2,fma")))
+void avx2Kernel(const double *x, const double *y, const double *m,
+                size_t count, double px, double py, double &ax,
+                double &ay) {
+    __m256d vpx = _mm256_set1_pd(px);
+    __m256d vpy = _mm256_set1_pd(py);
+    __m256d zero = _mm256_setzero_pd();
+    __m256d sx = zero, sy = zero;
+    size_t j = 0;
+    for (; j + 4 <= count; j += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + j), vpx);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + j), vpy);
+        __m256d distSq = _mm256_fmadd_pd(dx, dx, _mm256_mul_pd(dy, dy));
+        __m256d scale = _mm256_div_pd(_mm256_loadu_pd(m + j),
+            _mm256_mul_pd(distSq, _mm256_sqrt_pd(distSq)));
+        scale = _mm256_and_pd(scale,
+            _mm256_cmp_pd(distSq, zero, _CMP_GT_OQ));
+        sx = _mm256_fmadd_pd(dx, scale, sx);
+        sy = _mm256_fmadd_pd(dy, scale, sy);
+    }
+    double lx[4], ly[4];
+    _mm256_storeu_pd(lx, sx);
+    _mm256_storeu_pd(ly, sy);
+    double rx = (lx[0] + lx[1]) + (lx[2] + lx[3]);
+    double ry = (ly[0] + ly[1]) + (ly[2] + ly[3]);
+    scalarKernel(x + j, y + j, m + j, count - j, px, py, rx, ry);
+    ax += rx;
+    ay += ry;
+}
+
+/**
+ *  Eight sources per iteration. The square root and division are masked so
+ *  coincident sources never produce an infinity.
+ */
+__attribute__((target("avx512f")))
+void avx512Kernel(const double *x, const double *y, const double *m,
+                  size_t count, double px, double py, double &ax,
+                  double &ay) {
+    __m512d vpx = _mm512_set1_pd(px);
+    __m512d vpy = _mm512_set1_pd(py);
+    __m512d zero = _mm512_setzero_pd();
+    __m512d sx = zero, sy = zero;
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(x + j), vpx);
+        __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(y + j), vpy);
+        __m512d distSq = _mm512_fmadd_pd(dx, dx, _mm512_mul_pd(dy, dy));
+        __mmask8 mask = _mm512_cmp_pd_mask(distSq, zero, _CMP_GT_OQ);
+        __m512d scale = _mm512_maskz_div_pd(mask, _mm512_loadu_pd(m + j),
+            _mm512_mul_pd(distSq, _mm512_maskz_sqrt_pd(mask, distSq)));
+        sx = _mm512_fmadd_pd(dx, scale, sx);
+        sy = _mm512_fmadd_pd(dy, scale, sy);
+    }
+    double lx[8], ly[8];
+    _mm512_storeu_pd(lx, sx);
+    _mm512_storeu_pd(ly, sy);
+    double rx = ((lx[0] + lx[1]) + (lx[2] + lx[3]))
+        + ((lx[4] + lx[5]) + (lx[6] + lx[7]));
+    double ry = ((ly[0] + ly[1]) + (ly[2] + ly[3]))
+        + ((ly[4] + ly[5]) + (ly[6] + ly[7]));
+    scalarKernel(x + j, y + j, m + j, count - j, px, py, rx, ry);
+    ax += rx;
+    ay += ry;
+}
+
+/**
+ *  Two sources per iteration of the scatter.
+ */
+__attribute__((target("sse2")))
+void sse2Scatter(const double *x, const double *y, const double *m,
+                 size_t count, double px, double py, double pm,
+                 double &ax, double &ay, double *sx, double *sy) {
+    __m128d vpx = _mm_set1_pd(px);
+    __m128d vpy = _mm_set1_pd(py);
+    __m128d vpm = _mm_set1_pd(pm);
+    __m128d zero = _mm_setzero_pd();
+    __m128d tx = zero, ty = zero;
+    size_t j = 0;
+    for (; j + 2 <= count; j += 2) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(x + j), vpx);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(y + j), vpy);
+        __m128d distSq = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+        __m128d inv = _mm_div_pd(_mm_set1_pd(1),
+            _mm_mul_pd(distSq, _mm_sqrt_pd(distSq)));
+        inv = _mm_and_pd(inv, _mm_cmpgt_pd(distSq, zero));
+        __m128d scale = _mm_mul_pd(_mm_loadu_pd(m + j), inv);
+        __m128d back = _mm_mul_pd(vpm, inv);
+        tx = _mm_add_pd(tx, _mm_mul_pd(dx, scale));
+        ty = _mm_add_pd(ty, _mm_mul_pd(dy, scale));
+        _mm_storeu_pd(sx + j,
+            _mm_sub_pd(_mm_loadu_pd(sx + j), _mm_mul_pd(dx, back)));
+        _mm_storeu_pd(sy + j,
+            _mm_sub_pd(_mm_loadu_pd(sy + j), _mm_mul_pd(dy, back)));
+    }
+    double lx[2], ly[2];
+    _mm_storeu_pd(lx, tx);
+    _mm_storeu_pd(ly, ty);
+    double rx = lx[0] + lx[1];
+    double ry = ly[0] + ly[1];
+    scalarScatter(x + j, y + j, m + j, count - j, px, py, pm, rx, ry,
+                  sx + j, sy + j);
+    ax += rx;
+    ay += ry;
+}
+
+/**
+ *  Four sources per iteration of the scatter, with fused multiply-adds.
+ */
+__attribute__((target("avx2,fma")))
+void avx2Scatter(const double *x, const double *y, const double *m,
+                 size_t count, double px, double py, double pm,
+                 double &ax, double &ay, double *sx, double *sy) {
+    __m256d vpx = _mm256_set1_pd(px);
+    __m256d vpy = _mm256_set1_pd(py);
+    __m256d vpm = _mm256_set1_pd(pm);
+    __m256d zero = _mm256_setzero_pd();
+    __m256d tx = zero, ty = zero;
+    size_t j = 0;
+    for (; j + 4 <= count; j += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + j), vpx);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + j), vpy);
+        __m256d distSq = _mm256_fmadd_pd(dx, dx, _mm256_mul_pd(dy, dy));
+        __m256d inv = _mm256_div_pd(_mm256_set1_pd(1),
+            _mm256_mul_pd(distSq, _mm256_sqrt_pd(distSq)));
+        inv = _mm256_and_pd(inv, _mm256_cmp_pd(distSq, zero, _CMP_GT_OQ));
+        __m256d scale = _mm256_mul_pd(_mm256_loadu_pd(m + j), inv);
+        __m256d back = _mm256_mul_pd(vpm, inv);
+        tx = _mm256_fmadd_pd(dx, scale, tx);
+        ty = _mm256_fmadd_pd(dy, scale, ty);
+        _mm256_storeu_pd(sx + j,
+            _mm256_fnmadd_pd(dx, back, _mm256_loadu_pd(sx + j)));
+        _mm256_storeu_pd(sy + j,
+            _mm256_fnmadd_pd(dy, back, _mm256_loadu_pd(sy + j)));
+    }
+    double lx[4], ly[4];
+    _mm256_storeu_pd(lx, tx);
+    _mm256_storeu_pd(ly, ty);
+    double rx = (lx[0] + lx[1]) + (lx[2] + lx[3]);
+    double ry = (ly[0] + ly[1]) + (ly[2] + ly[3]);
+    scalarScatter(x + j, y + j, m + j, count - j, px, py, pm, rx, ry,
+                  sx + j, sy + j);
+    ax += rx;
+    ay += ry;
+}
+
+/**
+ *  Eight sources per iteration of the scatter, masked like avx512Kernel.
+ */
+__attribute__((target("avx512f")))
+void avx512Scatter(const double *x, const double *y, const double *m,
+                   size_t count, double px, double py, double pm,
+                   double &ax, double &ay, double *sx, double *sy) {
+    __m512d vpx = _mm512_set1_pd(px);
+    __m512d vpy = _mm512_set1_pd(py);
+    __m512d vpm = _mm512_set1_pd(pm);
+    __m512d zero = _mm512_setzero_pd();
+    __m512d tx = zero, ty = zero;
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(x + j), vpx);
+        __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(y + j), vpy);
+        __m512d distSq = _mm512_fmadd_pd(dx, dx, _mm512_mul_pd(dy, dy));
+        __mmask8 mask = _mm512_cmp_pd_mask(distSq, zero, _CMP_GT_OQ);
+        __m512d inv = _mm512_maskz_div_pd(mask, _mm512_set1_pd(1),
+            _mm512_mul_pd(distSq, _mm512_maskz_sqrt_pd(mask, distSq)));
+        __m512d scale = _mm512_mul_pd(_mm512_loadu_pd(m + j), inv);
+        __m512d back = _mm512_mul_pd(vpm, inv);
+        tx = _mm512_fmadd_pd(dx, scale, tx);
+        ty = _mm512_fmadd_pd(dy, scale, ty);
+        _mm512_storeu_pd(sx + j,
+            _mm512_fnmadd_pd(dx, back, _mm512_loadu_pd(sx + j)));
+        _mm512_storeu_pd(sy + j,
+            _mm512_fnmadd_pd(dy, back, _mm512_loadu_pd(sy + j)));
+    }
+    double lx[8], ly[8];
+    _mm512_storeu_pd(lx, tx);
+    _mm512_storeu_pd(ly, ty);
+    double rx = ((lx[0] + lx[1]) + (lx[2] + lx[3]))
+        + ((lx[4] + lx[5]) + (lx[6] + lx[7]));
+    double ry = ((ly[0] + ly[1]) + (ly[2] + ly[3]))
+        + ((ly[4] + ly[5]) + (ly[6] + ly[7]));
+    scalarScatter(x + j, y + j, m + j, count - j, px, py, pm, rx, ry,
+                  sx + j, sy + j);
+    ax += rx;
+    ay += ry;
+}
+
+#endif
+
+/**
+ *  Returns the variant for the instruction set.
+ */
+Kernel lookup(GravityKernel::Isa isa) {
+    switch (isa) {
+#ifdef GRAVITY_KERNEL_X86
+    case GravityKernel::SSE2:
+        return sse2Kernel;
+    case GravityKernel::AVX2:
+        return avx2Kernel;
+    case GravityKernel::AVX512:
+        return avx512Kernel;
+#endif
+    default:
+        return scalarKernel;
+    }
+}
+
+/**
+ *  Returns the scatter variant for the instruction set.
+ */
+Scatter lookupScatter(GravityKernel::Isa isa) {
+    switch (isa) {
+#ifdef GRAVITY_KERNEL_X86
+    case GravityKernel::SSE2:
+        return sse2Scatter;
+    case GravityKernel::AVX2:
+        return avx2Scatter;
+    case GravityKernel::AVX512:
+        return avx512Scatter;
+#endif
+    default:
+        return scalarScatter;
+    }
+}
+
+/**
+ *  The variant in use, picked on first use.
+ */
+struct Selection {
+    Selection() : isa(GravityKernel::detect()), kernel(lookup(isa)),
+        scatter(lookupScatter(isa)) {}
+    GravityKernel::Isa isa;
+    Kernel kernel;
+    Scatter scatter;
+};
+
+Selection& selection() {
+    static Selection current;
+    return current;
+}
+
+}
+
+/**
+ *  Adds sum(m[j] * d / |d|^3) over the sources j in [0, count) to ax and
+ *  ay, where d is the vector from (px, py) to source j.
+ */
+void GravityKernel::accumulate(const double *x, const double *y,
+                               const double *m, size_t count, double px,
+                               double py, double &ax, double &ay) {
+    selection().kernel(x, y, m, count, px, py, ax, ay);
+}
+
+/**
+ *  Like accumulate(), and also subtracts pm * d / |d|^3 from sx[j] and
+ *  sy[j]: the pull of a mass pm at (px, py) back on each source. Lets a
+ *  caller evaluate each pair of bodies once.
+ */
+void GravityKernel::scatter(const double *x, const double *y,
+                            const double *m, size_t count, double px,
+                            double py, double pm, double &ax, double &ay,
+                            double *sx, double *sy) {
+    selection().scatter(x, y, m, count, px, py, pm, ax, ay, sx, sy);
+}
+
+/**
+ *  Returns the widest instruction set the CPU supports.
+ */
+GravityKernel::Isa GravityKernel::detect() {
+    const Isa order[] = {AVX512, AVX2, SSE2};
+    for (size_t i = 0; i < sizeof(order) / sizeof(*order); ++i) {
+        if (supports(order[i])) {
+            return order[i];
+        }
+    }
+    return SCALAR;
+}
+
+/**
+ *  Returns true if the CPU supports the instruction set.
+ */
+bool GravityKernel::supports(Isa isa) {
+#ifdef GRAVITY_KERNEL_X86
+    __builtin_cpu_init();
+    switch (isa) {
+    case SSE2:
+        return __builtin_cpu_supports("sse2");
+    case AVX2:
+        return __builtin_cpu_supports("avx2")
+            && __builtin_cpu_supports("fma");
+    case AVX512:
+        return __builtin_cpu_supports("avx512f");
+    default:
+        return true;
+    }
+#else
+    return isa == SCALAR;
+#endif
+}
+
+/**
+ *  Returns the variant accumulate() currently uses.
+ */
+GravityKernel::Isa GravityKernel::getIsa() {
+    return selection().isa;
+}
+
+/**
+ *  Forces a variant, for benchmarks and comparisons. Returns false and
+ *  changes nothing if the CPU does not support it. Must not be called
+ *  while another thread is using the kernel.
+ */
+bool GravityKernel::setIsa(Isa isa) {
+    if (!supports(isa)) {
+        return false;
+    }
+    selection().isa = isa;
+    selection().kernel = lookup(isa);
+    selection().scatter = lookupScatter(isa);
+    return true;
+}
+
+/**
+ *  Returns the name of the instruction set.
+ */
+const char* GravityKernel::getName(Isa isa) {
+    switch (isa) {
+    case SSE2:
+        return "sse2";
+    case AVX2:
+        return "avx2";
+    case AVX512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
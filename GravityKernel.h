@@ -0,0 +1,151 @@
+/**
+ * @file: GravityKernel.h
+ * @author Ethan Raymond
+ * @Description: This file declares the batched gravity kernel
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef _GRAVITY_KERNEL_H_
+#define _GRAVITY_KERNEL_H_
+
+#include <cmath>
+#include <cstdlib>
+
+/**
+ *  Calls f(0), f(1), ..., f(N - 1), expanded at compile time so that the
+ *  loops over the coordinates of a body have no loop left in them.
+ */
+template <size_t N>
+struct Unroll {
+    template <typename F>
+    static void apply(F &f) {
+        Unroll<N - 1>::apply(f);
+        f(N - 1);
+    }
+};
+
+template <>
+struct Unroll<0> {
+    template <typename F>
+    static void apply(F &f) {}
+};
+
+/**
+ *  Sums the gravitational field of a tile of sources at one target point.
+ *  The sources are given as parallel x, y and mass arrays, as found in a
+ *  BodyStore, and sources at exactly the target position are skipped the
+ *  way Universe::getForce skips coincident objects. Multiply the result by
+ *  G and the target mass to obtain the force.
+ *
+ *  On x86 the kernel has SSE2, AVX2 (with FMA) and AVX-512 variants; the
+ *  widest one the CPU supports is picked the first time the kernel is
+ *  used. Each variant sums in a fixed order, so its results are
+ *  reproducible, but different variants round differently.
+ */
+class GravityKernel {
+public:
+
+    /**
+     *  Instruction sets with a kernel variant.
+     */
+    enum Isa { SCALAR, SSE2, AVX2, AVX512 };
+
+    /**
+     *  Adds sum(m[j] * d / |d|^3) over the sources j in [0, count) to ax and
+     *  ay, where d is the vector from (px, py) to source j.
+     */
+    static void accumulate(const double *x, const double *y,
+                           const double *m, size_t count, double px,
+                           double py, double &ax, double &ay);
+
+    /**
+     *  Adds sum(m[j] * d / |d|^3) over the sources j in [0, count) to
+     *  field[0, D), where d is the vector from p to source j and the
+     *  sources' coordinates are given as D parallel arrays. In 2D this is
+     *  accumulate() above; in other dimensions a portable loop with every
+     *  coordinate unrolled at compile time.
+     */
+    template <size_t D>
+    static void accumulate(const double *const *pos, const double *m,
+                           size_t count, const double *p, double *field);
+
+    /**
+     *  Like accumulate(), and also subtracts pm * d / |d|^3 from sx[j] and
+     *  sy[j]: the pull of a mass pm at (px, py) back on each source. Lets a
+     *  caller evaluate each pair of bodies once.
+     */
+    static void scatter(const double *x, const double *y, const double *m,
+                        size_t count, double px, double py, double pm,
+                        double &ax, double &ay, double *sx, double *sy);
+
+    /**
+     *  Returns the widest instruction set the CPU supports.
+     */
+    static Isa detect();
+
+    /**
+     *  Returns true if the CPU supports the instruction set.
+     */
+    static bool supports(Isa isa);
+
+    /**
+     *  Returns the variant accumulate() currently uses.
+     */
+    static Isa getIsa();
+
+    /**
+     *  Forces a variant, for benchmarks and comparisons. Returns false and
+     *  changes nothing if the CPU does not support it. Must not be called
+     *  while another thread is using the kernel.
+     */
+    static bool setIsa(Isa isa);
+
+    /**
+     *  Returns the name of the instruction set.
+     */
+    static const char* getName(Isa isa);
+
+};
+
+/**
+ *  Adds sum(m[j] * d / |d|^3) over the sources j in [0, count) to
+ *  field[0, D), where d is the vector from p to source j and the
+ *  sources' coordinates are given as D parallel arrays. In 2D this is
+ *  accumulate() above; in other dimensions a portable loop with every
+ *  coordinate unrolled at compile time.
+ */
+template <size_t D>
+void GravityKernel::accumulate(const double *const *pos, const double *m,
+                               size_t count, const double *p,
+                               double *field) {
+    double sum[D] = {};
+    for (size_t j = 0; j < count; ++j) {
+        double d[D], distSq = 0;
+        auto difference = [&](size_t k) {
+            d[k] = pos[k][j] - p[k];
+            distSq += d[k] * d[k];
+        };
+        Unroll<D>::apply(difference);
+        if (distSq > 0) {
+            double scale = m[j] / (distSq * std::sqrt(distSq));
+            auto add = [&](size_t k) {
+                sum[k] += d[k] * scale;
+            };
+            Unroll<D>::apply(add);
+        }
+    }
+    auto store = [&](size_t k) {
+        field[k] += sum[k];
+    };
+    Unroll<D>::apply(store);
+}
+
+template <>
+inline void GravityKernel::accumulate<2>(const double *const *pos,
+                                         const double *m, size_t count,
+                                         const double *p, double *field) {
+    accumulate(pos[0], pos[1], m, count, p[0], p[1], field[0], field[1]);
+}
+
+#endif
@@ -0,0 +1,277 @@
+/**
+ * @file: Integrator.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the integrator classes
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "Integrator.h"
+#include "Universe.h"
+#include "Visitor.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Destructor
+ */
+Integrator::~Integrator() {}
+
+/**
+ * Destructor
+ */
+EulerIntegrator::~EulerIntegrator() {}
+
+/**
+ * Advances the universe by the given number of seconds
+ */
+void EulerIntegrator::step(double seconds, Universe &universe) {
+    universe.kickDrift(seconds);
+}
+
+/**
+ * Destructor
+ */
+LeapfrogIntegrator::~LeapfrogIntegrator() {}
+
+/**
+ * Advances the universe by the given number of seconds
+ */
+void LeapfrogIntegrator::step(double seconds, Universe &universe) {
+    universe.drift(seconds / 2);
+    universe.kick(seconds);
+    universe.drift(seconds / 2);
+}
+
+/**
+ * Destructor
+ */
+VelocityVerletIntegrator::~VelocityVerletIntegrator() {}
+
+/**
+ * Advances the universe by the given number of seconds
+ */
+void VelocityVerletIntegrator::step(double seconds, Universe &universe) {
+    universe.kick(seconds / 2);
+    universe.drift(seconds);
+    universe.kick(seconds / 2);
+}
+
+/**
+ * Destructor
+ */
+YoshidaIntegrator::~YoshidaIntegrator() {}
+
+/**
+ * Advances the universe by the given number of seconds
+ */
+void YoshidaIntegrator::step(double seconds, Universe &universe) {
+    static const double w1 = 1 / (2 - std::cbrt(2.0));
+    static const double w0 = -std::cbrt(2.0) * w1;
+    static const double drifts[] = {w1 / 2, (w0 + w1) / 2, (w0 + w1) / 2,
+                                    w1 / 2};
+    static const double kicks[] = {w1, w0, w1};
+    for (int i = 0; i < 3; ++i) {
+        universe.drift(drifts[i] * seconds);
+        universe.kick(kicks[i] * seconds);
+    }
+    universe.drift(drifts[3] * seconds);
+}
+
+/**
+ * Creates an integrator with the given deepest level and accuracy
+ * parameter
+ */
+BlockTimestepIntegrator::BlockTimestepIntegrator(int maxLevel, double eta) :
+    maxLevel_(std::min(std::max(maxLevel, 0), 30)), eta_(eta),
+    forces_(nullptr), time_(0), evaluations_(0) {}
+
+/**
+ * Destructor
+ */
+BlockTimestepIntegrator::~BlockTimestepIntegrator() {}
+
+/**
+ * Advances the universe by the given number of seconds
+ */
+void BlockTimestepIntegrator::step(double seconds, Universe &universe) {
+    size_t count = universe.end() - universe.begin();
+    BodyStore &bodies = universe.getBodies();
+    if (level_.size() != count || ax_.size() != bodies.size()) {
+        level_.assign(count, maxLevel_);
+        stamp_.assign(count, -1);
+        ax_.assign(bodies.size(), 0);
+        ay_.assign(bodies.size(), 0);
+        lastAx_.assign(bodies.size(), 0);
+        lastAy_.assign(bodies.size(), 0);
+        active_.reserve(count);
+    }
+
+    // Time is counted in ticks of the deepest level; an object at level l
+    // ends its steps at the multiples of ticks >> l.
+    size_t ticks = size_t(1) << maxLevel_;
+    double tick = seconds / ticks;
+    active_.clear();
+    for (size_t i = 0; i < count; ++i) {
+        active_.push_back(i);
+    }
+    if (!isCurrent(universe)) {
+        evaluate(universe);
+    }
+
+    size_t now = 0;
+    while (true) {
+        // Close the finished steps and open the next ones with the same
+        // forces.
+        for (size_t a = 0; a < active_.size(); ++a) {
+            size_t i = active_[a];
+            double kick = 0;
+            if (now > 0) {
+                kick += tick * (ticks >> level_[i]) / 2;
+            }
+            if (now < ticks) {
+                chooseLevel(universe, i, now, seconds);
+                kick += tick * (ticks >> level_[i]) / 2;
+            }
+            size_t first, last;
+            (*(universe.begin() + i))->getSlots(first, last);
+            for (size_t s = first; s < last; ++s) {
+                bodies.vx[s] += ax_[s] * kick;
+                bodies.vy[s] += ay_[s] * kick;
+            }
+        }
+        if (now == ticks) {
+            // Every object ends its step here, so the last evaluation
+            // covered every body and opens the next call.
+            remember(universe);
+            break;
+        }
+
+        size_t next = ticks;
+        for (size_t i = 0; i < count; ++i) {
+            size_t stride = ticks >> level_[i];
+            next = std::min(next, (now / stride + 1) * stride);
+        }
+        universe.drift((next - now) * tick);
+        time_ += (next - now) * tick;
+        now = next;
+
+        active_.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (now % (ticks >> level_[i]) == 0) {
+                active_.push_back(i);
+            }
+        }
+        evaluate(universe);
+    }
+}
+
+/**
+ * Returns the number of bodies whose force has been evaluated so far
+ */
+size_t BlockTimestepIntegrator::getForceEvaluations() const {
+    return evaluations_;
+}
+
+/**
+ * Returns the current level of the registered object at index
+ */
+int BlockTimestepIntegrator::getLevel(size_t index) const {
+    return level_[index];
+}
+
+/**
+ * Evaluates the accelerations of the bodies of the active objects
+ */
+void BlockTimestepIntegrator::evaluate(Universe &universe) {
+    size_t targets = 0;
+    std::for_each(active_.begin(), active_.end(), [&](size_t i){
+        size_t first, last;
+        (*(universe.begin() + i))->getSlots(first, last);
+        targets += last - first;
+    });
+    universe.getForceStrategy()->prepareFor(universe.getBodies(), targets);
+    AccelerationVisitor accelerator(ax_, ay_);
+    universe.visitObjects(accelerator, active_);
+    evaluations_ += targets;
+}
+
+/**
+ * Returns true if ax_ and ay_ hold the accelerations of every body of
+ * the universe as it is, i.e. nothing has changed since remember()
+ */
+bool BlockTimestepIntegrator::isCurrent(Universe &universe) const {
+    const BodyStore &bodies = universe.getBodies();
+    size_t count = universe.end() - universe.begin();
+    if (objects_.size() != count || x_.size() != bodies.size()
+            || forces_ != universe.getForceStrategy()) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const Object *obj = *(universe.begin() + i);
+        if (objects_[i] != obj || strategies_[i] != obj->getStrategy()) {
+            return false;
+        }
+    }
+    return x_ == bodies.x && y_ == bodies.y && mass_ == bodies.mass;
+}
+
+/**
+ * Records the scene for which ax_ and ay_ hold every acceleration
+ */
+void BlockTimestepIntegrator::remember(Universe &universe) {
+    const BodyStore &bodies = universe.getBodies();
+    objects_.assign(universe.begin(), universe.end());
+    strategies_.clear();
+    std::for_each(universe.begin(), universe.end(), [&](Object *obj){
+        strategies_.push_back(obj->getStrategy());
+    });
+    forces_ = universe.getForceStrategy();
+    x_ = bodies.x;
+    y_ = bodies.y;
+    mass_ = bodies.mass;
+}
+
+/**
+ * Picks a new level for the object at index, tick ticks into a step of
+ * the given number of seconds, and records its acceleration
+ */
+void BlockTimestepIntegrator::chooseLevel(Universe &universe, size_t index,
+                                          size_t tick, double seconds) {
+    // The opening evaluation of a call repeats the closing one of the
+    // previous call, which says nothing about the jerk.
+    if (time_ <= stamp_[index]) {
+        return;
+    }
+    size_t first, last;
+    (*(universe.begin() + index))->getSlots(first, last);
+    double limit = seconds;
+    if (stamp_[index] >= 0) {
+        double elapsed = time_ - stamp_[index];
+        for (size_t s = first; s < last; ++s) {
+            double accel = std::hypot(ax_[s], ay_[s]);
+            double jerk = std::hypot(ax_[s] - lastAx_[s],
+                ay_[s] - lastAy_[s]) / elapsed;
+            if (eta_ * accel < limit * jerk) {
+                limit = eta_ * accel / jerk;
+            }
+        }
+        int level = 0;
+        while (level < maxLevel_ && seconds / (size_t(1) << level) > limit) {
+            ++level;
+        }
+        size_t ticks = size_t(1) << maxLevel_;
+        if (level > level_[index]) {
+            level_[index] = level;
+        }
+        if (level_[index] > level
+                && tick % (ticks >> (level_[index] - 1)) == 0) {
+            --level_[index];
+        }
+    }
+    for (size_t s = first; s < last; ++s) {
+        lastAx_[s] = ax_[s];
+        lastAy_[s] = ay_[s];
+    }
+    stamp_[index] = time_;
+}
@@ -0,0 +1,253 @@
+/**
+ * @file: Integrator.h
+ * @author Ethan Raymond
+ * @Description: This file declares the integrator classes
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef _INTEGRATOR_H_
+#define _INTEGRATOR_H_
+
+#include <cstdlib>
+#include <vector>
+
+// Forward declaration
+class Universe;
+class Object;
+class AggregateStrategy;
+class ForceStrategy;
+
+/**
+ *  Advances the bodies of the Universe by one time step of the
+ *  double-buffered step mode. An integrator is a sequence of the Universe's
+ *  kick (update velocities from the forces at the current positions) and
+ *  drift (update positions from the current velocities) operations, so its
+ *  cost is dominated by the number of kicks, each of which is one force
+ *  evaluation.
+ */
+class Integrator {
+public:
+
+    /**
+     * Destructor
+     */
+    virtual ~Integrator() = 0;
+
+    /**
+     * Advances the universe by the given number of seconds
+     */
+    virtual void step(double seconds, Universe &universe) = 0;
+
+};
+
+/**
+ *  Semi-implicit Euler: a full kick followed by a full drift, fused into a
+ *  single pass through the Universe's back buffer. First order, one force
+ *  evaluation per step. This is the scheme the cloning step uses and the
+ *  default.
+ */
+class EulerIntegrator : public Integrator {
+public:
+
+    /**
+     * Destructor
+     */
+    ~EulerIntegrator();
+
+    /**
+     * Advances the universe by the given number of seconds
+     */
+    void step(double seconds, Universe &universe);
+
+};
+
+/**
+ *  Drift-kick-drift leapfrog. Second order and time-reversible, one force
+ *  evaluation per step.
+ */
+class LeapfrogIntegrator : public Integrator {
+public:
+
+    /**
+     * Destructor
+     */
+    ~LeapfrogIntegrator();
+
+    /**
+     * Advances the universe by the given number of seconds
+     */
+    void step(double seconds, Universe &universe);
+
+};
+
+/**
+ *  Kick-drift-kick velocity Verlet. Second order like leapfrog, but
+ *  positions and velocities are synchronized at the end of every step. It
+ *  evaluates the forces twice per step, since the force of the closing
+ *  kick is not kept for the opening kick of the next step.
+ */
+class VelocityVerletIntegrator : public Integrator {
+public:
+
+    /**
+     * Destructor
+     */
+    ~VelocityVerletIntegrator();
+
+    /**
+     * Advances the universe by the given number of seconds
+     */
+    void step(double seconds, Universe &universe);
+
+};
+
+/**
+ *  Yoshida's fourth order scheme: three leapfrog steps of 1.35, -1.70 and
+ *  1.35 times the step, merged into four drifts and three kicks. Three
+ *  force evaluations per step, but the error falls with the fourth power of
+ *  the step, so it allows far larger steps for the same energy error.
+ */
+class YoshidaIntegrator : public Integrator {
+public:
+
+    /**
+     * Destructor
+     */
+    ~YoshidaIntegrator();
+
+    /**
+     * Advances the universe by the given number of seconds
+     */
+    void step(double seconds, Universe &universe);
+
+};
+
+/**
+ *  Kick-drift-kick leapfrog with hierarchical power-of-two block time
+ *  steps. Each registered object steps at seconds / 2^level for a level
+ *  between 0 and maxLevel, chosen from the acceleration a and jerk j of its
+ *  bodies so that the step stays under eta * |a| / |j|. The jerk is the
+ *  change in acceleration since the object's previous force evaluation.
+ *  All bodies drift together, but only the objects at the end of their own
+ *  step have their forces evaluated and are kicked, so tightly bound
+ *  clusters take many small steps while slow bodies take a few large ones.
+ *
+ *  An object may move to any finer level at the end of any of its steps,
+ *  but only one level coarser, and only where the coarser step boundaries
+ *  line up. This keeps a body starting from rest, whose jerk is still
+ *  small, from leaping to a step it cannot take. Levels persist between
+ *  calls; new objects start at maxLevel. Every object is kicked at the
+ *  start and end of each call, so velocities are synchronized between
+ *  steps. The opening kick of a call reuses the accelerations of the
+ *  previous call's closing evaluation unless the scene has changed since,
+ *  and the force strategy is prepared with prepareFor() the active bodies,
+ *  so small active sets need not rebuild a tree over every body.
+ */
+class BlockTimestepIntegrator : public Integrator {
+public:
+
+    /**
+     * Creates an integrator with the given deepest level and accuracy
+     * parameter
+     */
+    BlockTimestepIntegrator(int maxLevel = 16, double eta = 0.02);
+
+    /**
+     * Destructor
+     */
+    ~BlockTimestepIntegrator();
+
+    /**
+     * Advances the universe by the given number of seconds
+     */
+    void step(double seconds, Universe &universe);
+
+    /**
+     * Returns the number of bodies whose force has been evaluated so far
+     */
+    size_t getForceEvaluations() const;
+
+    /**
+     * Returns the current level of the registered object at index
+     */
+    int getLevel(size_t index) const;
+
+private:
+
+    /**
+     * Evaluates the accelerations of the bodies of the active objects
+     */
+    void evaluate(Universe &universe);
+
+    /**
+     * Returns true if ax_ and ay_ hold the accelerations of every body of
+     * the universe as it is, i.e. nothing has changed since remember()
+     */
+    bool isCurrent(Universe &universe) const;
+
+    /**
+     * Records the scene for which ax_ and ay_ hold every acceleration
+     */
+    void remember(Universe &universe);
+
+    /**
+     * Picks a new level for the object at index, tick ticks into a step of
+     * the given number of seconds, and records its acceleration
+     */
+    void chooseLevel(Universe &universe, size_t index, size_t tick,
+                     double seconds);
+
+    /**
+     * Deepest level
+     */
+    int maxLevel_;
+
+    /**
+     * Accuracy parameter
+     */
+    double eta_;
+
+    /**
+     * Level of every registered object
+     */
+    std::vector<int> level_;
+
+    /**
+     * Time of every object's last recorded acceleration, or a negative
+     * value before the first one
+     */
+    std::vector<double> stamp_;
+
+    /**
+     * Last evaluated and last recorded accelerations, by store slot
+     */
+    std::vector<double> ax_, ay_, lastAx_, lastAy_;
+
+    /**
+     * Indices of the objects at the end of their step
+     */
+    std::vector<size_t> active_;
+
+    /**
+     * Objects, their aggregate strategies, the force strategy and the
+     * bodies' positions and masses as of remember()
+     */
+    std::vector<const Object*> objects_;
+    std::vector<const AggregateStrategy*> strategies_;
+    const ForceStrategy *forces_;
+    std::vector<double> x_, y_, mass_;
+
+    /**
+     * Time since the integrator started
+     */
+    double time_;
+
+    /**
+     * Number of bodies whose force has been evaluated
+     */
+    size_t evaluations_;
+
+};
+
+#endif
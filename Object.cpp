@@ -7,19 +7,45 @@
 */
 
 #include "Object.h"
+#include "Profiler.h"
 #include <cmath>
+#include <memory>
 
  /**
- *  Initializes an object with the provided properties.
+ *  Initializes an object of the given kind with the provided
+ *  properties.
+ */
+Object::Object(const std::string &name, double mass, Kind kind) :
+        store_(nullptr), slot_(0),
+            nameId_(ObjectPool::instance().intern(name)), kind_(kind),
+            mass_(mass) {}
+
+/**
+ *  Initializes a detached copy of other, with the same name ID.
  */
-Object::Object(const std::string &name, double mass) :
-        name_(name), mass_(mass) {}
+Object::Object(const Object &other) : store_(nullptr), slot_(0),
+        nameId_(other.nameId_), kind_(other.kind_), mass_(other.mass_) {}
 
 /**
  *  Destroys this object.
  */
 Object::~Object() {}
 
+/**
+ *  Allocates objects from the ObjectPool.
+ */
+void* Object::operator new(size_t size) {
+    PROFILE_COUNT(ALLOCATIONS, 1);
+    return ObjectPool::instance().allocate(size);
+}
+
+/**
+ *  Returns the memory of a destroyed object to the ObjectPool.
+ */
+void Object::operator delete(void *ptr, size_t size) {
+    ObjectPool::instance().deallocate(ptr, size);
+}
+
 /**
  *  Returns the mass.
  */
@@ -28,10 +54,25 @@ double Object::getMass() const {
 }
 
 /**
- *  Returns the name.
+ *  Returns the concrete type of this object.
+ */
+Object::Kind Object::getKind() const {
+    return kind_;
+}
+
+/**
+ *  Returns the name, resolved from the ObjectPool's table.
  */
-std::string Object::getName() const {
-    return name_;
+const std::string& Object::getName() const {
+    return ObjectPool::instance().getName(nameId_);
+}
+
+/**
+ *  Returns the ID of the name in the ObjectPool's table. Objects have
+ *  the same ID exactly when they have the same name.
+ */
+uint32_t Object::getNameId() const {
+    return nameId_;
 }
 
 /**
@@ -46,11 +87,20 @@ AggregateStrategy* Object::getStrategy() const {
     return nullptr;
 }
 
+/**
+ *  Sets [first, last) to the store slots this object occupies. The range
+ *  is empty when the object is not attached to a store.
+ */
+void Object::getSlots(size_t &first, size_t &last) const {
+    first = slot_;
+    last = store_ != nullptr ? slot_ + 1 : slot_;
+}
+
  /**
  *  Initializes an object with the provided properties.
  */
 ImmobileObject::ImmobileObject(const std::string &name, double mass,
-        const vector2 &pos) : Object(name, mass), position_(pos) {}
+        const vector2 &pos) : Object(name, mass, IMMOBILE), position_(pos) {}
 
 /**
  *  Destroys this object.
@@ -69,13 +119,18 @@ void ImmobileObject::accept(Visitor& visitor) {
  *  copy of this object.
  */
 ImmobileObject* ImmobileObject::clone() const {
-    return new ImmobileObject(*this);
+    ImmobileObject *copy = new ImmobileObject(*this);
+    copy->position_ = getPosition();
+    return copy;
 }
 
 /**
  *  Returns the position vector.
  */
 vector2 ImmobileObject::getPosition() const {
+    if (store_ != nullptr) {
+        return store_->getPosition(slot_);
+    }
     return position_;
 }
 
@@ -83,14 +138,18 @@ vector2 ImmobileObject::getPosition() const {
  *  Returns the velocity vector.
  */
 vector2 ImmobileObject::getVelocity() const {
-    return 0;
+    return vector2();
 }
 
 /**
  *  Sets the position vector.
  */
 void ImmobileObject::setPosition(const vector2& pos) {
-    position_ = pos;
+    if (store_ != nullptr) {
+        store_->setPosition(slot_, pos);
+    } else {
+        position_ = pos;
+    }
 }
 
 /**
@@ -98,13 +157,23 @@ void ImmobileObject::setPosition(const vector2& pos) {
  */
 void ImmobileObject::setVelocity(const vector2& vel) {}
 
+/**
+ *  Binds this object to the given store slot.
+ */
+size_t ImmobileObject::attach(BodyStore &store, size_t slot) {
+    store.set(slot, getPosition(), vector2(), getMass());
+    store_ = &store;
+    slot_ = slot;
+    return slot + 1;
+}
+
 /**
  *  Returns true if this object is member-wise equal to rhs.
  */
 bool ImmobileObject::operator==(const Object &rhs) const {
-    if (dynamic_cast<const ImmobileObject*> (&rhs) != nullptr) {
-        return (getName() == rhs.getName() && getMass() == rhs.getMass()
-            && position_ == rhs.getPosition());
+    if (rhs.getKind() == IMMOBILE) {
+        return (getNameId() == rhs.getNameId() && getMass() == rhs.getMass()
+            && getPosition() == rhs.getPosition());
     }
     return false;
 }
@@ -120,7 +189,7 @@ bool ImmobileObject::operator!=(const Object &rhs) const {
  *  Initializes an object with the provided properties.
  */
 SimpleObject::SimpleObject(const std::string &name, double mass,
-        const vector2 &pos, const vector2 &vel) : Object(name, mass),
+        const vector2 &pos, const vector2 &vel) : Object(name, mass, SIMPLE),
             position_(pos), velocity_(vel) {}
 
 /**
@@ -140,13 +209,19 @@ void SimpleObject::accept(Visitor &visitor) {
  *  copy of this object.
  */
 SimpleObject* SimpleObject::clone() const {
-    return new SimpleObject(*this);
+    SimpleObject *copy = new SimpleObject(*this);
+    copy->position_ = getPosition();
+    copy->velocity_ = getVelocity();
+    return copy;
 }
 
 /**
  *  Returns the position vector.
  */
 vector2 SimpleObject::getPosition() const {
+    if (store_ != nullptr) {
+        return store_->getPosition(slot_);
+    }
     return position_;
 }
 
@@ -154,6 +229,9 @@ vector2 SimpleObject::getPosition() const {
  *  Returns the velocity vector.
  */
 vector2 SimpleObject::getVelocity() const {
+    if (store_ != nullptr) {
+        return store_->getVelocity(slot_);
+    }
     return velocity_;
 }
 
@@ -161,23 +239,41 @@ vector2 SimpleObject::getVelocity() const {
  *  Sets the position vector.
  */
 void SimpleObject::setPosition(const vector2 &pos) {
-    position_ = pos;
+    if (store_ != nullptr) {
+        store_->setPosition(slot_, pos);
+    } else {
+        position_ = pos;
+    }
 }
 
 /**
  *  Sets the velocity vector.
  */
 void SimpleObject::setVelocity(const vector2 &vel) {
-    velocity_ = vel;
+    if (store_ != nullptr) {
+        store_->setVelocity(slot_, vel);
+    } else {
+        velocity_ = vel;
+    }
+}
+
+/**
+ *  Binds this object to the given store slot.
+ */
+size_t SimpleObject::attach(BodyStore &store, size_t slot) {
+    store.set(slot, getPosition(), getVelocity(), getMass());
+    store_ = &store;
+    slot_ = slot;
+    return slot + 1;
 }
 
 /**
  *  Returns true if this object is member-wise equal to rhs.
  */
 bool SimpleObject::operator==(const Object &rhs) const {
-    if (dynamic_cast<const SimpleObject*>(&rhs) != nullptr) {
-        return (getName() == rhs.getName() && getMass() == rhs.getMass()
-            && position_ == rhs.getPosition());
+    if (rhs.getKind() == SIMPLE) {
+        return (getNameId() == rhs.getNameId() && getMass() == rhs.getMass()
+            && getPosition() == rhs.getPosition());
     }
     return false;
 }
@@ -190,18 +286,36 @@ bool SimpleObject::operator!=(const Object &rhs) const {
 }
 
  /**
- *  Initializes an object with the provided properties.
+ *  Initializes an object with the provided properties. The aggregate
+ *  takes ownership of the members.
  */
 AggregateObject::AggregateObject(const std::string &name,
-        std::vector<Object*> vec) : Object(name, getTotalMass(vec)),
-            position_(getAveragePosition(vec)),
-                velocity_(getAverageVelocity(vec)),vec_(vec),
-                    strategy_(new RigidStrategy) {}
+        const std::vector<Object*> &vec) :
+            Object(name, getTotalMass(vec), AGGREGATE),
+            vec_(vec), strategy_(new RigidStrategy), last_(0) {}
 
 /**
- *  Destroys this object.
+ *  Initializes a deep copy of other, with copies of its members and
+ *  strategy. The copy is not attached to a store.
  */
-AggregateObject::~AggregateObject() {}
+AggregateObject::AggregateObject(const AggregateObject &other) :
+        Object(other), strategy_(nullptr), last_(0) {
+    vec_.reserve(other.vec_.size());
+    std::for_each(other.begin(), other.end(), [&](Object *obj){
+        vec_.push_back(obj->clone());
+    });
+    if (other.strategy_ != nullptr) {
+        strategy_ = other.strategy_->clone();
+    }
+}
+
+/**
+ *  Destroys this object along with its members and strategy.
+ */
+AggregateObject::~AggregateObject() {
+    std::for_each(begin(), end(), std::default_delete<Object>());
+    delete strategy_;
+}
 
 /**
  *  An entry point for a visitor.
@@ -222,14 +336,14 @@ AggregateObject* AggregateObject::clone() const {
  *  returns the position vector.
  */
 vector2 AggregateObject::getPosition() const {
-    return getAveragePosition(vec_);
+    return getAveragePosition();
 }
 
 /**
  *  Returns the velocity vector.
  */
 vector2 AggregateObject::getVelocity() const {
-    return getAverageVelocity(vec_);
+    return getAverageVelocity();
 }
 
 /**
@@ -247,15 +361,14 @@ void AggregateObject::setAggregateStrategy(AggregateStrategy *strategy) {
 * Returns the strategy pointer
 */
 AggregateStrategy* AggregateObject::getStrategy() const {
-    return strategy_->clone();
+    return strategy_;
 }
 
 /**
  *  Sets the position vector.
  */
 void AggregateObject::setPosition(const vector2 &pos) {
-    vector2 change = pos - position_;
-    position_ = pos;
+    vector2 change = pos - getPosition();
     std::for_each(begin(), end(), [&](Object *obj){
         obj->setPosition(obj->getPosition() + change);
     });
@@ -265,20 +378,40 @@ void AggregateObject::setPosition(const vector2 &pos) {
  *  Sets the velocity vector.
  */
 void AggregateObject::setVelocity(const vector2 &vel) {
-    vector2 change = vel - velocity_;
-    velocity_ = vel;
+    vector2 change = vel - getVelocity();
     std::for_each(begin(), end(), [&](Object *obj){
         obj->setVelocity(obj->getVelocity() + change);
     });
 }
 
+/**
+ *  Binds every member to consecutive slots of the store.
+ */
+size_t AggregateObject::attach(BodyStore &store, size_t slot) {
+    store_ = &store;
+    slot_ = slot;
+    std::for_each(begin(), end(), [&](Object *obj){
+        slot = obj->attach(store, slot);
+    });
+    last_ = slot;
+    return slot;
+}
+
+/**
+ *  Sets [first, last) to the slots occupied by the members.
+ */
+void AggregateObject::getSlots(size_t &first, size_t &last) const {
+    first = slot_;
+    last = store_ != nullptr ? last_ : slot_;
+}
+
 /**
  *  Returns true if this object is member-wise equal to rhs.
  */
 bool AggregateObject::operator==(const Object &rhs) const {
-    if (dynamic_cast<const AggregateObject*>(&rhs) != nullptr) {
-        return (getName() == rhs.getName() && getMass() == rhs.getMass()
-            && position_ == rhs.getPosition());
+    if (rhs.getKind() == AGGREGATE) {
+        return (getNameId() == rhs.getNameId() && getMass() == rhs.getMass()
+            && getPosition() == rhs.getPosition());
     }
     return false;
 }
@@ -319,9 +452,9 @@ typename AggregateObject::const_iterator AggregateObject::end() const {
 }
 
 /**
- * returns the average mass
+ * returns the total mass
  */
-double AggregateObject::getTotalMass(std::vector<Object*> vec) const {
+double AggregateObject::getTotalMass(const std::vector<Object*> &vec) {
     double mass = 0;
     std::for_each(vec.begin(), vec.end(), [&](Object* obj){
         mass += obj->getMass();
@@ -332,21 +465,44 @@ double AggregateObject::getTotalMass(std::vector<Object*> vec) const {
 /**
  * returns the average position
  */
-vector2 AggregateObject::getAveragePosition(std::vector<Object*> vec) const {
+vector2 AggregateObject::getAveragePosition() const {
+    // Once attached, the members' bodies are the contiguous slots
+    // [slot_, last_), so the average is one pass over the store's columns
+    // rather than a virtual call per member.
     vector2 pos;
-    std::for_each(vec.begin(), vec.end(), [&](Object* obj){
-        pos += obj->getMass() * obj->getPosition();
-    });
-    return pos / getTotalMass(vec);
+    if (store_ != nullptr) {
+        const double *x = store_->x.data();
+        const double *y = store_->y.data();
+        const double *m = store_->mass.data();
+        for (size_t i = slot_; i < last_; ++i) {
+            pos[0] += m[i] * x[i];
+            pos[1] += m[i] * y[i];
+        }
+    } else {
+        std::for_each(begin(), end(), [&](Object* obj){
+            pos += obj->getMass() * obj->getPosition();
+        });
+    }
+    return pos / getMass();
 }
 
 /**
- * returns the average position
+ * returns the average velocity
  */
-vector2 AggregateObject::getAverageVelocity(std::vector<Object*> vec) const {
+vector2 AggregateObject::getAverageVelocity() const {
     vector2 vel;
-    std::for_each(vec.begin(), vec.end(), [&](Object* obj){
-        vel += obj->getMass() * obj->getVelocity();
-    });
-    return vel / getTotalMass(vec);
+    if (store_ != nullptr) {
+        const double *vx = store_->vx.data();
+        const double *vy = store_->vy.data();
+        const double *m = store_->mass.data();
+        for (size_t i = slot_; i < last_; ++i) {
+            vel[0] += m[i] * vx[i];
+            vel[1] += m[i] * vy[i];
+        }
+    } else {
+        std::for_each(begin(), end(), [&](Object* obj){
+            vel += obj->getMass() * obj->getVelocity();
+        });
+    }
+    return vel / getMass();
 }
\ No newline at end of file
@@ -11,8 +11,10 @@
 
 #include <string>
 #include "Vector.h"
+#include "BodyStore.h"
 #include "Visitor.h"
 #include "AggregateStrategy.h"
+#include "ObjectPool.h"
 
 // Forward declaration.
 class Visitor;
@@ -32,15 +34,32 @@ public:
     typedef std::vector<Object*>::const_iterator const_iterator;
 
     /**
-     *  Initializes an object with the provided properties.
+     *  Concrete type of an object, so that loops over many objects can
+     *  group them by type without a virtual call or a dynamic_cast.
+     */
+    enum Kind { IMMOBILE, SIMPLE, AGGREGATE };
+
+    /**
+     *  Initializes an object of the given kind with the provided
+     *  properties.
      */
-    Object(const std::string &name, double mass);
+    Object(const std::string &name, double mass, Kind kind);
 
     /**
      *  Destroys this object.
      */
     virtual ~Object();
 
+    /**
+     *  Allocates objects from the ObjectPool.
+     */
+    static void* operator new(size_t size);
+
+    /**
+     *  Returns the memory of a destroyed object to the ObjectPool.
+     */
+    static void operator delete(void *ptr, size_t size);
+
     /**
      *  An entry point for a visitor.
      */
@@ -63,9 +82,20 @@ public:
     virtual double getMass() const;
 
     /**
-     *  Returns the name.
+     *  Returns the concrete type of this object.
+     */
+    Kind getKind() const;
+
+    /**
+     *  Returns the name, resolved from the ObjectPool's table.
+     */
+    virtual const std::string& getName() const;
+
+    /**
+     *  Returns the ID of the name in the ObjectPool's table. Objects have
+     *  the same ID exactly when they have the same name.
      */
-    virtual std::string getName() const;
+    uint32_t getNameId() const;
 
     /**
      *  Returns the position vector.
@@ -92,6 +122,19 @@ public:
      */
     virtual void setVelocity(const vector2 &vel) = 0;
 
+    /**
+     *  Binds this object to the store starting at slot, writing its current
+     *  state there. From then on the object reads and writes its state
+     *  through the store. Returns the slot after the last one used.
+     */
+    virtual size_t attach(BodyStore &store, size_t slot) = 0;
+
+    /**
+     *  Sets [first, last) to the store slots this object occupies. The range
+     *  is empty when the object is not attached to a store.
+     */
+    virtual void getSlots(size_t &first, size_t &last) const;
+
     /**
      *  Returns true if this object is member-wise equal to rhs.
      */
@@ -102,12 +145,34 @@ public:
      */
     virtual bool operator!=(const Object &rhs) const = 0;
 
+protected:
+
+    /**
+     *  Initializes a detached copy of other, with the same name ID.
+     */
+    Object(const Object &other);
+
+    /**
+     *  Store holding the state of this object, or null when detached.
+     */
+    BodyStore *store_;
+
+    /**
+     *  Slot of this object in store_.
+     */
+    size_t slot_;
+
 private:
 
     /**
-     *  Name of the object.
+     *  ID of the object's name in the ObjectPool.
+     */
+    uint32_t nameId_;
+
+    /**
+     *  Concrete type of the object.
      */
-    std::string name_;
+    Kind kind_;
 
     /**
      *  Mass of the object in kilograms.
@@ -160,6 +225,11 @@ public:
      */
     virtual void setVelocity(const vector2 &vel);
 
+    /**
+     *  Binds this object to the given store slot.
+     */
+    virtual size_t attach(BodyStore &store, size_t slot);
+
     /**
      *  Returns true if this object is member-wise equal to rhs.
      */
@@ -173,7 +243,7 @@ public:
 private:
 
     /**
-     *  Position vector of the object in meters.
+     *  Position vector of the object in meters while detached.
      */
     vector2 position_;
 
@@ -224,6 +294,11 @@ public:
      */
     virtual void setVelocity(const vector2 &vel);
 
+    /**
+     *  Binds this object to the given store slot.
+     */
+    virtual size_t attach(BodyStore &store, size_t slot);
+
     /**
      *  Returns true if this object is member-wise equal to rhs.
      */
@@ -237,12 +312,12 @@ public:
 private:
 
     /**
-     *  Position vector of the object in meters.
+     *  Position vector of the object in meters while detached.
      */
     vector2 position_;
 
     /**
-     *  Velocity vector of the object in meters/second.
+     *  Velocity vector of the object in meters/second while detached.
      */
     vector2 velocity_;
 };
@@ -251,12 +326,19 @@ class AggregateObject : public Object {
 public:
 
     /**
-     *  Initializes an object with the provided properties.
+     *  Initializes an object with the provided properties. The aggregate
+     *  takes ownership of the members.
      */
-    AggregateObject(const std::string &name, std::vector<Object*> vec);
+    AggregateObject(const std::string &name, const std::vector<Object*> &vec);
 
     /**
-     *  Destroys this object.
+     *  Initializes a deep copy of other, with copies of its members and
+     *  strategy. The copy is not attached to a store.
+     */
+    AggregateObject(const AggregateObject &other);
+
+    /**
+     *  Destroys this object along with its members and strategy.
      */
     ~AggregateObject();
 
@@ -321,6 +403,16 @@ public:
      */
     virtual void setVelocity(const vector2 &vel);
 
+    /**
+     *  Binds every member to consecutive slots of the store.
+     */
+    virtual size_t attach(BodyStore &store, size_t slot);
+
+    /**
+     *  Sets [first, last) to the slots occupied by the members.
+     */
+    virtual void getSlots(size_t &first, size_t &last) const;
+
     /**
      *  Returns true if this object is member-wise equal to rhs.
      */
@@ -334,14 +426,9 @@ public:
 private:
 
     /**
-     *  Position vector of the object in meters.
+     *  The aggregate is not assignable.
      */
-    vector2 position_;
-    
-    /**
-     *  Velocity vector of the object in meters/second.
-     */
-    vector2 velocity_;
+    AggregateObject &operator=(const AggregateObject &rhs);
 
     /**
      * Vector containing the objects
@@ -353,22 +440,28 @@ private:
      **/
     AggregateStrategy* strategy_;
 
+    /**
+     *  End of the slots the members occupy in store_, which start at
+     *  slot_. Set by attach().
+     */
+    size_t last_;
+
     //Private methods to initialize private data members
 
     /**
-     * returns the average mass
+     * returns the total mass
      */
-    double getTotalMass(std::vector<Object*> vec) const;
+    static double getTotalMass(const std::vector<Object*> &vec);
 
     /**
      * returns the average position
      */
-    vector2 getAveragePosition(std::vector<Object*> vec) const;
+    vector2 getAveragePosition() const;
 
     /**
-     * returns the average position
+     * returns the average velocity
      */
-     vector2 getAverageVelocity(std::vector<Object*> vec) const;
+    vector2 getAverageVelocity() const;
 };
 
 #endif
@@ -0,0 +1,148 @@
+/**
+ * @file: ObjectPool.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the ObjectPool class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "ObjectPool.h"
+#include <new>
+#include <stdexcept>
+
+/**
+ *  Returns the pool shared by every object.
+ */
+ObjectPool& ObjectPool::instance() {
+    // Never destroyed, so objects may still be released during exit.
+    static ObjectPool *pool = new ObjectPool();
+    return *pool;
+}
+
+/**
+ *  Returns a block of at least size bytes.
+ */
+void* ObjectPool::allocate(size_t size) {
+    size_t c = (size + GRANULE - 1) / GRANULE;
+    if (!enabled_ || c >= CLASSES) {
+        void *ptr = ::operator new(size);
+        ++live_;
+        return ptr;
+    }
+    if (free_[c] == nullptr) {
+        grow(c);
+    }
+    Block *block = free_[c];
+    free_[c] = block->next;
+    ++live_;
+    return block;
+}
+
+/**
+ *  Returns the block at ptr, allocated with the given size, to the
+ *  pool.
+ */
+void ObjectPool::deallocate(void *ptr, size_t size) {
+    if (ptr == nullptr) {
+        return;
+    }
+    --live_;
+    size_t c = (size + GRANULE - 1) / GRANULE;
+    if (!enabled_ || c >= CLASSES) {
+        ::operator delete(ptr);
+        return;
+    }
+    Block *block = static_cast<Block*>(ptr);
+    block->next = free_[c];
+    free_[c] = block;
+}
+
+/**
+ *  Returns the ID of name, adding it to the table if it is new.
+ */
+uint32_t ObjectPool::intern(const std::string &name) {
+    std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool>
+        entry = ids_.insert(std::make_pair(name, uint32_t(names_.size())));
+    if (entry.second) {
+        names_.push_back(&entry.first->first);
+    }
+    return entry.first->second;
+}
+
+/**
+ *  Returns the name with the given ID, which stays valid until the
+ *  program exits.
+ */
+const std::string& ObjectPool::getName(uint32_t id) const {
+    return *names_[id];
+}
+
+/**
+ *  Selects whether blocks come from the slabs, the default, or straight
+ *  from the global allocator, for comparison. Throws std::logic_error
+ *  if any block is still allocated.
+ */
+void ObjectPool::setEnabled(bool enabled) {
+    if (live_ != 0) {
+        throw std::logic_error("object pool switched with live objects");
+    }
+    enabled_ = enabled;
+}
+
+/**
+ *  Returns true if blocks come from the slabs.
+ */
+bool ObjectPool::isEnabled() const {
+    return enabled_;
+}
+
+/**
+ *  Returns the number of blocks allocated and not yet returned.
+ */
+size_t ObjectPool::getLiveCount() const {
+    return live_;
+}
+
+/**
+ *  Returns the number of slabs allocated so far.
+ */
+size_t ObjectPool::getSlabCount() const {
+    return slabs_.size();
+}
+
+/**
+ *  Returns the number of distinct names interned so far.
+ */
+size_t ObjectPool::getNameCount() const {
+    return names_.size();
+}
+
+/**
+ *  Creates an empty pool.
+ */
+ObjectPool::ObjectPool() : live_(0), enabled_(true) {
+    for (size_t c = 0; c < CLASSES; ++c) {
+        free_[c] = nullptr;
+    }
+}
+
+/**
+ *  The pool lives until the program exits.
+ */
+ObjectPool::~ObjectPool() {}
+
+/**
+ *  Carves a new slab into free blocks of size class c.
+ */
+void ObjectPool::grow(size_t c) {
+    size_t size = c * GRANULE;
+    char *slab = static_cast<char*>(::operator new(size * SLAB_BLOCKS));
+    slabs_.push_back(slab);
+    // Link the blocks in address order so consecutive allocations are
+    // adjacent in memory.
+    for (size_t i = SLAB_BLOCKS; i > 0; --i) {
+        Block *block = reinterpret_cast<Block*>(slab + (i - 1) * size);
+        block->next = free_[c];
+        free_[c] = block;
+    }
+}
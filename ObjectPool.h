@@ -0,0 +1,159 @@
+/**
+ * @file: ObjectPool.h
+ * @author Ethan Raymond
+ * @Description: This file declares the ObjectPool class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef _OBJECT_POOL_H_
+#define _OBJECT_POOL_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ *  Slab allocator backing every Object, together with the table of
+ *  interned object names, which numbers the distinct names from 0 in
+ *  order of first use. Blocks are rounded up to a multiple of GRANULE
+ *  bytes, carved from slabs of SLAB_BLOCKS blocks of that size and
+ *  recycled through one free list per size, so cloning and releasing
+ *  objects at a steady rate stops reaching the global allocator once the
+ *  slabs have grown. Slabs and names are kept until the program exits.
+ *  Like the Universe, the pool is not thread safe: objects must be
+ *  created and destroyed by one thread at a time.
+ */
+class ObjectPool {
+public:
+
+    /**
+     *  Returns the pool shared by every object.
+     */
+    static ObjectPool& instance();
+
+    /**
+     *  Returns a block of at least size bytes.
+     */
+    void* allocate(size_t size);
+
+    /**
+     *  Returns the block at ptr, allocated with the given size, to the
+     *  pool.
+     */
+    void deallocate(void *ptr, size_t size);
+
+    /**
+     *  Returns the ID of name, adding it to the table if it is new.
+     */
+    uint32_t intern(const std::string &name);
+
+    /**
+     *  Returns the name with the given ID, which stays valid until the
+     *  program exits.
+     */
+    const std::string& getName(uint32_t id) const;
+
+    /**
+     *  Selects whether blocks come from the slabs, the default, or straight
+     *  from the global allocator, for comparison. Throws std::logic_error
+     *  if any block is still allocated.
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     *  Returns true if blocks come from the slabs.
+     */
+    bool isEnabled() const;
+
+    /**
+     *  Returns the number of blocks allocated and not yet returned.
+     */
+    size_t getLiveCount() const;
+
+    /**
+     *  Returns the number of slabs allocated so far.
+     */
+    size_t getSlabCount() const;
+
+    /**
+     *  Returns the number of distinct names interned so far.
+     */
+    size_t getNameCount() const;
+
+private:
+
+    /**
+     *  Size classes are multiples of this many bytes.
+     */
+    static const size_t GRANULE = 16;
+
+    /**
+     *  Number of size classes; larger blocks come from the global
+     *  allocator.
+     */
+    static const size_t CLASSES = 16;
+
+    /**
+     *  Number of blocks carved from each slab.
+     */
+    static const size_t SLAB_BLOCKS = 256;
+
+    /**
+     *  A free block, linking to the next free block of its size.
+     */
+    struct Block {
+        Block *next;
+    };
+
+    /**
+     *  Creates an empty pool.
+     */
+    ObjectPool();
+
+    /**
+     *  The pool lives until the program exits.
+     */
+    ~ObjectPool();
+
+    /**
+     *  Carves a new slab into free blocks of size class c.
+     */
+    void grow(size_t c);
+
+    /**
+     *  Head of the free list of each size class.
+     */
+    Block *free_[CLASSES];
+
+    /**
+     *  Every slab allocated so far.
+     */
+    std::vector<char*> slabs_;
+
+    /**
+     *  Blocks allocated and not yet returned.
+     */
+    size_t live_;
+
+    /**
+     *  True if blocks come from the slabs.
+     */
+    bool enabled_;
+
+    /**
+     *  ID of every interned name.
+     */
+    std::unordered_map<std::string, uint32_t> ids_;
+
+    /**
+     *  The keys of ids_ indexed by ID. Elements of an unordered_map never
+     *  move.
+     */
+    std::vector<const std::string*> names_;
+
+};
+
+#endif
@@ -0,0 +1,537 @@
+/**
+ * @file: Parser.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the Parser class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "Parser.h"
+#include "Universe.h"
+#include "Object.h"
+#include "Visitor.h"
+#include "AggregateStrategy.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ *  Powers of ten that doubles represent exactly.
+ */
+const double POWERS_OF_TEN[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+    1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+    1e21, 1e22};
+
+/**
+ *  Powers of ten that long doubles with a 64-bit mantissa represent
+ *  exactly.
+ */
+const long double LONG_POWERS_OF_TEN[] = {1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L,
+    1e6L, 1e7L, 1e8L, 1e9L, 1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L,
+    1e17L, 1e18L, 1e19L, 1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L,
+    1e27L};
+
+/**
+ *  True if long double holds every 19-digit integer and the powers above
+ *  exactly, which is not the case where it is the same as double.
+ */
+const bool LONG_DOUBLE_EXACT = std::numeric_limits<long double>::digits >= 64;
+
+/**
+ *  Largest integer up to which every integer is a double.
+ */
+const uint64_t EXACT_INTEGER = uint64_t(1) << 53;
+
+/**
+ *  A whole file mapped read-only into memory, unmapped on destruction.
+ */
+class Mapping {
+public:
+
+    /**
+     *  Maps the file. Throws std::runtime_error if it cannot be read.
+     */
+    Mapping(const char *filename) : data_(nullptr), size_(0) {
+        int fd = open(filename, O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            int error = errno;
+            if (fd >= 0) {
+                close(fd);
+            }
+            throw std::runtime_error(std::string(filename) + ": "
+                + std::strerror(error));
+        }
+        size_ = info.st_size;
+        if (size_ > 0) {
+            void *data = mmap(nullptr, size_, PROT_READ,
+                MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            if (data == MAP_FAILED) {
+                int error = errno;
+                close(fd);
+                throw std::runtime_error(std::string(filename) + ": "
+                    + std::strerror(error));
+            }
+            madvise(data, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(data);
+        }
+        close(fd);
+    }
+
+    /**
+     *  Unmaps the file.
+     */
+    ~Mapping() {
+        if (data_ != nullptr) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    /**
+     *  Returns the first byte of the file.
+     */
+    const char* begin() const {
+        return data_;
+    }
+
+    /**
+     *  Returns one past the last byte of the file.
+     */
+    const char* end() const {
+        return data_ + size_;
+    }
+
+private:
+
+    const char *data_;
+    size_t size_;
+
+};
+
+/**
+ *  Splits a script into lines and blank-separated tokens, in place.
+ */
+class Scanner {
+public:
+
+    /**
+     *  Creates a scanner over [begin, end), naming filename in errors.
+     */
+    Scanner(const char *begin, const char *end, const char *filename) :
+        p_(begin), lineEnd_(begin), end_(end), filename_(filename),
+        line_(0) {}
+
+    /**
+     *  Moves to the next line that holds a token. Returns false at the end
+     *  of the file.
+     */
+    bool nextLine() {
+        if (line_ > 0) {
+            p_ = lineEnd_ + 1;
+        }
+        while (p_ < end_) {
+            const void *newline = std::memchr(p_, '\n', end_ - p_);
+            lineEnd_ = newline != nullptr
+                ? static_cast<const char*>(newline) : end_;
+            ++line_;
+            skipBlanks();
+            if (p_ < lineEnd_ && *p_ != '#') {
+                return true;
+            }
+            p_ = lineEnd_ + 1;
+        }
+        return false;
+    }
+
+    /**
+     *  Returns true if the current line has no tokens left.
+     */
+    bool atLineEnd() {
+        skipBlanks();
+        return p_ == lineEnd_;
+    }
+
+    /**
+     *  Sets [start, start + length) to the next token of the line.
+     */
+    void token(const char *&start, size_t &length) {
+        if (atLineEnd()) {
+            fail("unexpected end of line");
+        }
+        start = p_;
+        while (p_ < lineEnd_ && !isBlank(*p_)) {
+            ++p_;
+        }
+        length = p_ - start;
+    }
+
+    /**
+     *  Returns the next token as a name.
+     */
+    std::string name() {
+        const char *start;
+        size_t length;
+        token(start, length);
+        return std::string(start, length);
+    }
+
+    /**
+     *  Returns the next token as a number.
+     */
+    double number() {
+        const char *start;
+        size_t length;
+        token(start, length);
+        return parseNumber(start, start + length);
+    }
+
+    /**
+     *  Fails if the current line has tokens left.
+     */
+    void endLine() {
+        if (!atLineEnd()) {
+            fail("unexpected text at end of line");
+        }
+    }
+
+    /**
+     *  Throws a std::runtime_error naming the file and current line.
+     */
+    void fail(const std::string &message) const {
+        throw std::runtime_error(std::string(filename_) + ":"
+            + std::to_string(line_) + ": " + message);
+    }
+
+private:
+
+    /**
+     *  Returns true for the characters separating tokens.
+     */
+    static bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    /**
+     *  Advances past blanks on the current line.
+     */
+    void skipBlanks() {
+        while (p_ < lineEnd_ && isBlank(*p_)) {
+            ++p_;
+        }
+    }
+
+    /**
+     *  Converts [s, e) to a double, correctly rounded. Numbers with at most
+     *  19 significant digits and a small power of ten are converted with a
+     *  single multiplication or division of exact operands: in double when
+     *  the digits fit its 53 bits, else in long double, whose result rounds
+     *  to the right double unless it lies exactly halfway between two. The
+     *  rest go through strtod on a copy kept on the stack.
+     */
+    double parseNumber(const char *s, const char *e) const {
+        const char *start = s;
+        bool negative = false;
+        if (s < e && (*s == '-' || *s == '+')) {
+            negative = *s++ == '-';
+        }
+        uint64_t mantissa = 0;
+        int digits = 0, exponent = 0;
+        bool any = false, fast = true;
+        for (; s < e && *s >= '0' && *s <= '9'; ++s, any = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*s - '0');
+                digits += mantissa != 0;
+            } else {
+                fast = false;
+            }
+        }
+        if (s < e && *s == '.') {
+            for (++s; s < e && *s >= '0' && *s <= '9'; ++s, any = true) {
+                if (digits < 19) {
+                    mantissa = mantissa * 10 + (*s - '0');
+                    digits += mantissa != 0;
+                    --exponent;
+                } else {
+                    fast = false;
+                }
+            }
+        }
+        if (any && s < e && (*s == 'e' || *s == 'E')) {
+            ++s;
+            bool negativeExponent = false;
+            if (s < e && (*s == '-' || *s == '+')) {
+                negativeExponent = *s++ == '-';
+            }
+            if (s == e || *s < '0' || *s > '9') {
+                any = false;
+            }
+            int value = 0;
+            for (; s < e && *s >= '0' && *s <= '9'; ++s) {
+                value = std::min(value * 10 + (*s - '0'), 100000);
+            }
+            exponent += negativeExponent ? -value : value;
+        }
+        if (!any || s != e) {
+            fail("malformed number '" + std::string(start, e) + "'");
+        }
+
+        while (fast && exponent > 22 && mantissa <= EXACT_INTEGER / 10) {
+            mantissa *= 10;
+            --exponent;
+        }
+        if (fast && mantissa <= EXACT_INTEGER && exponent >= -22
+                && exponent <= 22) {
+            double value = double(mantissa);
+            value = exponent < 0 ? value / POWERS_OF_TEN[-exponent]
+                : value * POWERS_OF_TEN[exponent];
+            return negative ? -value : value;
+        }
+
+        if (fast && LONG_DOUBLE_EXACT && exponent >= -27 && exponent <= 27) {
+            long double wide = mantissa;
+            wide = exponent < 0 ? wide / LONG_POWERS_OF_TEN[-exponent]
+                : wide * LONG_POWERS_OF_TEN[exponent];
+            double value = double(wide);
+            if (wide == value || wide != ((long double)value
+                    + std::nextafter(value, wide > value ? HUGE_VAL : 0)) / 2) {
+                return negative ? -value : value;
+            }
+        }
+
+        char copy[64];
+        if (size_t(e - start) < sizeof(copy)) {
+            std::memcpy(copy, start, e - start);
+            copy[e - start] = '\0';
+            return std::strtod(copy, nullptr);
+        }
+        return std::strtod(std::string(start, e).c_str(), nullptr);
+    }
+
+    const char *p_;
+    const char *lineEnd_;
+    const char *end_;
+    const char *filename_;
+    size_t line_;
+
+};
+
+/**
+ *  Returns true if [start, start + length) is word.
+ */
+bool matches(const char *start, size_t length, const char *word) {
+    return std::strlen(word) == length
+        && std::memcmp(start, word, length) == 0;
+}
+
+/**
+ *  Reads the object whose line starts with the given kind token.
+ */
+Object* readObject(Scanner &scanner, const char *kind, size_t length) {
+    if (matches(kind, length, "immobile")) {
+        std::string name = scanner.name();
+        double mass = scanner.number();
+        vector2 pos;
+        pos[0] = scanner.number();
+        pos[1] = scanner.number();
+        scanner.endLine();
+        return new ImmobileObject(name, mass, pos);
+    }
+
+    if (matches(kind, length, "simple")) {
+        std::string name = scanner.name();
+        double mass = scanner.number();
+        vector2 pos, vel;
+        pos[0] = scanner.number();
+        pos[1] = scanner.number();
+        vel[0] = scanner.number();
+        vel[1] = scanner.number();
+        scanner.endLine();
+        return new SimpleObject(name, mass, pos, vel);
+    }
+
+    if (!matches(kind, length, "aggregate")) {
+        scanner.fail("unknown object '" + std::string(kind, length) + "'");
+    }
+    std::string name = scanner.name();
+    bool realistic = false;
+    if (!scanner.atLineEnd()) {
+        const char *strategy;
+        size_t size;
+        scanner.token(strategy, size);
+        realistic = matches(strategy, size, "realistic");
+        if (!realistic && !matches(strategy, size, "rigid")) {
+            scanner.fail("unknown aggregate strategy '"
+                + std::string(strategy, size) + "'");
+        }
+        scanner.endLine();
+    }
+
+    std::vector<Object*> members;
+    try {
+        while (true) {
+            if (!scanner.nextLine()) {
+                scanner.fail("aggregate '" + name + "' has no end");
+            }
+            const char *token;
+            size_t size;
+            scanner.token(token, size);
+            if (matches(token, size, "end")) {
+                scanner.endLine();
+                break;
+            }
+            members.push_back(readObject(scanner, token, size));
+        }
+        if (members.empty()) {
+            scanner.fail("aggregate '" + name + "' has no members");
+        }
+    } catch (...) {
+        std::for_each(members.begin(), members.end(),
+            std::default_delete<Object>());
+        throw;
+    }
+
+    AggregateObject* aggregate = new AggregateObject(name, members);
+    if (realistic) {
+        aggregate->setAggregateStrategy(new RealisticStrategy());
+    }
+    return aggregate;
+}
+
+/**
+ *  A visitor that writes the visited objects as script lines.
+ */
+class ScriptWriter : public Visitor {
+public:
+
+    /**
+     *  Creates a writer appending to file.
+     */
+    ScriptWriter(FILE *file) : file_(file), depth_(0) {}
+
+    /**
+     *  Writes an immobile line.
+     */
+    void visit(ImmobileObject &object) {
+        vector2 pos = object.getPosition();
+        indent();
+        std::fprintf(file_, "immobile %s %.17g %.17g %.17g\n",
+            object.getName().c_str(), object.getMass(), pos[0], pos[1]);
+    }
+
+    /**
+     *  Writes a simple line.
+     */
+    void visit(SimpleObject &object) {
+        vector2 pos = object.getPosition();
+        vector2 vel = object.getVelocity();
+        indent();
+        std::fprintf(file_, "simple %s %.17g %.17g %.17g %.17g %.17g\n",
+            object.getName().c_str(), object.getMass(), pos[0], pos[1],
+            vel[0], vel[1]);
+    }
+
+    /**
+     *  Writes an aggregate block.
+     */
+    void visit(AggregateObject &object) {
+        bool realistic =
+            dynamic_cast<RealisticStrategy*>(object.getStrategy()) != nullptr;
+        indent();
+        std::fprintf(file_, "aggregate %s %s\n", object.getName().c_str(),
+            realistic ? "realistic" : "rigid");
+        ++depth_;
+        std::for_each(object.begin(), object.end(), [&](Object* obj){
+            obj->accept(*this);
+        });
+        --depth_;
+        indent();
+        std::fprintf(file_, "end\n");
+    }
+
+private:
+
+    /**
+     *  Indents by four spaces per enclosing aggregate.
+     */
+    void indent() {
+        for (int i = 0; i < depth_; ++i) {
+            std::fputs("    ", file_);
+        }
+    }
+
+    FILE *file_;
+    int depth_;
+
+};
+
+}
+
+/**
+ *  Loads the script file and configures the Universe. The syntax of
+ *  the scripts is given in the class comment. The file is mapped
+ *  into memory and parsed in place; numbers are converted without
+ *  copying them out of the mapping, so the only allocations are the
+ *  objects themselves. Throws std::runtime_error, naming the file and
+ *  line, if the file cannot be read or is malformed, in which case
+ *  nothing is added to the Universe.
+ */
+void Parser::loadFile(const char* filename) {
+    Mapping file(filename);
+    Scanner scanner(file.begin(), file.end(), filename);
+    std::vector<Object*> objects;
+    try {
+        while (scanner.nextLine()) {
+            const char *kind;
+            size_t length;
+            scanner.token(kind, length);
+            objects.push_back(readObject(scanner, kind, length));
+        }
+    } catch (...) {
+        std::for_each(objects.begin(), objects.end(),
+            std::default_delete<Object>());
+        throw;
+    }
+
+    Universe* univ(Universe::instance());
+    std::for_each(objects.begin(), objects.end(), [&](Object* obj){
+        univ->addObject(obj);
+    });
+}
+
+/**
+ *  Writes every object registered with the Universe to a script that
+ *  loadFile() reads back into identical objects. Numbers are written
+ *  with 17 significant digits, so they round-trip exactly. Throws
+ *  std::runtime_error if the file cannot be written.
+ */
+void Parser::saveFile(const char* filename) const {
+    FILE *file = std::fopen(filename, "w");
+    if (file == nullptr) {
+        throw std::runtime_error(std::string(filename) + ": "
+            + std::strerror(errno));
+    }
+    ScriptWriter writer(file);
+    Universe* univ(Universe::instance());
+    std::for_each(univ->begin(), univ->end(), [&](Object* obj){
+        obj->accept(writer);
+    });
+    bool failed = std::ferror(file) != 0;
+    if (std::fclose(file) != 0 || failed) {
+        throw std::runtime_error(std::string(filename) + ": write failed");
+    }
+}
@@ -4,16 +4,42 @@
 /**
  *  Class responsible for loading in custom setup scripts and configuring the
  *  Universe appropriately.
+ *
+ *  A script holds one object per line, with tokens separated by blanks.
+ *  Blank lines and lines starting with # are ignored. Names may not contain
+ *  blanks. Numbers use the usual decimal syntax, e.g. 1.98892e30.
+ *
+ *      immobile <name> <mass> <x> <y>
+ *      simple <name> <mass> <x> <y> <vx> <vy>
+ *      aggregate <name> [rigid | realistic]
+ *          <member lines>
+ *      end
+ *
+ *  Aggregates take the rigid strategy unless realistic is given, and may
+ *  be nested.
  */
 class Parser {
 public:
 
     /**
-     *  Loads the script file and configures the Universe. Consult the
-     *  assignment PDF for the syntax of the scripts.
+     *  Loads the script file and configures the Universe. The syntax of
+     *  the scripts is given in the class comment. The file is mapped
+     *  into memory and parsed in place; numbers are converted without
+     *  copying them out of the mapping, so the only allocations are the
+     *  objects themselves. Throws std::runtime_error, naming the file and
+     *  line, if the file cannot be read or is malformed, in which case
+     *  nothing is added to the Universe.
      */
     void loadFile(const char* filename);
 
+    /**
+     *  Writes every object registered with the Universe to a script that
+     *  loadFile() reads back into identical objects. Numbers are written
+     *  with 17 significant digits, so they round-trip exactly. Throws
+     *  std::runtime_error if the file cannot be written.
+     */
+    void saveFile(const char* filename) const;
+
 };
 
 #endif
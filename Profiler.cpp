@@ -0,0 +1,198 @@
+/**
+ * @file: Profiler.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the Profiler class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "Profiler.h"
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+
+namespace {
+
+/**
+ *  Nanoseconds spent in each phase and value of each counter, as added
+ *  by the threads of one shard. Every thread adds to a shard of its own,
+ *  shared only once there are more threads than shards, so the pool's
+ *  threads do not contend for one cache line; the totals are the sums
+ *  over the shards.
+ */
+struct alignas(64) Shard {
+    std::atomic<uint64_t> nanoseconds[Profiler::PHASES];
+    std::atomic<uint64_t> counts[Profiler::COUNTERS];
+};
+
+const int SHARDS = 64;
+Shard shards[SHARDS];
+std::atomic<int> nextShard(0);
+
+/**
+ *  Phase being timed on this thread, PHASES for none, and the time its
+ *  clock was last started.
+ */
+thread_local Profiler::Phase current = Profiler::PHASES;
+thread_local std::chrono::steady_clock::time_point started;
+thread_local Shard &shard = shards[nextShard.fetch_add(1) % SHARDS];
+
+const char* const PHASE_NAMES[Profiler::PHASES] = {
+    "step", "forces", "aggregate", "snapshot", "swap", "collisions",
+    "render"
+};
+
+const char* const COUNTER_NAMES[Profiler::COUNTERS] = {
+    "steps", "pairs", "allocations", "bytes_written"
+};
+
+/**
+ *  Stops the clock of the phase being timed on this thread, adding its
+ *  time since it was started, and returns the time it was stopped.
+ */
+std::chrono::steady_clock::time_point stop() {
+    std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    if (current != Profiler::PHASES) {
+        shard.nanoseconds[current].fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                now - started).count(), std::memory_order_relaxed);
+    }
+    return now;
+}
+
+}
+
+/**
+ *  Times the given phase from its construction to its destruction.
+ */
+Profiler::Scope::Scope(Phase phase) : phase_(phase), outer_(current) {
+    started = stop();
+    current = phase_;
+}
+
+Profiler::Scope::~Scope() {
+    started = stop();
+    current = outer_;
+}
+
+/**
+ *  Returns true if the tree was built with profiling.
+ */
+bool Profiler::isEnabled() {
+#ifdef UNIVERSE_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ *  Adds n to the given counter.
+ */
+void Profiler::count(Counter counter, uint64_t n) {
+    shard.counts[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+/**
+ *  Returns the nanoseconds spent in the given phase.
+ */
+uint64_t Profiler::getNanoseconds(Phase phase) {
+    uint64_t total = 0;
+    for (int s = 0; s < SHARDS; ++s) {
+        total += shards[s].nanoseconds[phase].load(
+            std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ *  Returns the value of the given counter.
+ */
+uint64_t Profiler::getCount(Counter counter) {
+    uint64_t total = 0;
+    for (int s = 0; s < SHARDS; ++s) {
+        total += shards[s].counts[counter].load(
+            std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ *  Returns the name of the phase or of the counter.
+ */
+const char* Profiler::getName(Phase phase) {
+    return PHASE_NAMES[phase];
+}
+
+const char* Profiler::getName(Counter counter) {
+    return COUNTER_NAMES[counter];
+}
+
+/**
+ *  Sets every time and counter to 0. Must not be called while a phase
+ *  is being timed.
+ */
+void Profiler::reset() {
+    for (int s = 0; s < SHARDS; ++s) {
+        for (int p = 0; p < PHASES; ++p) {
+            shards[s].nanoseconds[p].store(0, std::memory_order_relaxed);
+        }
+        for (int c = 0; c < COUNTERS; ++c) {
+            shards[s].counts[c].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ *  Writes a table of the phases' times and shares and of the
+ *  counters, with the counters per step.
+ */
+void Profiler::report(std::ostream &out) {
+    uint64_t total = 0;
+    for (int p = 0; p < PHASES; ++p) {
+        total += getNanoseconds(Phase(p));
+    }
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed;
+    out << std::left << std::setw(14) << "phase" << std::right
+        << std::setw(12) << "seconds" << std::setw(10) << "share" << "\n";
+    for (int p = 0; p < PHASES; ++p) {
+        uint64_t ns = getNanoseconds(Phase(p));
+        out << std::left << std::setw(14) << getName(Phase(p))
+            << std::right << std::setprecision(4) << std::setw(12)
+            << ns * 1e-9 << std::setprecision(1) << std::setw(9)
+            << (total == 0 ? 0.0 : 100.0 * ns / total) << "%\n";
+    }
+    uint64_t steps = getCount(STEPS);
+    out << std::left << std::setw(14) << "counter" << std::right
+        << std::setw(16) << "total" << std::setw(16) << "per step" << "\n";
+    for (int c = 0; c < COUNTERS; ++c) {
+        uint64_t n = getCount(Counter(c));
+        out << std::left << std::setw(14) << getName(Counter(c))
+            << std::right << std::setw(16) << n << std::setprecision(1)
+            << std::setw(16) << (steps == 0 ? 0.0 : double(n) / steps)
+            << "\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+/**
+ *  Writes the times and counters so far as one line of JSON, e.g. for
+ *  a log sampled every few steps.
+ */
+void Profiler::writeJson(std::ostream &out) {
+    out << "{\"seconds\":{";
+    for (int p = 0; p < PHASES; ++p) {
+        out << (p == 0 ? "" : ",") << '"' << getName(Phase(p)) << "\":"
+            << getNanoseconds(Phase(p)) * 1e-9;
+    }
+    out << "},\"counts\":{";
+    for (int c = 0; c < COUNTERS; ++c) {
+        out << (c == 0 ? "" : ",") << '"' << getName(Counter(c)) << "\":"
+            << getCount(Counter(c));
+    }
+    out << "}}\n";
+}
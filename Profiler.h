@@ -0,0 +1,122 @@
+/**
+ * @file: Profiler.h
+ * @author Ethan Raymond
+ * @Description: This file declares the Profiler class and the profiling
+    macros
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <cstdint>
+#include <ostream>
+
+/**
+ *  Times the phases of a step and counts the work done in them, for a
+ *  view of where a run spends its time. The code is instrumented with
+ *  PROFILE_PHASE and PROFILE_COUNT, which only do something when the
+ *  tree is built with UNIVERSE_PROFILE defined (cmake -DUNIVERSE_PROFILE=ON)
+ *  and otherwise compile to nothing, so the default build pays nothing.
+ *
+ *  Phase times are exclusive: a phase entered inside another stops the
+ *  outer one's clock until it is left, so the times add up to the time
+ *  spent in phases. Each thread keeps its own stack of phases, and a
+ *  phase entered on a pool thread is timed on that thread, so with
+ *  several threads the times add up to more than the elapsed time.
+ *  Totals are kept in relaxed atomics and may be read while a run is in
+ *  progress.
+ */
+class Profiler {
+public:
+
+    /**
+     *  Phases of a step. STEP is the part of stepSimulation() outside
+     *  the other phases, i.e. the integration itself.
+     */
+    enum Phase { STEP, FORCES, AGGREGATE, SNAPSHOT, SWAP, COLLISIONS,
+                 RENDER, PHASES };
+
+    /**
+     *  Counters: steps, pairs of bodies or of a body and a tree node
+     *  whose interaction was evaluated, Objects allocated and bytes
+     *  written to frames, trajectories and checkpoints.
+     */
+    enum Counter { STEPS, PAIRS, ALLOCATIONS, BYTES_WRITTEN, COUNTERS };
+
+    /**
+     *  Times the given phase from its construction to its destruction.
+     */
+    class Scope {
+    public:
+        explicit Scope(Phase phase);
+        ~Scope();
+
+    private:
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+
+        /**
+         *  Phase timed, and the phase it interrupted, or PHASES for none.
+         */
+        Phase phase_, outer_;
+    };
+
+    /**
+     *  Returns true if the tree was built with profiling.
+     */
+    static bool isEnabled();
+
+    /**
+     *  Adds n to the given counter.
+     */
+    static void count(Counter counter, uint64_t n);
+
+    /**
+     *  Returns the nanoseconds spent in the given phase.
+     */
+    static uint64_t getNanoseconds(Phase phase);
+
+    /**
+     *  Returns the value of the given counter.
+     */
+    static uint64_t getCount(Counter counter);
+
+    /**
+     *  Returns the name of the phase or of the counter.
+     */
+    static const char* getName(Phase phase);
+    static const char* getName(Counter counter);
+
+    /**
+     *  Sets every time and counter to 0. Must not be called while a phase
+     *  is being timed.
+     */
+    static void reset();
+
+    /**
+     *  Writes a table of the phases' times and shares and of the
+     *  counters, with the counters per step.
+     */
+    static void report(std::ostream &out);
+
+    /**
+     *  Writes the times and counters so far as one line of JSON, e.g. for
+     *  a log sampled every few steps.
+     */
+    static void writeJson(std::ostream &out);
+
+};
+
+#ifdef UNIVERSE_PROFILE
+#define PROFILE_PHASE(phase) \
+    Profiler::Scope profileScope_(Profiler::phase)
+#define PROFILE_COUNT(counter, n) \
+    Profiler::count(Profiler::counter, n)
+#else
+#define PROFILE_PHASE(phase) ((void)0)
+#define PROFILE_COUNT(counter, n) ((void)sizeof(n))
+#endif
+
+#endif
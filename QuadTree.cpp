@@ -0,0 +1,237 @@
+/**
+ * @file: QuadTree.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the QuadTree used by the Barnes-Hut force
+    strategy
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "QuadTree.h"
+#include "Universe.h"
+#include "Profiler.h"
+
+/**
+ *  Creates an empty tree.
+ */
+QuadTree::QuadTree() : bodies_(nullptr) {}
+
+/**
+ *  Destroys the tree. The bodies are not owned by the tree.
+ */
+QuadTree::~QuadTree() {}
+
+/**
+ *  Discards the previous contents and inserts every body of the store.
+ *  The store must outlive the tree's subsequent queries.
+ */
+void QuadTree::build(const BodyStore &bodies) {
+    nodes_.clear();
+    bodies_ = &bodies;
+    next_.assign(bodies.size(), -1);
+    if (bodies.size() == 0) {
+        return;
+    }
+
+    const double *x = bodies.x.data();
+    const double *y = bodies.y.data();
+    double minX = x[0], minY = y[0], maxX = x[0], maxY = y[0];
+    for (size_t i = 1; i < bodies.size(); ++i) {
+        minX = std::min(minX, x[i]);
+        maxX = std::max(maxX, x[i]);
+        minY = std::min(minY, y[i]);
+        maxY = std::max(maxY, y[i]);
+    }
+
+    // Pad the root slightly so bodies on the boundary fall inside it.
+    double half = std::max(maxX - minX, maxY - minY) / 2;
+    half = half * (1 + 1e-9) + 1;
+    addNode((minX + maxX) / 2, (minY + maxY) / 2, half);
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        insert(0, i, 0);
+    }
+    summarize(0);
+}
+
+/**
+ *  Returns the force experienced by a point of the given mass at pos
+ *  from every body outside the slots [first, last). Nodes whose size over
+ *  distance ratio is below theta are treated as a point mass at their
+ *  center of mass. Nodes overlapping the bounding box of pos and the
+ *  skipped slots are always opened.
+ */
+vector2 QuadTree::getForce(const vector2 &pos, double mass, size_t first,
+                           size_t last, double theta) const {
+    vector2 totalForce;
+    if (nodes_.empty()) {
+        return totalForce;
+    }
+
+    const double *x = bodies_->x.data();
+    const double *y = bodies_->y.data();
+    const double *m = bodies_->mass.data();
+    double px = pos[0], py = pos[1];
+    double minX = px, minY = py, maxX = px, maxY = py;
+    for (size_t i = first; i < last; ++i) {
+        minX = std::min(minX, x[i]);
+        maxX = std::max(maxX, x[i]);
+        minY = std::min(minY, y[i]);
+        maxY = std::max(maxY, y[i]);
+    }
+    double theta2 = theta * theta;
+    double fx = 0, fy = 0;
+    uint64_t pairs = 0;
+
+    int stack[4 * maxDepth + 4];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        int index = stack[--top];
+        const Node &node = nodes_[index];
+        if (node.mass == 0) {
+            continue;
+        }
+        if (node.child < 0) {
+            for (int b = node.body; b >= 0; b = next_[b]) {
+                size_t j = b;
+                double dx = x[j] - px;
+                double dy = y[j] - py;
+                double distSq = dx * dx + dy * dy;
+                if ((j < first || j >= last) && distSq > 0) {
+                    ++pairs;
+                    double dist = std::sqrt(distSq);
+                    double constant = Universe::G * (mass * m[j]) / distSq;
+                    fx += dx / dist * constant;
+                    fy += dy / dist * constant;
+                }
+            }
+            continue;
+        }
+
+        double dx = node.mx - px;
+        double dy = node.my - py;
+        double distSq = dx * dx + dy * dy;
+        double size = 2 * node.half;
+        bool open = size * size >= theta2 * distSq
+            || overlaps(index, minX, minY, maxX, maxY);
+        if (open) {
+            for (int c = 0; c < 4; ++c) {
+                stack[top++] = node.child + c;
+            }
+            continue;
+        }
+
+        // Same expression as Universe::getForce with the node as a point.
+        double dist = std::sqrt(distSq);
+        double constant = Universe::G * (mass * node.mass) / distSq;
+        fx += dx / dist * constant;
+        fy += dy / dist * constant;
+        ++pairs;
+    }
+    PROFILE_COUNT(PAIRS, pairs);
+    totalForce[0] = fx;
+    totalForce[1] = fy;
+    return totalForce;
+}
+
+/**
+ *  Returns the number of nodes in the tree.
+ */
+size_t QuadTree::size() const {
+    return nodes_.size();
+}
+
+/**
+ *  Appends an empty node and returns its index.
+ */
+int QuadTree::addNode(double cx, double cy, double half) {
+    Node node;
+    node.cx = cx;
+    node.cy = cy;
+    node.half = half;
+    node.mass = node.mx = node.my = 0;
+    node.child = -1;
+    node.body = -1;
+    nodes_.push_back(node);
+    return nodes_.size() - 1;
+}
+
+/**
+ *  Inserts body into the subtree rooted at node.
+ */
+void QuadTree::insert(int node, int body, int depth) {
+    while (nodes_[node].child >= 0) {
+        node = nodes_[node].child + quadrant(node, body);
+        ++depth;
+    }
+
+    if (nodes_[node].body < 0) {
+        nodes_[node].body = body;
+        return;
+    }
+
+    if (depth >= maxDepth) {
+        next_[body] = nodes_[node].body;
+        nodes_[node].body = body;
+        return;
+    }
+
+    // Split the leaf and push its body one level down. Note that addNode
+    // may reallocate, so nodes_[node] is re-read after every call.
+    int old = nodes_[node].body;
+    double half = nodes_[node].half / 2;
+    double cx = nodes_[node].cx;
+    double cy = nodes_[node].cy;
+    int child = addNode(cx - half, cy - half, half);
+    addNode(cx + half, cy - half, half);
+    addNode(cx - half, cy + half, half);
+    addNode(cx + half, cy + half, half);
+    nodes_[node].child = child;
+    nodes_[node].body = -1;
+    insert(child + quadrant(node, old), old, depth + 1);
+    insert(child + quadrant(node, body), body, depth + 1);
+}
+
+/**
+ *  Returns the index of the child of node containing body.
+ */
+int QuadTree::quadrant(int node, int body) const {
+    return (bodies_->x[body] >= nodes_[node].cx ? 1 : 0)
+        + (bodies_->y[body] >= nodes_[node].cy ? 2 : 0);
+}
+
+/**
+ *  Computes the mass and center of mass of the subtree rooted at node.
+ */
+void QuadTree::summarize(int node) {
+    double mass = 0, mx = 0, my = 0;
+    if (nodes_[node].child < 0) {
+        for (int b = nodes_[node].body; b >= 0; b = next_[b]) {
+            double m = bodies_->mass[b];
+            mass += m;
+            mx += m * bodies_->x[b];
+            my += m * bodies_->y[b];
+        }
+    } else {
+        for (int c = 0; c < 4; ++c) {
+            int child = nodes_[node].child + c;
+            summarize(child);
+            mass += nodes_[child].mass;
+            mx += nodes_[child].mass * nodes_[child].mx;
+            my += nodes_[child].mass * nodes_[child].my;
+        }
+    }
+    nodes_[node].mass = mass;
+    nodes_[node].mx = mass != 0 ? mx / mass : nodes_[node].cx;
+    nodes_[node].my = mass != 0 ? my / mass : nodes_[node].cy;
+}
+
+/**
+ *  Returns true if the box overlaps the cell of node.
+ */
+bool QuadTree::overlaps(int node, double minX, double minY, double maxX,
+                        double maxY) const {
+    const Node &n = nodes_[node];
+    return maxX >= n.cx - n.half && minX <= n.cx + n.half
+        && maxY >= n.cy - n.half && minY <= n.cy + n.half;
+}
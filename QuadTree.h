@@ -0,0 +1,117 @@
+/**
+ * @file: QuadTree.h
+ * @author Ethan Raymond
+ * @Description: This file declares the QuadTree used by the Barnes-Hut force
+    strategy
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef _QUAD_TREE_H_
+#define _QUAD_TREE_H_
+
+#include <vector>
+#include "Vector.h"
+#include "BodyStore.h"
+
+/**
+ *  A region quadtree over the slots of a BodyStore. Every node stores the
+ *  total mass and the center of mass of the bodies below it so that a far
+ *  away node can stand in for all of them. The nodes live in a single vector
+ *  which is reused from one build to the next.
+ */
+class QuadTree {
+public:
+
+    /**
+     *  Creates an empty tree.
+     */
+    QuadTree();
+
+    /**
+     *  Destroys the tree. The bodies are not owned by the tree.
+     */
+    ~QuadTree();
+
+    /**
+     *  Discards the previous contents and inserts every body of the store.
+     *  The store must outlive the tree's subsequent queries.
+     */
+    void build(const BodyStore &bodies);
+
+    /**
+     *  Returns the force experienced by a point of the given mass at pos
+     *  from every body outside the slots [first, last). Nodes whose size over
+     *  distance ratio is below theta are treated as a point mass at their
+     *  center of mass. Nodes overlapping the bounding box of pos and the
+     *  skipped slots are always opened.
+     */
+    vector2 getForce(const vector2 &pos, double mass, size_t first,
+                     size_t last, double theta) const;
+
+    /**
+     *  Returns the number of nodes in the tree.
+     */
+    size_t size() const;
+
+private:
+
+    /**
+     *  A square cell of the tree. Children are stored consecutively starting
+     *  at index child, in the order SW, SE, NW, NE.
+     */
+    struct Node {
+        double cx, cy, half;
+        double mass, mx, my;
+        int child;
+        int body;
+    };
+
+    /**
+     *  Appends an empty node and returns its index.
+     */
+    int addNode(double cx, double cy, double half);
+
+    /**
+     *  Inserts body into the subtree rooted at node.
+     */
+    void insert(int node, int body, int depth);
+
+    /**
+     *  Returns the index of the child of node containing body.
+     */
+    int quadrant(int node, int body) const;
+
+    /**
+     *  Computes the mass and center of mass of the subtree rooted at node.
+     */
+    void summarize(int node);
+
+    /**
+     *  Returns true if the box overlaps the cell of node.
+     */
+    bool overlaps(int node, double minX, double minY, double maxX,
+                  double maxY) const;
+
+    /**
+     *  Depth past which coincident bodies are chained in one leaf.
+     */
+    static const int maxDepth = 64;
+
+    /**
+     *  Node storage. Index 0 is the root.
+     */
+    std::vector<Node> nodes_;
+
+    /**
+     *  The store passed to the last build.
+     */
+    const BodyStore *bodies_;
+
+    /**
+     *  Next body in the same leaf, or -1.
+     */
+    std::vector<int> next_;
+};
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * @file: SpatialHash.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the SpatialHash class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "SpatialHash.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ *  Creates an empty hash.
+ */
+SpatialHash::SpatialHash() : cell_(1), mask_(0) {}
+
+/**
+ *  Sets pairs to every pair (i, j), i < j, of bodies of the store
+ *  whose discs of the given radii overlap, that is whose centers are
+ *  closer than the sum of their radii. Bodies of radius 0 never
+ *  overlap. The pairs are sorted.
+ */
+void SpatialHash::findOverlaps(const BodyStore &bodies,
+        const std::vector<double> &radius,
+        std::vector<std::pair<size_t, size_t> > &pairs) {
+    pairs.clear();
+    const double *x = bodies.x.data();
+    const double *y = bodies.y.data();
+    size_t n = bodies.size();
+    auto overlap = [&](size_t i, size_t j) {
+        double dx = x[j] - x[i], dy = y[j] - y[i];
+        double reach = radius[i] + radius[j];
+        return dx * dx + dy * dy < reach * reach;
+    };
+
+    scratch_.clear();
+    for (size_t i = 0; i < n; ++i) {
+        if (radius[i] > 0) {
+            scratch_.push_back(radius[i]);
+        }
+    }
+    if (scratch_.size() < 2) {
+        return;
+    }
+    std::nth_element(scratch_.begin(),
+        scratch_.begin() + scratch_.size() / 2, scratch_.end());
+    double limit = LARGE_RADIUS * scratch_[scratch_.size() / 2];
+
+    small_.clear();
+    large_.clear();
+    double largest = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (radius[i] > limit) {
+            large_.push_back(i);
+        } else if (radius[i] > 0) {
+            small_.push_back(i);
+            largest = std::max(largest, radius[i]);
+        }
+    }
+    cell_ = 2 * largest;
+
+    // Counting sort of the small bodies into the buckets.
+    size_t count = 1;
+    while (count < 2 * small_.size()) {
+        count *= 2;
+    }
+    mask_ = count - 1;
+    start_.assign(count + 1, 0);
+    buckets_.resize(small_.size());
+    for (size_t k = 0; k < small_.size(); ++k) {
+        size_t i = small_[k];
+        buckets_[k] = bucket(int64_t(std::floor(x[i] / cell_)),
+            int64_t(std::floor(y[i] / cell_)));
+        ++start_[buckets_[k] + 1];
+    }
+    for (size_t b = 0; b < count; ++b) {
+        start_[b + 1] += start_[b];
+    }
+    entries_.resize(small_.size());
+    for (size_t k = 0; k < small_.size(); ++k) {
+        entries_[start_[buckets_[k]]++] = small_[k];
+    }
+    // The fill advanced every start to the next bucket's; shift back.
+    for (size_t b = count; b > 0; --b) {
+        start_[b] = start_[b - 1];
+    }
+    start_[0] = 0;
+
+    // Overlapping small bodies lie in the same or adjacent cells. Distinct
+    // cells can share a bucket, which the final unique() absorbs.
+    for (size_t k = 0; k < small_.size(); ++k) {
+        size_t i = small_[k];
+        int64_t ix = int64_t(std::floor(x[i] / cell_));
+        int64_t iy = int64_t(std::floor(y[i] / cell_));
+        for (int64_t dx = -1; dx <= 1; ++dx) {
+            for (int64_t dy = -1; dy <= 1; ++dy) {
+                size_t b = bucket(ix + dx, iy + dy);
+                for (size_t e = start_[b]; e < start_[b + 1]; ++e) {
+                    size_t j = entries_[e];
+                    if (j > i && overlap(i, j)) {
+                        pairs.push_back(std::make_pair(i, j));
+                    }
+                }
+            }
+        }
+    }
+
+    for (size_t k = 0; k < large_.size(); ++k) {
+        size_t i = large_[k];
+        for (size_t j = 0; j < n; ++j) {
+            if (j != i && radius[j] > 0 && overlap(i, j)) {
+                pairs.push_back(std::make_pair(std::min(i, j),
+                    std::max(i, j)));
+            }
+        }
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+}
+
+/**
+ *  Returns the width of the cells used by the last query.
+ */
+double SpatialHash::getCellSize() const {
+    return cell_;
+}
+
+/**
+ *  Returns the bucket of the cell at column ix and row iy.
+ */
+size_t SpatialHash::bucket(int64_t ix, int64_t iy) const {
+    uint64_t h = uint64_t(ix) * 0x9e3779b97f4a7c15ULL
+        ^ uint64_t(iy) * 0xc2b2ae3d27d4eb4fULL;
+    h ^= h >> 29;
+    return size_t(h) & mask_;
+}
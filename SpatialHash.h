@@ -0,0 +1,102 @@
+/**
+ * @file: SpatialHash.h
+ * @author Ethan Raymond
+ * @Description: This file declares the SpatialHash class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef _SPATIAL_HASH_H_
+#define _SPATIAL_HASH_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include "BodyStore.h"
+
+/**
+ *  Uniform grid over the plane, hashed into a table of buckets and
+ *  rebuilt from scratch for every query in O(N), used to find the bodies
+ *  whose discs overlap. The cells are as wide as the largest disc among
+ *  the ordinary bodies, so overlapping ordinary bodies always lie in the
+ *  same or adjacent cells. Bodies far larger than the typical one, such
+ *  as a sun among planets, would make the cells huge; they are kept out
+ *  of the grid and tested against every other body instead. Buffers are
+ *  kept between queries, so a query allocates nothing once they have
+ *  grown.
+ */
+class SpatialHash {
+public:
+
+    /**
+     *  Creates an empty hash.
+     */
+    SpatialHash();
+
+    /**
+     *  Sets pairs to every pair (i, j), i < j, of bodies of the store
+     *  whose discs of the given radii overlap, that is whose centers are
+     *  closer than the sum of their radii. Bodies of radius 0 never
+     *  overlap. The pairs are sorted.
+     */
+    void findOverlaps(const BodyStore &bodies,
+                      const std::vector<double> &radius,
+                      std::vector<std::pair<size_t, size_t> > &pairs);
+
+    /**
+     *  Returns the width of the cells used by the last query.
+     */
+    double getCellSize() const;
+
+private:
+
+    /**
+     *  Bodies whose radius exceeds this many times the median are kept
+     *  out of the grid.
+     */
+    static const int LARGE_RADIUS = 8;
+
+    /**
+     *  Returns the bucket of the cell at column ix and row iy.
+     */
+    size_t bucket(int64_t ix, int64_t iy) const;
+
+    /**
+     *  Width of the cells.
+     */
+    double cell_;
+
+    /**
+     *  Number of buckets minus one; the count is a power of two.
+     */
+    size_t mask_;
+
+    /**
+     *  Bodies in the grid, grouped by bucket.
+     */
+    std::vector<size_t> entries_;
+
+    /**
+     *  Start of each bucket's bodies in entries_, plus the end.
+     */
+    std::vector<size_t> start_;
+
+    /**
+     *  Bucket of each body in the grid.
+     */
+    std::vector<size_t> buckets_;
+
+    /**
+     *  Bodies in the grid and bodies kept out of it.
+     */
+    std::vector<size_t> small_, large_;
+
+    /**
+     *  Scratch copy of the radii, for the median.
+     */
+    std::vector<double> scratch_;
+
+};
+
+#endif
@@ -0,0 +1,108 @@
+/**
+ * @file: ThreadPool.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the ThreadPool class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "ThreadPool.h"
+#include <algorithm>
+
+/**
+ *  Starts threads - 1 workers. A size of 0 uses the number of hardware
+ *  threads.
+ */
+ThreadPool::ThreadPool(size_t threads) : task_(nullptr), context_(nullptr),
+        count_(0), grain_(1), next_(0), generation_(0), busy_(0),
+        stop_(false) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 1; i < threads; ++i) {
+        workers_.push_back(std::thread(&ThreadPool::work, this));
+    }
+}
+
+/**
+ *  Stops and joins the workers.
+ */
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    std::for_each(workers_.begin(), workers_.end(), [](std::thread &t){
+        t.join();
+    });
+}
+
+/**
+ *  Returns the number of threads taking part in a job, including the
+ *  caller.
+ */
+size_t ThreadPool::size() const {
+    return workers_.size() + 1;
+}
+
+/**
+ *  Runs the job on the workers and the calling thread.
+ */
+void ThreadPool::run(Task task, void *context, size_t count, size_t grain) {
+    grain = std::max<size_t>(grain, 1);
+    if (workers_.empty() || count <= grain) {
+        task(context, 0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = task;
+        context_ = context;
+        count_ = count;
+        grain_ = grain;
+        next_ = 0;
+        busy_ = workers_.size();
+        ++generation_;
+    }
+    wake_.notify_all();
+    drain();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]{ return busy_ == 0; });
+}
+
+/**
+ *  Takes chunks of the current job until none are left.
+ */
+void ThreadPool::drain() {
+    while (true) {
+        size_t begin = next_.fetch_add(grain_);
+        if (begin >= count_) {
+            return;
+        }
+        task_(context_, begin, std::min(begin + grain_, count_));
+    }
+}
+
+/**
+ *  Worker thread body.
+ */
+void ThreadPool::work() {
+    size_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [&]{ return stop_ || generation_ != seen; });
+        if (stop_) {
+            return;
+        }
+        seen = generation_;
+        lock.unlock();
+        drain();
+        lock.lock();
+        if (--busy_ == 0) {
+            done_.notify_one();
+        }
+    }
+}
@@ -0,0 +1,148 @@
+/**
+ * @file: ThreadPool.h
+ * @author Ethan Raymond
+ * @Description: This file declares the ThreadPool class
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ *  A fixed set of worker threads that stay alive between jobs. A job is a
+ *  range of indices handed out in chunks of grain indices; the calling
+ *  thread takes chunks too, so a pool of size n runs n - 1 workers. Jobs
+ *  are passed as a plain function pointer and context so that submitting
+ *  one never allocates.
+ */
+class ThreadPool {
+public:
+
+    /**
+     *  Starts threads - 1 workers. A size of 0 uses the number of hardware
+     *  threads.
+     */
+    explicit ThreadPool(size_t threads);
+
+    /**
+     *  Stops and joins the workers.
+     */
+    ~ThreadPool();
+
+    /**
+     *  Returns the number of threads taking part in a job, including the
+     *  caller.
+     */
+    size_t size() const;
+
+    /**
+     *  Calls f(begin, end) on disjoint chunks covering [0, count) and
+     *  returns once every chunk is done. Chunks may run in any order and on
+     *  any thread.
+     */
+    template <typename F>
+    void parallelFor(size_t count, size_t grain, F &f);
+
+private:
+
+    /**
+     *  Type-erased chunk function.
+     */
+    typedef void (*Task)(void *context, size_t begin, size_t end);
+
+    /**
+     *  Calls a functor of type F on a chunk.
+     */
+    template <typename F>
+    static void call(void *context, size_t begin, size_t end);
+
+    /**
+     *  Runs the job on the workers and the calling thread.
+     */
+    void run(Task task, void *context, size_t count, size_t grain);
+
+    /**
+     *  Takes chunks of the current job until none are left.
+     */
+    void drain();
+
+    /**
+     *  Worker thread body.
+     */
+    void work();
+
+    /**
+     *  The worker threads.
+     */
+    std::vector<std::thread> workers_;
+
+    /**
+     *  Guards the job description and the counters below.
+     */
+    std::mutex mutex_;
+
+    /**
+     *  Signals the workers that a job was posted or the pool is stopping.
+     */
+    std::condition_variable wake_;
+
+    /**
+     *  Signals the caller that the last worker finished the job.
+     */
+    std::condition_variable done_;
+
+    /**
+     *  Current job.
+     */
+    Task task_;
+    void *context_;
+    size_t count_;
+    size_t grain_;
+
+    /**
+     *  First index not yet handed out.
+     */
+    std::atomic<size_t> next_;
+
+    /**
+     *  Incremented for every job so that workers can tell a new one apart.
+     */
+    size_t generation_;
+
+    /**
+     *  Number of workers still busy with the current job.
+     */
+    size_t busy_;
+
+    /**
+     *  Set when the pool is being destroyed.
+     */
+    bool stop_;
+};
+
+/**
+ *  Calls f(begin, end) on disjoint chunks covering [0, count) and
+ *  returns once every chunk is done.
+ */
+template <typename F>
+void ThreadPool::parallelFor(size_t count, size_t grain, F &f) {
+    run(&ThreadPool::call<F>, &f, count, grain);
+}
+
+/**
+ *  Calls a functor of type F on a chunk.
+ */
+template <typename F>
+void ThreadPool::call(void *context, size_t begin, size_t end) {
+    (*static_cast<F*>(context))(begin, end);
+}
+
+#endif
@@ -0,0 +1,580 @@
+/**
+ * @file: Trajectory.cpp
+ * @author Ethan Raymond
+ * @Description: This file implements the TrajectoryWriter and
+    TrajectoryReader classes
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "Trajectory.h"
+#include "Universe.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ *  "UTRJ" read as a little-endian uint32.
+ */
+const uint32_t MAGIC = 0x4a525455;
+
+/**
+ *  Version of the file layout.
+ */
+const uint32_t VERSION = 1;
+
+/**
+ *  Alignment of the sections of the file.
+ */
+const uint64_t PAGE = 4096;
+
+/**
+ *  Size of the chunks whose number of steps is picked automatically.
+ */
+const uint64_t CHUNK_BYTES = 1 << 22;
+
+/**
+ *  Start of a trajectory file.
+ */
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t bodies;
+    uint64_t stepsPerChunk;
+    uint64_t steps;
+    uint64_t chunks;
+    uint64_t massOffset;
+    uint64_t indexOffset;
+    double positionStep;
+    double velocityStep;
+};
+
+static_assert(sizeof(Header) == 72, "Header must not be padded");
+
+/**
+ *  Number of uint64s per chunk in the index.
+ */
+const uint64_t ENTRY = 4;
+
+/**
+ *  Ratio of the quantization step to the error bound, just under 2 so
+ *  that rounding in the division and the product cannot push a value
+ *  past the bound.
+ */
+const double QUANTUM = 1.998;
+
+/**
+ *  Largest multiple a quantized value may round to, leaving room for
+ *  the differences.
+ */
+const double MAX_MULTIPLE = 4611686018427387904.0;
+
+/**
+ *  Returns size rounded up to a whole number of pages.
+ */
+uint64_t pages(uint64_t size) {
+    return (size + PAGE - 1) / PAGE * PAGE;
+}
+
+/**
+ *  Writes the zigzag-encoded LEB128 varint of value, at most 10 bytes, at
+ *  p and returns the end of it.
+ */
+uint8_t* putVarint(uint8_t *p, int64_t value) {
+    uint64_t z = (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+    while (z >= 0x80) {
+        *p++ = uint8_t(z) | 0x80;
+        z >>= 7;
+    }
+    *p++ = uint8_t(z);
+    return p;
+}
+
+/**
+ *  Reads a zigzag-encoded LEB128 varint from [p, end) into value and
+ *  advances p past it. Returns false if the varint is cut off or too
+ *  long.
+ */
+bool getVarint(const uint8_t *&p, const uint8_t *end, int64_t &value) {
+    uint64_t z = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end) {
+            return false;
+        }
+        uint8_t byte = *p++;
+        z |= uint64_t(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            value = int64_t(z >> 1) ^ -int64_t(z & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+/**
+ *  Creates or truncates filename, writing chunks of the given number
+ *  of steps. 0 picks as many steps as fit in about 4 MB, which keeps
+ *  the chunk in cache while it is filled and still makes each write
+ *  large. Throws std::runtime_error if the file cannot be opened.
+ */
+TrajectoryWriter::TrajectoryWriter(const std::string &filename,
+                                   size_t stepsPerChunk) :
+    filename_(filename), stepsPerChunk_(stepsPerChunk), bodies_(0),
+    steps_(0), pending_(0), end_(0), positionStep_(0), velocityStep_(0) {
+    fd_ = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error(filename + ": " + std::strerror(errno));
+    }
+}
+
+/**
+ *  Closes the file if close() was not called, ignoring failures.
+ */
+TrajectoryWriter::~TrajectoryWriter() {
+    try {
+        close();
+    } catch (const std::runtime_error&) {
+    }
+}
+
+/**
+ *  Stores the following steps quantized, with positions off by at most
+ *  positionError meters and velocities by at most velocityError
+ *  meters/second. The bounds must be well above the resolution of the
+ *  doubles being stored. Throws std::invalid_argument if a bound is
+ *  not positive and std::logic_error once a step was appended.
+ */
+void TrajectoryWriter::setQuantization(double positionError,
+                                       double velocityError) {
+    if (!(positionError > 0 && velocityError > 0)) {
+        throw std::invalid_argument("quantization error bounds must be "
+            "positive");
+    }
+    if (steps_ > 0) {
+        throw std::logic_error(filename_ + ": quantization set after the "
+            "first step");
+    }
+    positionStep_ = QUANTUM * positionError;
+    velocityStep_ = QUANTUM * velocityError;
+}
+
+/**
+ *  Appends the universe's current state as the next step.
+ */
+void TrajectoryWriter::append(const Universe &universe) {
+    append(universe.getTime(), universe.getBodies());
+}
+
+/**
+ *  Appends the bodies' state at the given simulated time as the next
+ *  step. The first step fixes the number of bodies and their masses.
+ *  Throws std::runtime_error if the number of bodies changed, e.g.
+ *  after a collision, if a value is too large or not finite to be
+ *  quantized, or if a write failed.
+ */
+void TrajectoryWriter::append(double time, const BodyStore &bodies) {
+    if (fd_ < 0) {
+        throw std::runtime_error(filename_ + ": closed");
+    }
+    if (steps_ == 0) {
+        bodies_ = bodies.size();
+        writeAt(bodies.mass.data(), bodies_ * sizeof(double), PAGE);
+        end_ = PAGE + pages(bodies_ * sizeof(double));
+        size_t step = (1 + 4 * bodies_) * sizeof(double);
+        if (stepsPerChunk_ == 0) {
+            stepsPerChunk_ = std::max<uint64_t>(CHUNK_BYTES / step, 1);
+        }
+        if (positionStep_ > 0) {
+            chunk_.assign(stepsPerChunk_, 0);
+        } else {
+            size_t doubles = stepsPerChunk_ * (1 + 4 * bodies_);
+            chunk_.assign(pages(doubles * sizeof(double)) / sizeof(double),
+                0);
+        }
+    } else if (bodies.size() != bodies_) {
+        throw std::runtime_error(filename_ + ": the number of bodies "
+            "changed from " + std::to_string(bodies_) + " to "
+            + std::to_string(bodies.size()));
+    }
+
+    chunk_[pending_] = time;
+    const std::vector<double> *columns[] = {&bodies.x, &bodies.y,
+        &bodies.vx, &bodies.vy};
+    for (size_t c = 0; c < 4; ++c) {
+        if (positionStep_ > 0) {
+            encode(c, *columns[c]);
+        } else {
+            std::copy(columns[c]->begin(), columns[c]->end(),
+                chunk_.begin() + stepsPerChunk_
+                + (c * stepsPerChunk_ + pending_) * bodies_);
+        }
+    }
+    ++steps_;
+    if (++pending_ == stepsPerChunk_) {
+        flush();
+    }
+}
+
+/**
+ *  Writes the last chunk, the index and the header, and closes the
+ *  file. Throws std::runtime_error if a write failed.
+ */
+void TrajectoryWriter::close() {
+    if (fd_ < 0) {
+        return;
+    }
+    try {
+        if (pending_ > 0) {
+            flush();
+        }
+        uint64_t massOffset = PAGE, indexOffset = end_;
+        if (steps_ == 0) {
+            massOffset = indexOffset = sizeof(Header);
+        }
+        writeAt(index_.data(), index_.size() * sizeof(uint64_t),
+            indexOffset);
+        Header header = {MAGIC, VERSION, bodies_,
+                         std::max<uint64_t>(stepsPerChunk_, 1), steps_,
+                         index_.size() / ENTRY, massOffset, indexOffset,
+                         positionStep_, velocityStep_};
+        writeAt(&header, sizeof(header), 0);
+    } catch (...) {
+        ::close(fd_);
+        fd_ = -1;
+        throw;
+    }
+    int fd = fd_;
+    fd_ = -1;
+    if (::close(fd) != 0) {
+        throw std::runtime_error(filename_ + ": " + std::strerror(errno));
+    }
+}
+
+/**
+ *  Returns the number of steps appended.
+ */
+uint64_t TrajectoryWriter::getStepCount() const {
+    return steps_;
+}
+
+/**
+ *  Writes the current chunk at the end of the file and starts the
+ *  next one.
+ */
+void TrajectoryWriter::flush() {
+    uint64_t bytes;
+    if (positionStep_ > 0) {
+        encoded_.assign(reinterpret_cast<const uint8_t*>(chunk_.data()),
+            reinterpret_cast<const uint8_t*>(chunk_.data() + pending_));
+        for (size_t c = 0; c < 4; ++c) {
+            uint64_t length = streams_[c].size();
+            const uint8_t *p = reinterpret_cast<const uint8_t*>(&length);
+            encoded_.insert(encoded_.end(), p, p + sizeof(length));
+        }
+        for (size_t c = 0; c < 4; ++c) {
+            encoded_.insert(encoded_.end(), streams_[c].begin(),
+                streams_[c].end());
+            streams_[c].clear();
+        }
+        bytes = encoded_.size();
+        writeAt(encoded_.data(), bytes, end_);
+    } else {
+        // A partial last chunk is packed down to its own number of steps.
+        if (pending_ < stepsPerChunk_) {
+            for (size_t c = 0; c < 4; ++c) {
+                double *from = chunk_.data() + stepsPerChunk_
+                    + c * stepsPerChunk_ * bodies_;
+                std::copy(from, from + pending_ * bodies_, chunk_.data()
+                    + pending_ + c * pending_ * bodies_);
+            }
+        }
+        bytes = pages(pending_ * (1 + 4 * bodies_) * sizeof(double));
+        writeAt(chunk_.data(), bytes, end_);
+    }
+    index_.push_back(steps_ - pending_);
+    index_.push_back(pending_);
+    index_.push_back(end_);
+    index_.push_back(bytes);
+    end_ += (bytes + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+    pending_ = 0;
+}
+
+/**
+ *  Appends the quantized differences of a column to the stream of the
+ *  given column.
+ */
+void TrajectoryWriter::encode(size_t column,
+                              const std::vector<double> &values) {
+    if (pending_ == 0 && column == 0) {
+        last_.assign(4 * bodies_, 0);
+        slope_.assign(4 * bodies_, 0);
+    }
+    double scale = 1 / (column < 2 ? positionStep_ : velocityStep_);
+    uint64_t *last = last_.data() + column * bodies_;
+    uint64_t *slope = slope_.data() + column * bodies_;
+    std::vector<uint8_t> &stream = streams_[column];
+    size_t used = stream.size();
+    stream.resize(used + 10 * bodies_);
+    uint8_t *p = stream.data() + used;
+    for (size_t i = 0; i < bodies_; ++i) {
+        double multiple = values[i] * scale;
+        if (!(std::fabs(multiple) < MAX_MULTIPLE)) {
+            stream.resize(used);
+            throw std::runtime_error(filename_ + ": value "
+                + std::to_string(values[i]) + " cannot be quantized");
+        }
+        // Rounds half away from zero with an inlined truncation rather
+        // than a call to std::round. Unsigned, so that the prediction
+        // wraps instead of overflowing; the decoder wraps the same way.
+        uint64_t q = uint64_t(int64_t(multiple
+            + (multiple < 0 ? -0.5 : 0.5)));
+        p = putVarint(p, int64_t(q - (last[i] + slope[i])));
+        slope[i] = pending_ == 0 ? 0 : q - last[i];
+        last[i] = q;
+    }
+    stream.resize(p - stream.data());
+}
+
+/**
+ *  Writes size bytes of data at offset, throwing std::runtime_error on
+ *  failure.
+ */
+void TrajectoryWriter::writeAt(const void *data, size_t size,
+                               uint64_t offset) {
+    const char *bytes = static_cast<const char*>(data);
+    for (size_t done = 0; done < size; ) {
+        ssize_t n = pwrite(fd_, bytes + done, size - done, offset + done);
+        if (n > 0) {
+            done += n;
+        } else if (n < 0 && errno != EINTR) {
+            throw std::runtime_error(filename_ + ": "
+                + std::strerror(errno));
+        }
+    }
+    PROFILE_COUNT(BYTES_WRITTEN, size);
+}
+
+/**
+ *  Maps filename. Throws std::runtime_error if it cannot be read or is
+ *  not a complete trajectory file.
+ */
+TrajectoryReader::TrajectoryReader(const std::string &filename) :
+    data_(nullptr), size_(0), cached_(~uint64_t(0)) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        int error = errno;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        throw std::runtime_error(filename + ": " + std::strerror(error));
+    }
+    size_ = info.st_size;
+    void *map = MAP_FAILED;
+    if (size_ > 0) {
+        map = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw std::runtime_error(filename + ": not a trajectory");
+    }
+    data_ = static_cast<const char*>(map);
+
+    Header header;
+    bool ok = size_ >= sizeof(header);
+    if (ok) {
+        std::memcpy(&header, data_, sizeof(header));
+        ok = header.magic == MAGIC;
+    }
+    if (!ok) {
+        munmap(const_cast<char*>(data_), size_);
+        throw std::runtime_error(filename + ": not a complete trajectory");
+    }
+    bodies_ = header.bodies;
+    stepsPerChunk_ = header.stepsPerChunk;
+    steps_ = header.steps;
+    chunks_ = header.chunks;
+    positionStep_ = header.positionStep;
+    velocityStep_ = header.velocityStep;
+    bool quantized = isQuantized();
+    // Every chunk must lie in the file and hold its steps, and the chunks
+    // must cover the steps in order, stepsPerChunk_ at a time.
+    ok = header.version == VERSION && stepsPerChunk_ > 0
+        && header.indexOffset <= size_ && header.indexOffset % 8 == 0
+        && chunks_ <= (size_ - header.indexOffset)
+            / (ENTRY * sizeof(uint64_t))
+        && chunks_ == (steps_ + stepsPerChunk_ - 1) / stepsPerChunk_
+        && header.massOffset <= size_ && header.massOffset % 8 == 0
+        && bodies_ <= (size_ - header.massOffset) / sizeof(double)
+        && (quantized ? velocityStep_ > 0 : velocityStep_ == 0);
+    index_ = reinterpret_cast<const uint64_t*>(data_ + header.indexOffset);
+    masses_ = reinterpret_cast<const double*>(data_ + header.massOffset);
+    for (uint64_t c = 0; ok && c < chunks_; ++c) {
+        const uint64_t *entry = index_ + ENTRY * c;
+        ok = entry[0] == c * stepsPerChunk_
+            && entry[1] == std::min(stepsPerChunk_, steps_ - entry[0])
+            && entry[2] % (quantized ? 8 : PAGE) == 0
+            && entry[2] <= size_ && entry[3] <= size_ - entry[2]
+            && entry[3] / sizeof(double) >= (quantized ? entry[1] + 4
+                : entry[1] * (1 + 4 * bodies_));
+    }
+    if (!ok) {
+        munmap(const_cast<char*>(data_), size_);
+        throw std::runtime_error(filename + ": corrupt trajectory");
+    }
+}
+
+/**
+ *  Unmaps the file.
+ */
+TrajectoryReader::~TrajectoryReader() {
+    munmap(const_cast<char*>(data_), size_);
+}
+
+/**
+ *  Returns the number of bodies.
+ */
+size_t TrajectoryReader::getBodyCount() const {
+    return bodies_;
+}
+
+/**
+ *  Returns the number of steps.
+ */
+uint64_t TrajectoryReader::getStepCount() const {
+    return steps_;
+}
+
+/**
+ *  Returns the mass of every body, one per body.
+ */
+const double* TrajectoryReader::getMasses() const {
+    return masses_;
+}
+
+/**
+ *  Returns the simulated time after the given step. Throws
+ *  std::out_of_range if there is no such step.
+ */
+double TrajectoryReader::getTime(uint64_t step) const {
+    uint64_t row, steps;
+    return locate(step, row, steps)[row];
+}
+
+/**
+ *  Returns true if the values are quantized.
+ */
+bool TrajectoryReader::isQuantized() const {
+    return positionStep_ > 0;
+}
+
+/**
+ *  Returns the given column of the given step, one double per body,
+ *  valid until a step of another chunk is read. Throws
+ *  std::out_of_range if there is no such step and std::runtime_error
+ *  if its chunk is corrupt.
+ */
+const double* TrajectoryReader::getColumn(uint64_t step, Column column)
+        const {
+    uint64_t row, steps;
+    const double *chunk = locate(step, row, steps);
+    return chunk + steps + (column * steps + row) * bodies_;
+}
+
+/**
+ *  Sets bodies to the state after the given step. Throws
+ *  std::out_of_range if there is no such step.
+ */
+void TrajectoryReader::read(uint64_t step, BodyStore &bodies) const {
+    bodies.resize(bodies_);
+    std::vector<double> *columns[] = {&bodies.x, &bodies.y, &bodies.vx,
+        &bodies.vy};
+    for (int c = 0; c < 4; ++c) {
+        const double *column = getColumn(step, Column(c));
+        std::copy(column, column + bodies_, columns[c]->begin());
+    }
+    std::copy(masses_, masses_ + bodies_, bodies.mass.begin());
+}
+
+/**
+ *  Returns the start of the chunk holding the given step, laid out as
+ *  at full precision, and sets row to the step's row in it and steps
+ *  to the chunk's number of steps. Throws std::out_of_range if there
+ *  is no such step.
+ */
+const double* TrajectoryReader::locate(uint64_t step, uint64_t &row,
+                                       uint64_t &steps) const {
+    if (step >= steps_) {
+        throw std::out_of_range("no step " + std::to_string(step) + " in a "
+            + std::to_string(steps_) + "-step trajectory");
+    }
+    uint64_t chunk = step / stepsPerChunk_;
+    const uint64_t *entry = index_ + ENTRY * chunk;
+    row = step - entry[0];
+    steps = entry[1];
+    if (isQuantized()) {
+        if (cached_ != chunk) {
+            decode(chunk);
+        }
+        return cache_.data();
+    }
+    return reinterpret_cast<const double*>(data_ + entry[2]);
+}
+
+/**
+ *  Decodes the quantized chunk at the given index into cache_. Throws
+ *  std::runtime_error if it is corrupt.
+ */
+void TrajectoryReader::decode(uint64_t chunk) const {
+    const uint64_t *entry = index_ + ENTRY * chunk;
+    uint64_t steps = entry[1];
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(data_ + entry[2]);
+    const uint8_t *end = p + entry[3];
+    cached_ = ~uint64_t(0);
+    cache_.resize(steps * (1 + 4 * bodies_));
+    std::memcpy(cache_.data(), p, steps * sizeof(double));
+    p += steps * sizeof(double);
+    uint64_t lengths[4];
+    std::memcpy(lengths, p, sizeof(lengths));
+    p += sizeof(lengths);
+
+    std::vector<uint64_t> last(bodies_), slope(bodies_);
+    for (size_t c = 0; c < 4; ++c) {
+        if (lengths[c] > uint64_t(end - p)) {
+            throw std::runtime_error("corrupt trajectory chunk");
+        }
+        const uint8_t *stream = p, *streamEnd = p + lengths[c];
+        double step = c < 2 ? positionStep_ : velocityStep_;
+        std::fill(last.begin(), last.end(), 0);
+        std::fill(slope.begin(), slope.end(), 0);
+        for (uint64_t s = 0; s < steps; ++s) {
+            double *row = cache_.data() + steps + (c * steps + s) * bodies_;
+            for (size_t i = 0; i < bodies_; ++i) {
+                int64_t residual;
+                if (!getVarint(stream, streamEnd, residual)) {
+                    throw std::runtime_error("corrupt trajectory chunk");
+                }
+                uint64_t q = last[i] + slope[i] + residual;
+                slope[i] = s == 0 ? 0 : q - last[i];
+                last[i] = q;
+                row[i] = int64_t(q) * step;
+            }
+        }
+        if (stream != streamEnd) {
+            throw std::runtime_error("corrupt trajectory chunk");
+        }
+        p = streamEnd;
+    }
+    cached_ = chunk;
+}
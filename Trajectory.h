@@ -0,0 +1,314 @@
+/**
+ * @file: Trajectory.h
+ * @author Ethan Raymond
+ * @Description: This file declares the TrajectoryWriter and
+    TrajectoryReader classes
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef _TRAJECTORY_H_
+#define _TRAJECTORY_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "BodyStore.h"
+
+// Forward declaration
+class Universe;
+
+/**
+ *  Appends the bodies' positions and velocities after every step to a
+ *  columnar trajectory file for offline analysis, either as full doubles
+ *  or quantized to a chosen error bound. Steps are gathered into chunks
+ *  in memory and every chunk is written with a single write. Values are
+ *  written in the host's byte order, like Checkpoint's.
+ *
+ *  A file holds a header page, the mass column, the chunks and the index:
+ *
+ *  The header is the magic "UTRJ", the uint32 version (1), and the uint64
+ *  counts of bodies, of steps per chunk, of steps and of chunks, followed
+ *  by the uint64 byte offsets of the mass column and of the index, and
+ *  the quantization steps of the positions and of the velocities as
+ *  doubles, 0 at full precision. It is written last, so a file whose
+ *  writer never closed it has no magic and is rejected.
+ *
+ *  Every chunk but the last holds the full number of steps. A
+ *  full-precision chunk starts at a page-aligned offset. It holds the
+ *  times of its steps as doubles, then the x, y, vx and vy columns, each
+ *  made of one row of one double per body for every step of the chunk.
+ *
+ *  A quantized chunk starts at an 8-byte aligned offset. It holds the
+ *  times of its steps as doubles, the uint64 byte lengths of the x, y, vx
+ *  and vy streams, and the streams. Each value is rounded to a multiple
+ *  of its column's quantization step, and a stream lists, step by step
+ *  and body by body, the difference between a body's multiple and its
+ *  prediction, as a zigzag-encoded LEB128 varint. The prediction carries
+ *  on from the two previous steps of the chunk: it is the last multiple
+ *  plus its last change, with the change taken as 0 at the second step
+ *  and both as 0 at the first, all modulo 2^64. Bodies move almost in
+ *  straight lines over a step, so most differences take a byte or two
+ *  instead of eight, and every chunk decodes on its own.
+ *
+ *  The index lists each chunk's first step, step count, byte offset and
+ *  byte length as uint64s.
+ */
+class TrajectoryWriter {
+public:
+
+    /**
+     *  Creates or truncates filename, writing chunks of the given number
+     *  of steps. 0 picks as many steps as fit in about 4 MB, which keeps
+     *  the chunk in cache while it is filled and still makes each write
+     *  large. Throws std::runtime_error if the file cannot be opened.
+     */
+    explicit TrajectoryWriter(const std::string &filename,
+                              size_t stepsPerChunk = 0);
+
+    /**
+     *  Closes the file if close() was not called, ignoring failures.
+     */
+    ~TrajectoryWriter();
+
+    /**
+     *  Stores the following steps quantized, with positions off by at most
+     *  positionError meters and velocities by at most velocityError
+     *  meters/second. The bounds must be well above the resolution of the
+     *  doubles being stored. Throws std::invalid_argument if a bound is
+     *  not positive and std::logic_error once a step was appended.
+     */
+    void setQuantization(double positionError, double velocityError);
+
+    /**
+     *  Appends the universe's current state as the next step.
+     */
+    void append(const Universe &universe);
+
+    /**
+     *  Appends the bodies' state at the given simulated time as the next
+     *  step. The first step fixes the number of bodies and their masses.
+     *  Throws std::runtime_error if the number of bodies changed, e.g.
+     *  after a collision, if a value is too large or not finite to be
+     *  quantized, or if a write failed.
+     */
+    void append(double time, const BodyStore &bodies);
+
+    /**
+     *  Writes the last chunk, the index and the header, and closes the
+     *  file. Throws std::runtime_error if a write failed.
+     */
+    void close();
+
+    /**
+     *  Returns the number of steps appended.
+     */
+    uint64_t getStepCount() const;
+
+private:
+
+    /**
+     *  Writes the current chunk at the end of the file and starts the
+     *  next one.
+     */
+    void flush();
+
+    /**
+     *  Appends the quantized differences of a column to the stream of the
+     *  given column.
+     */
+    void encode(size_t column, const std::vector<double> &values);
+
+    /**
+     *  Writes size bytes of data at offset, throwing std::runtime_error on
+     *  failure.
+     */
+    void writeAt(const void *data, size_t size, uint64_t offset);
+
+    /**
+     *  Name of the file, for the error messages.
+     */
+    std::string filename_;
+
+    /**
+     *  Descriptor of the file, -1 once closed.
+     */
+    int fd_;
+
+    /**
+     *  Steps per chunk, 0 until the first step if picked automatically.
+     */
+    size_t stepsPerChunk_;
+
+    /**
+     *  Number of bodies, fixed by the first step.
+     */
+    size_t bodies_;
+
+    /**
+     *  Steps appended, and steps in the current chunk.
+     */
+    uint64_t steps_, pending_;
+
+    /**
+     *  Byte offset of the next chunk.
+     */
+    uint64_t end_;
+
+    /**
+     *  Current chunk, laid out for the full number of steps and padded to
+     *  a whole number of pages. Holds only the times when quantized.
+     */
+    std::vector<double> chunk_;
+
+    /**
+     *  Quantization steps of the positions and of the velocities, 0 at
+     *  full precision.
+     */
+    double positionStep_, velocityStep_;
+
+    /**
+     *  Multiple of every value at the previous step of the chunk, and its
+     *  change from the step before, column by column.
+     */
+    std::vector<uint64_t> last_, slope_;
+
+    /**
+     *  Encoded columns of the current quantized chunk, and the chunk
+     *  assembled for writing.
+     */
+    std::vector<uint8_t> streams_[4], encoded_;
+
+    /**
+     *  First step, step count, offset and length of every chunk written.
+     */
+    std::vector<uint64_t> index_;
+
+};
+
+/**
+ *  Maps a trajectory file written by TrajectoryWriter into memory for
+ *  random access to any step. Only the header and the index are read
+ *  when the file is opened. At full precision a step's columns are
+ *  returned as pointers into the mapping, so reading a range of steps
+ *  touches only the pages that hold them; a quantized chunk is decoded
+ *  whole into a cache when one of its steps is first read, so reading
+ *  steps in order decodes each chunk once. A reader is not safe to share
+ *  between threads.
+ */
+class TrajectoryReader {
+public:
+
+    /**
+     *  Columns of a step.
+     */
+    enum Column { X, Y, VX, VY };
+
+    /**
+     *  Maps filename. Throws std::runtime_error if it cannot be read or is
+     *  not a complete trajectory file.
+     */
+    explicit TrajectoryReader(const std::string &filename);
+
+    /**
+     *  Unmaps the file.
+     */
+    ~TrajectoryReader();
+
+    /**
+     *  Returns the number of bodies.
+     */
+    size_t getBodyCount() const;
+
+    /**
+     *  Returns the number of steps.
+     */
+    uint64_t getStepCount() const;
+
+    /**
+     *  Returns the mass of every body, one per body.
+     */
+    const double* getMasses() const;
+
+    /**
+     *  Returns the simulated time after the given step. Throws
+     *  std::out_of_range if there is no such step.
+     */
+    double getTime(uint64_t step) const;
+
+    /**
+     *  Returns true if the values are quantized.
+     */
+    bool isQuantized() const;
+
+    /**
+     *  Returns the given column of the given step, one double per body,
+     *  valid until a step of another chunk is read. Throws
+     *  std::out_of_range if there is no such step and std::runtime_error
+     *  if its chunk is corrupt.
+     */
+    const double* getColumn(uint64_t step, Column column) const;
+
+    /**
+     *  Sets bodies to the state after the given step. Throws
+     *  std::out_of_range if there is no such step.
+     */
+    void read(uint64_t step, BodyStore &bodies) const;
+
+private:
+
+    TrajectoryReader(const TrajectoryReader&);
+    TrajectoryReader& operator=(const TrajectoryReader&);
+
+    /**
+     *  Returns the start of the chunk holding the given step, laid out as
+     *  at full precision, and sets row to the step's row in it and steps
+     *  to the chunk's number of steps. Throws std::out_of_range if there
+     *  is no such step.
+     */
+    const double* locate(uint64_t step, uint64_t &row, uint64_t &steps)
+        const;
+
+    /**
+     *  Decodes the quantized chunk at the given index into cache_. Throws
+     *  std::runtime_error if it is corrupt.
+     */
+    void decode(uint64_t chunk) const;
+
+    /**
+     *  Mapped file.
+     */
+    const char *data_;
+
+    /**
+     *  Size of the mapping in bytes.
+     */
+    size_t size_;
+
+    /**
+     *  Number of bodies, steps per chunk, steps and chunks.
+     */
+    uint64_t bodies_, stepsPerChunk_, steps_, chunks_;
+
+    /**
+     *  Mass column and index in the mapping.
+     */
+    const double *masses_;
+    const uint64_t *index_;
+
+    /**
+     *  Quantization steps of the positions and of the velocities, 0 at
+     *  full precision.
+     */
+    double positionStep_, velocityStep_;
+
+    /**
+     *  Last quantized chunk decoded, and its values.
+     */
+    mutable uint64_t cached_;
+    mutable std::vector<double> cache_;
+
+};
+
+#endif
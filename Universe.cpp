@@ -7,6 +7,9 @@
 */
 
 #include "Universe.h"
+#include "Checkpoint.h"
+#include "Profiler.h"
+#include <cmath>
 
 Universe *Universe::myInstance = nullptr;
 
@@ -19,11 +22,25 @@ vector2 Universe::getForce(const Object& obj1, const Object& obj2) {
     double constant = Universe::G * (obj1.getMass() * obj2.getMass());
     vector2 tmp(obj2.getPosition() - obj1.getPosition());
     if (obj1.getPosition() != obj2.getPosition()) {
-        tmp =  tmp.normalize() * constant / tmp.normSq();
+        double distSq = tmp.normSq();
+        tmp = tmp.normalize() * constant / distSq;
     }
     return tmp;
 }
 
+/**
+ *  Returns the net force on obj, taken as a point mass at its position,
+ *  from every body outside obj's own store slots, as computed by the
+ *  current force strategy. Only valid during stepSimulation, after the
+ *  strategy has been prepared.
+ */
+vector2 Universe::getTotalForce(const Object& obj) const {
+    size_t first, last;
+    obj.getSlots(first, last);
+    return forceStrategy_->getForce(obj.getPosition(), obj.getMass(),
+        first, last);
+}
+
 /**
 * Creates an instance of the Universe class
 */
@@ -39,15 +56,40 @@ Universe *Universe::instance() {
  */
 Universe::~Universe() {
     release(objects_);
+    delete forceStrategy_;
+    delete integrator_;
+    delete checkpoint_;
+    delete pool_;
     myInstance = nullptr;
 }
 
 /**
  *  Registers an Object with the universe. The Universe will clean up this
- *  object when it deems necessary.
+ *  object when it deems necessary. The object is attached to the
+ *  Universe's BodyStore and from then on keeps its state there.
  */
 void Universe::addObject(Object* ptr) {
+    ptr->attach(bodies_, bodies_.size());
     objects_.push_back(ptr);
+    sortObject(ptr);
+    if (ptr->getKind() == Object::AGGREGATE) {
+        updateAggregates();
+    }
+}
+
+/**
+ *  Returns the structure-of-arrays store backing the registered objects.
+ */
+const BodyStore& Universe::getBodies() const {
+    return bodies_;
+}
+
+/**
+ *  Returns the store backing the registered objects, for integrators
+ *  that update the bodies' state directly.
+ */
+BodyStore& Universe::getBodies() {
+    return bodies_;
 }
 
 /**
@@ -93,6 +135,7 @@ typename Universe::const_iterator Universe::end() const {
  */
 std::vector<Object*> Universe::getSnapshot() const {
     std::vector<Object*> tmp;
+    PROFILE_PHASE(SNAPSHOT);
     tmp.reserve(objects_.size());
     std::for_each(begin(), end(), [&](Object *obj){
         tmp.push_back(obj->clone());
@@ -106,26 +149,381 @@ std::vector<Object*> Universe::getSnapshot() const {
  *  position should not be affected by any of the other objects.
  */
 void Universe::stepSimulation(double seconds) {
-    std::vector<Object*> tmp;
-    MoverVisitor mover(seconds);
-    for (size_t i = 0; i < objects_.size(); ++i) {
-        objects_[i]->accept(mover);
-        tmp.push_back(mover.getObject());
+    PROFILE_PHASE(STEP);
+    PROFILE_COUNT(STEPS, 1);
+    time_ += seconds;
+    if (doubleBuffered_) {
+        integrator_->step(seconds, *this);
+    } else {
+        {
+            PROFILE_PHASE(FORCES);
+            forceStrategy_->prepare(bodies_);
+        }
+        std::vector<Object*> tmp;
+        MoverVisitor mover(seconds);
+        for (size_t i = 0; i < objects_.size(); ++i) {
+            objects_[i]->accept(mover);
+            tmp.push_back(mover.getObject());
+        }
+        swap(tmp);
+    }
+    mergeCollisions();
+}
+
+/**
+ *  Returns the number of seconds simulated so far, the sum of the
+ *  stepSimulation() arguments.
+ */
+double Universe::getTime() const {
+    return time_;
+}
+
+/**
+ *  Saves the registered objects and the simulated time to filename.
+ *  The state is captured before returning but written to disk on a
+ *  background thread, so the simulation can keep stepping meanwhile.
+ *  Throws std::runtime_error if the previous checkpoint failed to be
+ *  written.
+ */
+void Universe::saveCheckpoint(const std::string &filename) {
+    if (checkpoint_ == nullptr) {
+        checkpoint_ = new Checkpoint();
+    }
+    checkpoint_->save(*this, filename);
+}
+
+/**
+ *  Waits until the last checkpoint is on disk. Throws
+ *  std::runtime_error if it failed to be written.
+ */
+void Universe::waitForCheckpoint() {
+    if (checkpoint_ != nullptr) {
+        checkpoint_->wait();
+    }
+}
+
+/**
+ *  Replaces the registered objects and the simulated time with those
+ *  saved in filename. Stepping on reproduces the saved run bit for bit,
+ *  given the same force strategy, integrator and step sizes, which are
+ *  not part of the checkpoint; BlockTimestepIntegrator's levels restart
+ *  from scratch. Throws std::runtime_error, leaving the Universe as it
+ *  was, if the file is not a valid checkpoint.
+ */
+void Universe::loadCheckpoint(const std::string &filename) {
+    std::vector<Object*> objects;
+    double time = Checkpoint::load(filename, objects);
+    swap(objects);
+    time_ = time;
+}
+
+/**
+ *  Selects the double-buffered step. Instead of cloning every object
+ *  through MoverVisitor and releasing the old ones, each step runs the
+ *  integrator over the BodyStore, either writing the new state into a
+ *  second preallocated store and swapping the two or kicking and
+ *  drifting in place, so a step allocates nothing once the buffers have
+ *  grown. Every object then sees the same pre-step state. Off by default.
+ */
+void Universe::setDoubleBuffered(bool enabled) {
+    doubleBuffered_ = enabled;
+}
+
+/**
+ *  Returns true if the double-buffered step is selected.
+ */
+bool Universe::isDoubleBuffered() const {
+    return doubleBuffered_;
+}
+
+/**
+ *  Sets the number of threads the double-buffered step splits the
+ *  objects across. 0, the default, uses the number of hardware threads.
+ *  Each object's force is still summed by a single thread in a fixed
+ *  order, so the result is bitwise identical for every thread count.
+ *  The cloning step moves aggregate members in place and stays serial.
+ */
+void Universe::setThreadCount(size_t threads) {
+    if (threads != threadCount_) {
+        threadCount_ = threads;
+        forceStrategy_->setThreadPool(nullptr);
+        delete pool_;
+        pool_ = nullptr;
+    }
+}
+
+/**
+ *  Returns the configured number of threads, 0 meaning hardware threads.
+ */
+size_t Universe::getThreadCount() const {
+    return threadCount_;
+}
+
+/**
+ *  Sets the integrator the double-buffered step uses. The Universe takes
+ *  ownership of the integrator. Defaults to EulerIntegrator, the scheme
+ *  of the cloning step.
+ */
+void Universe::setIntegrator(Integrator *integrator) {
+    if (integrator != integrator_) {
+        delete integrator_;
+        integrator_ = integrator;
+    }
+}
+
+/**
+ *  Returns the current integrator.
+ */
+Integrator* Universe::getIntegrator() const {
+    return integrator_;
+}
+
+/**
+ *  Adds force / mass times seconds to the velocity of every mobile body,
+ *  with the forces evaluated at the current positions. Building block
+ *  of the integrators.
+ */
+void Universe::kick(double seconds) {
+    PROFILE_PHASE(FORCES);
+    forceStrategy_->prepare(bodies_);
+    auto immobile = [](size_t slot) {};
+    auto simple = [&](size_t slot) {
+        vector2 totalForce = forceStrategy_->getForce(
+            bodies_.getPosition(slot), bodies_.mass[slot], slot, slot + 1);
+        vector2 accel = totalForce / bodies_.mass[slot];
+        bodies_.setVelocity(slot, bodies_.getVelocity(slot)
+            + accel * seconds);
+    };
+    auto aggregate = [&](AggregateObject &object) {
+        PROFILE_PHASE(AGGREGATE);
+        object.getStrategy()->kick(seconds, object);
+    };
+    forEachKind(immobile, simple, aggregate);
+}
+
+/**
+ *  Moves every mobile body by its velocity times seconds. Building block
+ *  of the integrators.
+ */
+void Universe::drift(double seconds) {
+    double *x = bodies_.x.data(), *y = bodies_.y.data();
+    const double *vx = bodies_.vx.data(), *vy = bodies_.vy.data();
+    auto immobile = [](size_t slot) {};
+    auto simple = [&](size_t slot) {
+        x[slot] = x[slot] + vx[slot] * seconds;
+        y[slot] = y[slot] + vy[slot] * seconds;
+    };
+    auto aggregate = [&](AggregateObject &object) {
+        PROFILE_PHASE(AGGREGATE);
+        object.getStrategy()->drift(seconds, object);
+    };
+    forEachKind(immobile, simple, aggregate);
+}
+
+/**
+ *  A kick followed by a drift over the same seconds, done in one pass
+ *  that writes into the back buffer and swaps it in. Building block of
+ *  the integrators.
+ */
+void Universe::kickDrift(double seconds) {
+    PROFILE_PHASE(FORCES);
+    forceStrategy_->prepare(bodies_);
+    next_.resize(bodies_.size());
+    auto immobile = [&](size_t slot) {
+        next_.set(slot, bodies_.getPosition(slot), vector2(),
+            bodies_.mass[slot]);
+    };
+    auto simple = [&](size_t slot) {
+        double mass = bodies_.mass[slot];
+        vector2 totalForce = forceStrategy_->getForce(
+            bodies_.getPosition(slot), mass, slot, slot + 1);
+        bodies_.advance(slot, totalForce / mass, seconds, next_);
+    };
+    auto aggregate = [&](AggregateObject &object) {
+        PROFILE_PHASE(AGGREGATE);
+        object.getStrategy()->advance(seconds, object, next_);
+    };
+    forEachKind(immobile, simple, aggregate);
+    bodies_.swap(next_);
+}
+
+/**
+ *  Has the registered objects at the given indices accept the visitor,
+ *  split across the thread pool. The visitor must only write to the
+ *  visited object.
+ */
+void Universe::visitObjects(Visitor &visitor,
+                            const std::vector<size_t> &indices) {
+    ThreadPool *pool = getPool();
+    auto visit = [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            objects_[indices[i]]->accept(visitor);
+        }
+    };
+    size_t grain = indices.size() / (8 * pool->size()) + 1;
+    pool->parallelFor(indices.size(), grain, visit);
+}
+
+/**
+ *  Sets the strategy used to compute net forces. The Universe takes
+ *  ownership of the strategy. Defaults to AllPairsStrategy.
+ */
+void Universe::setForceStrategy(ForceStrategy *strategy) {
+    if (strategy != forceStrategy_) {
+        delete forceStrategy_;
+        forceStrategy_ = strategy;
+        updateAggregates();
+        forceStrategy_->setThreadPool(getPool());
     }
-    swap(tmp);
+}
+
+/**
+ *  Returns the current force strategy.
+ */
+ForceStrategy* Universe::getForceStrategy() const {
+    return forceStrategy_;
 }
 
 /**
  *  Swaps the contants of the provided container with the Universe's Object
- *  store and releases the old Objects.
+ *  store and releases the old Objects. The new Objects are attached to
+ *  the BodyStore in order, taking over the old Objects' slots.
  */
 void Universe::swap(std::vector<Object*>& snapshot) {
+    PROFILE_PHASE(SWAP);
     objects_.swap(snapshot);
     release(snapshot);
+    attachAll();
+}
+
+/**
+ *  Enables the collision phase, which runs after every step and merges
+ *  the bodies that touch. Each body is taken to be a sphere of the
+ *  given density in kg/m^3, and bodies merge when the distance
+ *  between their centers is less than the sum of their radii. 0, the
+ *  default, disables the phase.
+ */
+void Universe::setCollisionDensity(double density) {
+    collisionDensity_ = density;
+}
+
+/**
+ *  Returns the density of the collision phase, 0 when it is disabled.
+ */
+double Universe::getCollisionDensity() const {
+    return collisionDensity_;
+}
+
+/**
+ *  Merges every group of touching bodies, found with a spatial hash,
+ *  into one object. Mass and momentum are conserved: the merged body
+ *  sits at the group's center of mass, moves with its mean velocity
+ *  and takes the name of its heaviest member. A group with an
+ *  ImmobileObject becomes that object with the group's mass, so it
+ *  absorbs the others' momentum. Members of aggregates never merge.
+ *  The merged object takes the place of the group's first object.
+ *  Returns the number of objects removed. Does nothing when the
+ *  collision density is 0.
+ */
+size_t Universe::mergeCollisions() {
+    if (collisionDensity_ <= 0) {
+        return 0;
+    }
+    PROFILE_PHASE(COLLISIONS);
+    size_t n = bodies_.size();
+    radius_.assign(n, 0);
+    owner_.resize(n);
+    const double volume = 3 / (4 * M_PI * collisionDensity_);
+    for (size_t k = 0; k < objects_.size(); ++k) {
+        size_t first, last;
+        objects_[k]->getSlots(first, last);
+        std::fill(owner_.begin() + first, owner_.begin() + last, k);
+        if (objects_[k]->getKind() != Object::AGGREGATE) {
+            radius_[first] = std::cbrt(bodies_.mass[first] * volume);
+        }
+    }
+    hash_.findOverlaps(bodies_, radius_, touching_);
+    if (touching_.empty()) {
+        return 0;
+    }
+
+    // Union-find over the objects, each group rooted at its first object.
+    group_.resize(objects_.size());
+    for (size_t k = 0; k < group_.size(); ++k) {
+        group_[k] = k;
+    }
+    std::for_each(touching_.begin(), touching_.end(),
+            [&](const std::pair<size_t, size_t> &pair){
+        size_t a = findGroup(owner_[pair.first]);
+        size_t b = findGroup(owner_[pair.second]);
+        group_[std::max(a, b)] = std::min(a, b);
+    });
+
+    struct Group {
+        size_t size, heaviest, anchor;
+        double mass, x, y, vx, vy;
+    };
+    Group empty = {0, 0, objects_.size(), 0, 0, 0, 0, 0};
+    std::vector<Group> groups(objects_.size(), empty);
+    for (size_t k = 0; k < objects_.size(); ++k) {
+        Group &g = groups[findGroup(k)];
+        size_t first, last;
+        objects_[k]->getSlots(first, last);
+        double m = bodies_.mass[first];
+        if (g.size == 0 || m > bodies_.mass[g.heaviest]) {
+            g.heaviest = first;
+        }
+        if (objects_[k]->getKind() == Object::IMMOBILE
+                && g.anchor == objects_.size()) {
+            g.anchor = k;
+        }
+        ++g.size;
+        g.mass += m;
+        g.x += m * bodies_.x[first];
+        g.y += m * bodies_.y[first];
+        g.vx += m * bodies_.vx[first];
+        g.vy += m * bodies_.vy[first];
+    }
+
+    std::vector<Object*> merged;
+    merged.reserve(objects_.size());
+    for (size_t k = 0; k < objects_.size(); ++k) {
+        const Group &g = groups[findGroup(k)];
+        if (g.size == 1) {
+            merged.push_back(objects_[k]);
+            continue;
+        }
+        if (findGroup(k) != k) {
+            continue;
+        }
+        if (g.anchor != objects_.size()) {
+            Object *anchor = objects_[g.anchor];
+            merged.push_back(new ImmobileObject(anchor->getName(), g.mass,
+                anchor->getPosition()));
+            continue;
+        }
+        vector2 pos, vel;
+        pos[0] = g.x / g.mass;
+        pos[1] = g.y / g.mass;
+        vel[0] = g.vx / g.mass;
+        vel[1] = g.vy / g.mass;
+        merged.push_back(new SimpleObject(
+            objects_[owner_[g.heaviest]]->getName(), g.mass, pos, vel));
+    }
+    for (size_t k = 0; k < objects_.size(); ++k) {
+        if (groups[findGroup(k)].size > 1) {
+            delete objects_[k];
+        }
+    }
+    size_t removed = objects_.size() - merged.size();
+    objects_.swap(merged);
+    attachAll();
+    return removed;
 }
 
 /**
- *  Calls delete on each pointer and removes it from the container.
+ *  Destroys each object, which returns its memory to the ObjectPool,
+ *  and empties the container.
  */
 void Universe::release(std::vector<Object*>& objects) {
     std::for_each(objects.begin(), objects.end(),
@@ -133,7 +531,119 @@ void Universe::release(std::vector<Object*>& objects) {
     objects.clear();
 }
 
+/**
+ *  Attaches the registered objects to the BodyStore in order and sorts
+ *  them by kind.
+ */
+void Universe::attachAll() {
+    immobile_.clear();
+    simple_.clear();
+    aggregates_.clear();
+    size_t slot = 0;
+    std::for_each(begin(), end(), [&](Object *obj){
+        slot = obj->attach(bodies_, slot);
+        sortObject(obj);
+    });
+    bodies_.resize(slot);
+    updateAggregates();
+}
+
+/**
+ *  Adds a registered object to the list of its kind.
+ */
+void Universe::sortObject(Object *object) {
+    size_t first, last;
+    object->getSlots(first, last);
+    switch (object->getKind()) {
+    case Object::IMMOBILE:
+        immobile_.push_back(first);
+        break;
+    case Object::SIMPLE:
+        simple_.push_back(first);
+        break;
+    case Object::AGGREGATE:
+        aggregates_.push_back(static_cast<AggregateObject*>(object));
+        break;
+    }
+}
+
+/**
+ *  Passes the slots of the aggregates to the force strategy.
+ */
+void Universe::updateAggregates() {
+    std::vector<size_t> first, last;
+    std::for_each(aggregates_.begin(), aggregates_.end(),
+        [&](AggregateObject *aggregate){
+            size_t f, l;
+            aggregate->getSlots(f, l);
+            first.push_back(f);
+            last.push_back(l);
+        });
+    forceStrategy_->setAggregates(first, last);
+}
+
+/**
+ *  Returns the thread pool, creating it and lending it to the force
+ *  strategy on first use.
+ */
+ThreadPool* Universe::getPool() {
+    if (pool_ == nullptr) {
+        pool_ = new ThreadPool(threadCount_);
+        forceStrategy_->setThreadPool(pool_);
+    }
+    return pool_;
+}
+
+/**
+ *  Returns the first object of the group of the object at index,
+ *  compressing the path there.
+ */
+size_t Universe::findGroup(size_t index) {
+    size_t root = index;
+    while (group_[root] != root) {
+        root = group_[root];
+    }
+    while (group_[index] != root) {
+        size_t next = group_[index];
+        group_[index] = root;
+        index = next;
+    }
+    return root;
+}
+
+/**
+ *  Calls immobile(slot) for the slot of every ImmobileObject,
+ *  simple(slot) for that of every SimpleObject and aggregate(object)
+ *  for every AggregateObject, each kind in a loop of its own, split
+ *  across the thread pool. The calls must only write to the given
+ *  object's slots.
+ */
+template <typename I, typename S, typename A>
+void Universe::forEachKind(I &immobile, S &simple, A &aggregate) {
+    ThreadPool *pool = getPool();
+    // The kinds are laid end to end and each chunk runs the part of
+    // every list that falls inside it.
+    size_t a = immobile_.size(), b = a + simple_.size();
+    size_t count = b + aggregates_.size();
+    auto visit = [&](size_t first, size_t last) {
+        for (size_t i = first; i < std::min(last, a); ++i) {
+            immobile(immobile_[i]);
+        }
+        for (size_t i = std::max(first, a); i < std::min(last, b); ++i) {
+            simple(simple_[i - a]);
+        }
+        for (size_t i = std::max(first, b); i < last; ++i) {
+            aggregate(*aggregates_[i - b]);
+        }
+    };
+    size_t grain = count / (8 * pool->size()) + 1;
+    pool->parallelFor(count, grain, visit);
+}
+
 /**
 * Private constructor
 */
-Universe::Universe() {}
+Universe::Universe() : doubleBuffered_(false), threadCount_(0),
+    pool_(nullptr), forceStrategy_(new AllPairsStrategy),
+    integrator_(new EulerIntegrator), checkpoint_(nullptr), time_(0),
+    collisionDensity_(0) {}
@@ -4,9 +4,18 @@
 #include <vector>
 #include "Vector.h"
 #include "Object.h"
+#include "BodyStore.h"
+#include "ForceStrategy.h"
+#include "ThreadPool.h"
+#include "Integrator.h"
+#include "SpatialHash.h"
 
 // Forward declaration
 class Object;
+class AggregateObject;
+class ForceStrategy;
+class Visitor;
+class Checkpoint;
 
 /**
  *  A singleton class representing the Universe. For this assignment, the first
@@ -33,6 +42,14 @@ public:
      */
     static vector2 getForce(const Object& obj1, const Object& obj2);
 
+    /**
+     *  Returns the net force on obj, taken as a point mass at its position,
+     *  from every body outside obj's own store slots, as computed by the
+     *  current force strategy. Only valid during stepSimulation, after the
+     *  strategy has been prepared.
+     */
+    vector2 getTotalForce(const Object& obj) const;
+
     /**
      * Returns a pointer to the universe
      */
@@ -45,10 +62,22 @@ public:
 
     /**
      *  Registers an Object with the universe. The Universe will clean up this
-     *  object when it deems necessary.
+     *  object when it deems necessary. The object is attached to the
+     *  Universe's BodyStore and from then on keeps its state there.
      */
     void addObject(Object* ptr);
 
+    /**
+     *  Returns the structure-of-arrays store backing the registered objects.
+     */
+    const BodyStore& getBodies() const;
+
+    /**
+     *  Returns the store backing the registered objects, for integrators
+     *  that update the bodies' state directly.
+     */
+    BodyStore& getBodies();
+
     /**
      *  Returns the begin iterator to the actual Objects. The order of itetarion
      *  will be the same as that over getSnapshot()'s result as long as no new
@@ -91,24 +120,293 @@ public:
      */
     void stepSimulation(double seconds);
 
+    /**
+     *  Returns the number of seconds simulated so far, the sum of the
+     *  stepSimulation() arguments.
+     */
+    double getTime() const;
+
+    /**
+     *  Saves the registered objects and the simulated time to filename.
+     *  The state is captured before returning but written to disk on a
+     *  background thread, so the simulation can keep stepping meanwhile.
+     *  Throws std::runtime_error if the previous checkpoint failed to be
+     *  written.
+     */
+    void saveCheckpoint(const std::string &filename);
+
+    /**
+     *  Waits until the last checkpoint is on disk. Throws
+     *  std::runtime_error if it failed to be written.
+     */
+    void waitForCheckpoint();
+
+    /**
+     *  Replaces the registered objects and the simulated time with those
+     *  saved in filename. Stepping on reproduces the saved run bit for bit,
+     *  given the same force strategy, integrator and step sizes, which are
+     *  not part of the checkpoint; BlockTimestepIntegrator's levels restart
+     *  from scratch. Throws std::runtime_error, leaving the Universe as it
+     *  was, if the file is not a valid checkpoint.
+     */
+    void loadCheckpoint(const std::string &filename);
+
+    /**
+     *  Selects the double-buffered step. Instead of cloning every object
+     *  through MoverVisitor and releasing the old ones, each step runs the
+     *  integrator over the BodyStore, either writing the new state into a
+     *  second preallocated store and swapping the two or kicking and
+     *  drifting in place, so a step allocates nothing once the buffers have
+     *  grown. Every object then sees the same pre-step state. Off by default.
+     */
+    void setDoubleBuffered(bool enabled);
+
+    /**
+     *  Returns true if the double-buffered step is selected.
+     */
+    bool isDoubleBuffered() const;
+
+    /**
+     *  Sets the number of threads the double-buffered step splits the
+     *  objects across. 0, the default, uses the number of hardware threads.
+     *  Each object's force is still summed by a single thread in a fixed
+     *  order, so the result is bitwise identical for every thread count.
+     *  The cloning step moves aggregate members in place and stays serial.
+     */
+    void setThreadCount(size_t threads);
+
+    /**
+     *  Returns the configured number of threads, 0 meaning hardware threads.
+     */
+    size_t getThreadCount() const;
+
+    /**
+     *  Sets the integrator the double-buffered step uses. The Universe takes
+     *  ownership of the integrator. Defaults to EulerIntegrator, the scheme
+     *  of the cloning step.
+     */
+    void setIntegrator(Integrator *integrator);
+
+    /**
+     *  Returns the current integrator.
+     */
+    Integrator* getIntegrator() const;
+
+    /**
+     *  Adds force / mass times seconds to the velocity of every mobile body,
+     *  with the forces evaluated at the current positions. Building block
+     *  of the integrators.
+     */
+    void kick(double seconds);
+
+    /**
+     *  Moves every mobile body by its velocity times seconds. Building block
+     *  of the integrators.
+     */
+    void drift(double seconds);
+
+    /**
+     *  A kick followed by a drift over the same seconds, done in one pass
+     *  that writes into the back buffer and swaps it in. Building block of
+     *  the integrators.
+     */
+    void kickDrift(double seconds);
+
+    /**
+     *  Has the registered objects at the given indices accept the visitor,
+     *  split across the thread pool. The visitor must only write to the
+     *  visited object.
+     */
+    void visitObjects(Visitor &visitor, const std::vector<size_t> &indices);
+
+    /**
+     *  Sets the strategy used to compute net forces. The Universe takes
+     *  ownership of the strategy. Defaults to AllPairsStrategy.
+     */
+    void setForceStrategy(ForceStrategy *strategy);
+
+    /**
+     *  Returns the current force strategy.
+     */
+    ForceStrategy* getForceStrategy() const;
+
+    /**
+     *  Enables the collision phase, which runs after every step and merges
+     *  the bodies that touch. Each body is taken to be a sphere of the
+     *  given density in kg/m^3, and bodies merge when the distance
+     *  between their centers is less than the sum of their radii. 0, the
+     *  default, disables the phase.
+     */
+    void setCollisionDensity(double density);
+
+    /**
+     *  Returns the density of the collision phase, 0 when it is disabled.
+     */
+    double getCollisionDensity() const;
+
+    /**
+     *  Merges every group of touching bodies, found with a spatial hash,
+     *  into one object. Mass and momentum are conserved: the merged body
+     *  sits at the group's center of mass, moves with its mean velocity
+     *  and takes the name of its heaviest member. A group with an
+     *  ImmobileObject becomes that object with the group's mass, so it
+     *  absorbs the others' momentum. Members of aggregates never merge.
+     *  The merged object takes the place of the group's first object.
+     *  Returns the number of objects removed. Does nothing when the
+     *  collision density is 0.
+     */
+    size_t mergeCollisions();
+
     /**
      *  Swaps the contants of the provided container with the Universe's Object
-     *  store and releases the old Objects.
+     *  store and releases the old Objects. The new Objects are attached to
+     *  the BodyStore in order, taking over the old Objects' slots.
      */
     void swap(std::vector<Object*>& snapshot);
 
 private:
 
     /**
-     *  Calls delete on each pointer and removes it from the container.
+     *  Destroys each object, which returns its memory to the ObjectPool,
+     *  and empties the container.
      */
     void release(std::vector<Object*>& objects);
 
+    /**
+     *  Attaches the registered objects to the BodyStore in order and sorts
+     *  them by kind.
+     */
+    void attachAll();
+
+    /**
+     *  Adds a registered object to the list of its kind.
+     */
+    void sortObject(Object *object);
+
+    /**
+     *  Passes the slots of the aggregates to the force strategy.
+     */
+    void updateAggregates();
+
+    /**
+     *  Returns the thread pool, creating it and lending it to the force
+     *  strategy on first use.
+     */
+    ThreadPool* getPool();
+
+    /**
+     *  Returns the first object of the group of the object at index,
+     *  compressing the path there.
+     */
+    size_t findGroup(size_t index);
+
+    /**
+     *  Calls immobile(slot) for the slot of every ImmobileObject,
+     *  simple(slot) for that of every SimpleObject and aggregate(object)
+     *  for every AggregateObject, each kind in a loop of its own, split
+     *  across the thread pool. The calls must only write to the given
+     *  object's slots.
+     */
+    template <typename I, typename S, typename A>
+    void forEachKind(I &immobile, S &simple, A &aggregate);
+
     /**
      *  Container for pointers to the registered Objects.
      */
     std::vector<Object*> objects_;
 
+    /**
+     *  Slots of the registered ImmobileObjects, in registration order.
+     */
+    std::vector<size_t> immobile_;
+
+    /**
+     *  Slots of the registered SimpleObjects, in registration order.
+     */
+    std::vector<size_t> simple_;
+
+    /**
+     *  The registered AggregateObjects, in registration order.
+     */
+    std::vector<AggregateObject*> aggregates_;
+
+    /**
+     *  State of every point mass, indexed by the objects' slots.
+     */
+    BodyStore bodies_;
+
+    /**
+     *  Buffer receiving the next state in the double-buffered step.
+     */
+    BodyStore next_;
+
+    /**
+     *  True if the double-buffered step is selected.
+     */
+    bool doubleBuffered_;
+
+    /**
+     *  Configured number of threads, 0 meaning hardware threads.
+     */
+    size_t threadCount_;
+
+    /**
+     *  Workers for the double-buffered step and the force strategy,
+     *  created on first use.
+     */
+    ThreadPool *pool_;
+
+    /**
+     *  Strategy used to compute net forces.
+     */
+    ForceStrategy *forceStrategy_;
+
+    /**
+     *  Integrator of the double-buffered step.
+     */
+    Integrator *integrator_;
+
+    /**
+     *  Writer of the checkpoints, created on first use.
+     */
+    Checkpoint *checkpoint_;
+
+    /**
+     *  Seconds simulated so far.
+     */
+    double time_;
+
+    /**
+     *  Density of the bodies in the collision phase, 0 when disabled.
+     */
+    double collisionDensity_;
+
+    /**
+     *  Grid finding the touching bodies.
+     */
+    SpatialHash hash_;
+
+    /**
+     *  Radius of each body in the collision phase, 0 for aggregate
+     *  members.
+     */
+    std::vector<double> radius_;
+
+    /**
+     *  Touching bodies found by the collision phase.
+     */
+    std::vector<std::pair<size_t, size_t> > touching_;
+
+    /**
+     *  Index of the registered object owning each slot.
+     */
+    std::vector<size_t> owner_;
+
+    /**
+     *  Union-find parent of each registered object in the collision phase.
+     */
+    std::vector<size_t> group_;
+
     // @@ You must fill in appropriate data members for the Singleton pattern.
     static Universe *myInstance;
 
@@ -18,9 +18,10 @@
 #include <cmath>
 #include <algorithm>
 #include "VectorFunctors.h"
+#include "VectorExpression.h"
 
 template <size_t T>
-class Vector {
+class Vector : public VectorExpression<Vector<T>, T> {
 
 public:
 
@@ -59,6 +60,17 @@ public:
     */
     Vector(const Vector<T> &rhs) = default;
 
+    /**
+    * @brief evaluating constructor.
+    * @details creates a Vector holding the value of an arithmetic
+        expression, computed in a single loop
+    * @param a Vector expression
+    * @pre the expression has T elements
+    * @post creates a Vector equal to the expression
+    */
+    template <typename E>
+    Vector(const VectorExpression<E, T> &expr);
+
     /**
     * @brief destructor.
     * @details frees memory used to create the vector
@@ -77,6 +89,18 @@ public:
     */
     const Vector &operator =(const Vector &vec);
 
+    /**
+    * @brief evaluating assignment operator.
+    * @details assigns the value of an arithmetic expression to the Vector,
+        computed in a single loop. The expression may refer to this Vector.
+    * @param a Vector expression
+    * @return returns a reference to this Vector
+    * @pre the expression has T elements
+    * @post this Vector equals the expression
+    */
+    template <typename E>
+    const Vector &operator =(const VectorExpression<E, T> &expr);
+
     /**
     * @brief prints out the Vector.
     * @details prints out the Vector in a specific format
@@ -190,80 +214,30 @@ public:
     */
     bool operator !=(const Vector &vec) const;
 
-    /**
-    * @brief Vector addition operator.
-    * @details returns a Vector that is the sum of the given
-        Vector and the *this Vector
-    * @param a Vector
-    * @return a Vector
-    * @pre the Vectors have equal size
-    * @post both Vectors are unchanged
-    */
-    const Vector operator +(const Vector vec) const;
-
-    /**
-    * @brief unary minus operator.
-    * @details returns a Vector with all it's values negated
-    * @param none
-    * @return a Vector
-    * @pre the Vectors have equal size
-    * @post the original Vector is unchanged
-    */
-    Vector operator -() const;
-
     /**
     * @brief vector += operator.
     * @details returns a reference to the original Vector after
         it has been added with the given Vector
-    * @param a Vector
+    * @param a Vector or expression
     * @return a Vector
     * @pre the Vectors have equal size
     * @post this Vector's values are changed
     */
-    const Vector &operator +=(const Vector &vec);
-
-    /**
-    * @brief Vector subtraction operator.
-    * @details returns a Vector with its values equal to the
-        difference between the values in the original and given Vectors
-    * @param a Vector
-    * @return a Vector
-    * @pre the Vectors have equal size
-    * @post both Vectors are unchanged
-    */
-    Vector operator -(const Vector vec) const;
+    template <typename E>
+    const Vector &operator +=(const VectorExpression<E, T> &vec);
 
     /**
     * @brief -= operator.
     * @details returns a reference to the original Vector with its values
         equal to the difference between the values in the original
         and given Vectors
-    * @param a Vector
+    * @param a Vector or expression
     * @return a Vector
     * @pre the Vectors have equal size
     * @post the given Vector is unchanged
     */
-    Vector &operator -=(const Vector &vec);
-
-    /**
-    * @brief scalar multiplication operator.
-    * @details multiplies each member of the Vector by the scalar
-    * @param a double scalar
-    * @return a Vector
-    * @pre the Vector is valid
-    * @post the original Vector is unchanged
-    */
-    const Vector operator *(double scalar) const;
-
-    /**
-    * @brief vector multiplication operator.
-    * @details computs the dot product of the two Vectors
-    * @param a Vector
-    * @return a double
-    * @pre the Vectors are the same size
-    * @post both Vectors remain unchanged
-    */
-    double operator *(const Vector &vec) const;
+    template <typename E>
+    Vector &operator -=(const VectorExpression<E, T> &vec);
 
     /**
     * @brief vector cross product operator.
@@ -287,16 +261,6 @@ public:
     */
     Vector &operator *=(double scalar);
 
-    /**
-    * @brief scalar division operator.
-    * @details divides every value in the Vector by the scalar
-    * @param a double
-    * @return a Vector
-    * @pre the Vector is valid
-    * @post the Vector remains unchanged
-    */
-    Vector operator /(double scalar) const;
-
     /**
     * @brief /= operator.
     * @details updates the Vectors values by
@@ -318,21 +282,6 @@ private:
 
 };
 
-/**
-* @brief commutative scalar multiplication operator.
-* @details multiplies each member of the Vector by the scalar
-* @param a double scalar
-* @return a Vector
-* @pre the Vector is valid
-* @post the original Vector is unchanged
-*/
-template <size_t T>
-Vector<T> operator *(double scalar, const Vector<T> &vec) {
-    Vector<T> tmp(vec);
-    tmp = vec * scalar;
-    return tmp;
-}
-
 #include "Vector.tpp"
 
 typedef Vector<2> vector2;
@@ -23,6 +23,15 @@ Vector<T>::Vector(const double basis[]) {
     std::copy(basis, basis + T, std::begin(vector));
 }
 
+/**
+* @brief evaluating constructor.
+*/
+template <size_t T>
+template <typename E>
+Vector<T>::Vector(const VectorExpression<E, T> &expr) {
+    *this = expr;
+}
+
 /**
 * @brief destructor.
 */
@@ -38,6 +47,18 @@ const Vector<T> &Vector<T>::operator =(const Vector<T> &vec) {
     return *this;
 }
 
+/**
+* @brief evaluating assignment operator.
+*/
+template <size_t T>
+template <typename E>
+const Vector<T> &Vector<T>::operator =(const VectorExpression<E, T> &expr) {
+    for (size_t i = 0; i < T; ++i) {
+        vector[i] = expr[i];
+    }
+    return *this;
+}
+
 /**
 * @brief prints out the Vector.
 */
@@ -155,78 +176,26 @@ bool Vector<T>::operator !=(const Vector<T> &vec) const {
     return !(*this == vec);
 }
 
-/**
-* @brief Vector addition operator.
-*/
-template <size_t T>
-const Vector<T> Vector<T>::operator +(const Vector<T> vec) const {
-    Vector<T> tmp(*this);
-    add_x add;
-    std::transform(std::begin(vector), std::end(vector),
-                    std::begin(vec.vector), std::begin(tmp.vector), add);
-    return tmp;
-}
-
-/**
-* @brief unary minus operator.
-*/
-template <size_t T>
-Vector<T> Vector<T>::operator -() const {
-    Vector<T> tmp(*this);
-    negate_x negate;
-    std::for_each(std::begin(tmp.vector), std::end(tmp.vector), negate);
-    return tmp;
-}
-
 /**
 * @brief vector += operator.
 */
 template <size_t T>
-const Vector<T> &Vector<T>::operator +=(const Vector<T> &vec) {
+template <typename E>
+const Vector<T> &Vector<T>::operator +=(const VectorExpression<E, T> &vec) {
     *this = *this + vec;
     return *this;
 }
 
-/**
-* @brief vector subtraction operator.
-*/
-template <size_t T>
-Vector<T> Vector<T>::operator -(const Vector<T> vec) const {
-    Vector<T> tmp(*this);
-    subtract_x sub;
-    std::transform(std::begin(vector), std::end(vector),
-        std::begin(vec.vector), std::begin(tmp.vector), sub);
-    return tmp;
-}
-
 /**
 * @brief -= operator.
 */
 template <size_t T>
-Vector<T> &Vector<T>::operator -=(const Vector<T> &vec) {
+template <typename E>
+Vector<T> &Vector<T>::operator -=(const VectorExpression<E, T> &vec) {
     *this = *this - vec;
     return *this;
 }
 
-/**
-* @brief scalar multiplication operator.
-*/
-template <size_t T>
-const Vector<T> Vector<T>::operator *(double scalar) const {
-    Vector<T> tmp(*this);
-    multiply_x mult(scalar);
-    std::for_each(std::begin(tmp.vector), std::end(tmp.vector), mult);
-    return tmp;
-}
-
-/**
-* @brief vector multiplication operator.
-*/
-template <size_t T>
-double Vector<T>::operator *(const Vector<T> &vec) const {
-    return dot(vec);
-}
-
 /**
 * @brief vector cross product operator.
 */
@@ -244,18 +213,6 @@ Vector<T> &Vector<T>::operator *=(double scalar) {
     return *this;
 }
 
-/**
-* @brief scalar division operator.
-*/
-template <size_t T>
-Vector<T> Vector<T>::operator /(double scalar) const {
-    Vector<T> tmp(*this);
-    if (scalar != 0) {
-        return tmp * (1 / scalar);
-    }
-    return tmp;
-}
-
 /**
 * @brief /= operator.
 */
@@ -0,0 +1,269 @@
+/**
+ * @file: VectorExpression.h
+ * @author Ethan Raymond
+ * @Description: This file declares the expression templates used by the
+    Vector arithmetic operators
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#ifndef VECTOR_EXPRESSION_H
+#define VECTOR_EXPRESSION_H
+
+#include <cmath>
+#include <cstdlib> // For size_t
+
+template <size_t T>
+class Vector;
+
+/**
+* @brief base of every Vector and every unevaluated Vector arithmetic.
+* @details The arithmetic operators return lightweight nodes that record
+    their operands instead of computing a Vector. Assigning or converting
+    a node to a Vector evaluates the whole expression in a single loop,
+    element by element, so a chain such as pos + vel * seconds creates no
+    temporary Vectors. Each element is computed with the same operations
+    in the same order as the eager operators did, so results are bitwise
+    unchanged. E is the derived type and T the number of elements.
+*/
+template <typename E, size_t T>
+class VectorExpression {
+
+public:
+
+    /**
+    * @brief element access.
+    * @details returns the value of the expression at the given index
+    * @param a size_t index
+    * @return the double value at the given index
+    */
+    double operator [](size_t index) const {
+        return static_cast<const E&>(*this)[index];
+    }
+
+    /**
+    * @brief evaluates the expression.
+    * @details returns a Vector holding the value of the expression
+    * @param none
+    * @return a Vector
+    */
+    Vector<T> eval() const {
+        return Vector<T>(*this);
+    }
+
+    /**
+    * @brief normSq function.
+    * @details returns the square of the Norm (magnitude) of the expression
+    * @param none
+    * @return a double of the norm squared
+    */
+    double normSq() const {
+        double sum = 0;
+        for (size_t i = 0; i < T; ++i) {
+            double x = (*this)[i];
+            sum += x * x;
+        }
+        return sum;
+    }
+
+    /**
+    * @brief returns the Norm of the expression.
+    * @details returns the size (magnitude/norm) of the expression
+    * @param none
+    * @return a double of the Norm
+    */
+    double norm() const {
+        return std::sqrt(normSq());
+    }
+
+    /**
+    * @brief vector dot product.
+    * @details returns the dot product of the expression and another
+    * @param a Vector or expression
+    * @return a double
+    */
+    template <typename R>
+    double dot(const VectorExpression<R, T> &rhs) const {
+        double sum = 0;
+        for (size_t i = 0; i < T; ++i) {
+            sum += (*this)[i] * rhs[i];
+        }
+        return sum;
+    }
+
+};
+
+/**
+* @brief how a node holds an operand.
+* @details Vectors are held by reference, since they outlive the full
+    expression that uses them. Nodes are small and usually temporaries,
+    so they are held by value.
+*/
+template <typename E>
+struct VectorOperand {
+    typedef const E type;
+};
+
+template <size_t T>
+struct VectorOperand<Vector<T> > {
+    typedef const Vector<T> &type;
+};
+
+/**
+* @brief element-wise sum of two expressions.
+*/
+template <typename L, typename R, size_t T>
+class VectorSum : public VectorExpression<VectorSum<L, R, T>, T> {
+public:
+    VectorSum(const L &lhs, const R &rhs) : lhs_(lhs), rhs_(rhs) {}
+    double operator [](size_t index) const {
+        return lhs_[index] + rhs_[index];
+    }
+private:
+    typename VectorOperand<L>::type lhs_;
+    typename VectorOperand<R>::type rhs_;
+};
+
+/**
+* @brief element-wise difference of two expressions.
+*/
+template <typename L, typename R, size_t T>
+class VectorDifference : public VectorExpression<VectorDifference<L, R, T>,
+        T> {
+public:
+    VectorDifference(const L &lhs, const R &rhs) : lhs_(lhs), rhs_(rhs) {}
+    double operator [](size_t index) const {
+        return lhs_[index] - rhs_[index];
+    }
+private:
+    typename VectorOperand<L>::type lhs_;
+    typename VectorOperand<R>::type rhs_;
+};
+
+/**
+* @brief expression multiplied by a scalar.
+*/
+template <typename E, size_t T>
+class VectorScaled : public VectorExpression<VectorScaled<E, T>, T> {
+public:
+    VectorScaled(const E &vec, double scalar) : vec_(vec), scalar_(scalar) {}
+    double operator [](size_t index) const {
+        return vec_[index] * scalar_;
+    }
+private:
+    typename VectorOperand<E>::type vec_;
+    double scalar_;
+};
+
+/**
+* @brief negated expression.
+*/
+template <typename E, size_t T>
+class VectorNegated : public VectorExpression<VectorNegated<E, T>, T> {
+public:
+    explicit VectorNegated(const E &vec) : vec_(vec) {}
+    double operator [](size_t index) const {
+        return -vec_[index];
+    }
+private:
+    typename VectorOperand<E>::type vec_;
+};
+
+/**
+* @brief Vector addition operator.
+* @details returns the sum of the two expressions
+* @param two Vectors or expressions
+* @return an expression
+* @pre the Vectors have equal size
+* @post both operands are unchanged
+*/
+template <typename L, typename R, size_t T>
+VectorSum<L, R, T> operator +(const VectorExpression<L, T> &lhs,
+        const VectorExpression<R, T> &rhs) {
+    return VectorSum<L, R, T>(static_cast<const L&>(lhs),
+        static_cast<const R&>(rhs));
+}
+
+/**
+* @brief Vector subtraction operator.
+* @details returns the difference between the two expressions
+* @param two Vectors or expressions
+* @return an expression
+* @pre the Vectors have equal size
+* @post both operands are unchanged
+*/
+template <typename L, typename R, size_t T>
+VectorDifference<L, R, T> operator -(const VectorExpression<L, T> &lhs,
+        const VectorExpression<R, T> &rhs) {
+    return VectorDifference<L, R, T>(static_cast<const L&>(lhs),
+        static_cast<const R&>(rhs));
+}
+
+/**
+* @brief unary minus operator.
+* @details returns the expression with all its values negated
+* @param a Vector or expression
+* @return an expression
+* @post the operand is unchanged
+*/
+template <typename E, size_t T>
+VectorNegated<E, T> operator -(const VectorExpression<E, T> &vec) {
+    return VectorNegated<E, T>(static_cast<const E&>(vec));
+}
+
+/**
+* @brief scalar multiplication operator.
+* @details multiplies each member of the expression by the scalar
+* @param a Vector or expression and a double scalar
+* @return an expression
+* @post the operand is unchanged
+*/
+template <typename E, size_t T>
+VectorScaled<E, T> operator *(const VectorExpression<E, T> &vec,
+        double scalar) {
+    return VectorScaled<E, T>(static_cast<const E&>(vec), scalar);
+}
+
+/**
+* @brief commutative scalar multiplication operator.
+* @details multiplies each member of the expression by the scalar
+* @param a double scalar and a Vector or expression
+* @return an expression
+* @post the operand is unchanged
+*/
+template <typename E, size_t T>
+VectorScaled<E, T> operator *(double scalar,
+        const VectorExpression<E, T> &vec) {
+    return VectorScaled<E, T>(static_cast<const E&>(vec), scalar);
+}
+
+/**
+* @brief scalar division operator.
+* @details multiplies each member of the expression by 1 / scalar, or
+    leaves the expression unchanged if the scalar is 0
+* @param a Vector or expression and a double
+* @return an expression
+* @post the operand is unchanged
+*/
+template <typename E, size_t T>
+VectorScaled<E, T> operator /(const VectorExpression<E, T> &vec,
+        double scalar) {
+    return VectorScaled<E, T>(static_cast<const E&>(vec),
+        scalar != 0 ? 1 / scalar : 1);
+}
+
+/**
+* @brief vector multiplication operator.
+* @details computes the dot product of the two expressions
+* @param two Vectors or expressions
+* @return a double
+* @pre the Vectors are the same size
+* @post both operands remain unchanged
+*/
+template <typename L, typename R, size_t T>
+double operator *(const VectorExpression<L, T> &lhs,
+        const VectorExpression<R, T> &rhs) {
+    return lhs.dot(rhs);
+}
+
+#endif
@@ -7,6 +7,7 @@
 */
 
 #include "Visitor.h"
+#include "Profiler.h"
 
 /**
  *  Pure virtual destructor. A necessary no-op since this is a base class.
@@ -54,11 +55,10 @@ void PrintVisitor::visit(SimpleObject& object) {
  *  Prints the aggregate object's name.
  */
 void PrintVisitor::visit(AggregateObject& object) {
-    std::string name = object.getName();
+    os_ << object.getName();
     std::for_each(object.begin(), object.end(), [&](Object* obj){
-        name += obj->getName();
+        os_ << obj->getName();
     });
-    os_ << name;
 }
 
 
@@ -77,11 +77,12 @@ Object* MoverVisitor::getObject() {
  */
 void MoverVisitor::visit(SimpleObject &object){
     Universe* univ(Universe::instance());
-    copy = object.clone();
-    vector2 totalForce;
-    std::for_each(univ->begin(), univ->end(), [&](Object* otherObj){
-        totalForce += Universe::getForce(*copy, *otherObj);
-    });
+    {
+        PROFILE_PHASE(SNAPSHOT);
+        copy = object.clone();
+    }
+    PROFILE_PHASE(FORCES);
+    vector2 totalForce = univ->getTotalForce(object);
     vector2 accel = totalForce / object.getMass();
     vector2 changeVel = accel * seconds_;
     vector2 vel = object.getVelocity() + changeVel;
@@ -94,14 +95,104 @@ void MoverVisitor::visit(SimpleObject &object){
  *  Does nothing for an immobile object.
  */
 void MoverVisitor::visit(ImmobileObject &object) {
+    PROFILE_PHASE(SNAPSHOT);
     copy = object.clone();
 }
 
 /**
- *  Moves the aggregate object.
+ *  Moves the aggregate object's members in place, then copies it.
  */
 void MoverVisitor::visit(AggregateObject &object){
+    {
+        PROFILE_PHASE(AGGREGATE);
+        object.getStrategy()->move(seconds_, object);
+    }
+    PROFILE_PHASE(SNAPSHOT);
     copy = object.clone();
-    copy->getStrategy()->move(seconds_,
-        *(dynamic_cast<AggregateObject*> (copy)));
+}
+
+/**
+ * Constructor
+ */
+KickVisitor::KickVisitor(double seconds) : seconds_(seconds) {}
+
+/**
+ *  Kicks the simple object.
+ */
+void KickVisitor::visit(SimpleObject &object) {
+    Universe* univ(Universe::instance());
+    vector2 totalForce = univ->getTotalForce(object);
+    vector2 accel = totalForce / object.getMass();
+    object.setVelocity(object.getVelocity() + accel * seconds_);
+}
+
+/**
+ *  Does nothing for an immobile object.
+ */
+void KickVisitor::visit(ImmobileObject &object) {}
+
+/**
+ *  Kicks the aggregate object through its strategy.
+ */
+void KickVisitor::visit(AggregateObject &object) {
+    object.getStrategy()->kick(seconds_, object);
+}
+
+/**
+ * Constructor
+ */
+DriftVisitor::DriftVisitor(double seconds) : seconds_(seconds) {}
+
+/**
+ *  Drifts the simple object.
+ */
+void DriftVisitor::visit(SimpleObject &object) {
+    object.setPosition(object.getPosition() + object.getVelocity() * seconds_);
+}
+
+/**
+ *  Does nothing for an immobile object.
+ */
+void DriftVisitor::visit(ImmobileObject &object) {}
+
+/**
+ *  Drifts the aggregate object through its strategy.
+ */
+void DriftVisitor::visit(AggregateObject &object) {
+    object.getStrategy()->drift(seconds_, object);
+}
+
+/**
+ * Constructor
+ */
+AccelerationVisitor::AccelerationVisitor(std::vector<double> &ax,
+    std::vector<double> &ay) : ax_(ax), ay_(ay) {}
+
+/**
+ *  Writes the acceleration of the simple object.
+ */
+void AccelerationVisitor::visit(SimpleObject &object) {
+    Universe* univ(Universe::instance());
+    vector2 accel = univ->getTotalForce(object) / object.getMass();
+    size_t first, last;
+    object.getSlots(first, last);
+    ax_[first] = accel[0];
+    ay_[first] = accel[1];
+}
+
+/**
+ *  Writes zero for an immobile object.
+ */
+void AccelerationVisitor::visit(ImmobileObject &object) {
+    size_t first, last;
+    object.getSlots(first, last);
+    ax_[first] = ay_[first] = 0;
+}
+
+/**
+ *  Writes the accelerations of the aggregate's members through its
+ *  strategy.
+ */
+void AccelerationVisitor::visit(AggregateObject &object) {
+    object.getStrategy()->accelerate(object, ax_, ay_);
 }
\ No newline at end of file
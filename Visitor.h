@@ -115,7 +115,7 @@ public:
     virtual void visit(ImmobileObject &object);
 
     /**
-     *  Moves the aggregate object.
+     *  Moves the aggregate object's members in place, then copies it.
      */
     virtual void visit(AggregateObject &object);
 
@@ -133,4 +133,117 @@ private:
 
 };
 
+/**
+ *  A visitor that adds force / mass times the given number of seconds to
+ *  the velocity of the visited object, in place. Forces depend only on the
+ *  positions, which a kick leaves untouched, so objects may be kicked in
+ *  any order or concurrently.
+ */
+class KickVisitor : public Visitor {
+public:
+
+    /**
+     * Constructor
+     */
+    KickVisitor(double seconds);
+
+    /**
+     *  Kicks the simple object.
+     */
+    virtual void visit(SimpleObject &object);
+
+    /**
+     *  Does nothing for an immobile object.
+     */
+    virtual void visit(ImmobileObject &object);
+
+    /**
+     *  Kicks the aggregate object through its strategy.
+     */
+    virtual void visit(AggregateObject &object);
+
+private:
+
+    /**
+     * Number of seconds to kick
+     */
+    double seconds_;
+
+};
+
+/**
+ *  A visitor that moves the visited object by its velocity times the given
+ *  number of seconds, in place.
+ */
+class DriftVisitor : public Visitor {
+public:
+
+    /**
+     * Constructor
+     */
+    DriftVisitor(double seconds);
+
+    /**
+     *  Drifts the simple object.
+     */
+    virtual void visit(SimpleObject &object);
+
+    /**
+     *  Does nothing for an immobile object.
+     */
+    virtual void visit(ImmobileObject &object);
+
+    /**
+     *  Drifts the aggregate object through its strategy.
+     */
+    virtual void visit(AggregateObject &object);
+
+private:
+
+    /**
+     * Number of seconds to drift
+     */
+    double seconds_;
+
+};
+
+/**
+ *  A visitor that writes force / mass for every body of the visited object
+ *  into the body's slot of two acceleration arrays, leaving the object
+ *  untouched. Immobile objects get zero.
+ */
+class AccelerationVisitor : public Visitor {
+public:
+
+    /**
+     * Constructor
+     */
+    AccelerationVisitor(std::vector<double> &ax, std::vector<double> &ay);
+
+    /**
+     *  Writes the acceleration of the simple object.
+     */
+    virtual void visit(SimpleObject &object);
+
+    /**
+     *  Writes zero for an immobile object.
+     */
+    virtual void visit(ImmobileObject &object);
+
+    /**
+     *  Writes the accelerations of the aggregate's members through its
+     *  strategy.
+     */
+    virtual void visit(AggregateObject &object);
+
+private:
+
+    /**
+     * Arrays receiving the accelerations, indexed by store slot
+     */
+    std::vector<double> &ax_;
+    std::vector<double> &ay_;
+
+};
+
 #endif
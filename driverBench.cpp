@@ -0,0 +1,2004 @@
+/**
+ * @file: driverBench.cpp
+ * @author Ethan Raymond
+ * @Description: Benchmarks for the simulation. Run with a benchmark name to
+    run only that benchmark, or without arguments to run all of them. Run
+    with "suite" and Google Benchmark's flags for the suite of micro and
+    whole-step benchmarks, which can write its results as JSON.
+ * @Honor Code: I pledge my honor that I have neither given nor received
+    unauthorized aid on this work.
+*/
+
+#include "Universe.h"
+#include "Object.h"
+#include "Visitor.h"
+#include "AggregateStrategy.h"
+#include "ForceStrategy.h"
+#include "GravityKernel.h"
+#include "Integrator.h"
+#include "FrameWriter.h"
+#include "FrameRing.h"
+#include "Parser.h"
+#include "SpatialHash.h"
+#include "Trajectory.h"
+#include "Profiler.h"
+#include "ObjectPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <regex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace {
+
+const double AU = 149597870700.0;
+const double SUN_MASS = 1.98892e30;
+
+/**
+ *  Returns the number of seconds since an arbitrary epoch.
+ */
+double now() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+vector2 makeVector2(double x = 0, double y = 0) {
+    vector2 v;
+    v[0] = x;
+    v[1] = y;
+    return v;
+}
+
+/**
+ *  Fills a fresh Universe with a sun and n - 1 bodies on circular orbits
+ *  spread uniformly over an annulus between 0.5 and 1.5 AU.
+ */
+Universe* createDisk(size_t n, unsigned seed = 1) {
+    delete Universe::instance();
+    Universe* u(Universe::instance());
+    u->addObject(new ImmobileObject("sun", SUN_MASS, vector2()));
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> radius(0.5 * AU, 1.5 * AU);
+    std::uniform_real_distribution<double> angle(0, 2 * M_PI);
+    std::uniform_real_distribution<double> mass(1e22, 1e24);
+    for (size_t i = 1; i < n; ++i) {
+        double r = radius(rng);
+        double a = angle(rng);
+        double v = std::sqrt(Universe::G * SUN_MASS / r);
+        u->addObject(new SimpleObject("body", mass(rng),
+            makeVector2(r * std::cos(a), r * std::sin(a)),
+            makeVector2(-v * std::sin(a), v * std::cos(a))));
+    }
+    return u;
+}
+
+/**
+ *  Fills a fresh Universe with the scene of the drawing driver's
+ *  createUniverse(): a sun, two earths and two aggregates of four bodies
+ *  10 km apart. The realistic cluster would need sub-second steps to
+ *  resolve its members' orbits around each other, so both aggregates are
+ *  rigid here.
+ */
+Universe* createScene() {
+    delete Universe::instance();
+    Universe* u(Universe::instance());
+    const double v = 29788.4676, m = 1.49355e24;
+    u->addObject(new ImmobileObject("sun", SUN_MASS, vector2()));
+    u->addObject(new SimpleObject("earth1", 5.9742e24, makeVector2(AU, 0),
+        makeVector2(0, v)));
+    u->addObject(new SimpleObject("earth2", 5.9742e24, makeVector2(-AU, 0),
+        makeVector2(0, -v)));
+    const vector2 offsets[] = {makeVector2(0, 10000), makeVector2(-10000, 0),
+        makeVector2(0, -10000), makeVector2(10000, 0)};
+    for (int a = 0; a < 2; ++a) {
+        vector2 center = makeVector2(0, a == 0 ? AU : -AU);
+        vector2 velocity = makeVector2(a == 0 ? -v : v, 0);
+        std::vector<Object*> members;
+        for (int i = 0; i < 4; ++i) {
+            members.push_back(new SimpleObject("member", m,
+                center + offsets[i], velocity));
+        }
+        Object* aggregate = new AggregateObject("aggregate", members);
+        aggregate->setAggregateStrategy(new RigidStrategy());
+        u->addObject(aggregate);
+    }
+    return u;
+}
+
+/**
+ *  Returns the kinetic plus potential energy of the Universe's bodies.
+ */
+double totalEnergy(const Universe* u) {
+    const BodyStore &b = u->getBodies();
+    double energy = 0;
+    for (size_t i = 0; i < b.size(); ++i) {
+        energy += 0.5 * b.mass[i] * (b.vx[i] * b.vx[i] + b.vy[i] * b.vy[i]);
+        for (size_t j = 0; j < i; ++j) {
+            double dist = std::hypot(b.x[i] - b.x[j], b.y[i] - b.y[j]);
+            if (dist > 0) {
+                energy -= Universe::G * b.mass[i] * b.mass[j] / dist;
+            }
+        }
+    }
+    return energy;
+}
+
+/**
+ *  Times one force phase of the current strategy. When sample is smaller
+ *  than the number of objects only every k-th object is evaluated and the
+ *  time is scaled up to the full population. The forces of the evaluated
+ *  objects are appended to forces.
+ */
+double timeForcePhase(Universe* u, size_t sample,
+                      std::vector<vector2>& forces) {
+    size_t n = u->end() - u->begin();
+    size_t stride = std::max<size_t>(1, n / sample);
+    double start = now();
+    u->getForceStrategy()->prepare(u->getBodies());
+    size_t evaluated = 0;
+    for (size_t i = 0; i < n; i += stride, ++evaluated) {
+        forces.push_back(u->getTotalForce(**(u->begin() + i)));
+    }
+    return (now() - start) * n / evaluated;
+}
+
+/**
+ *  Compares the all-pairs and Barnes-Hut force phases at 1k, 10k and 100k
+ *  bodies. All-pairs is timed on a sample of at most 1000 targets (100 at
+ *  100k) and scaled, since a full 100k step takes minutes. The error columns
+ *  are the RMS and maximum of |F_bh - F| / |F| over the sampled bodies.
+ */
+void benchBarnesHut() {
+    std::printf("%-8s %-6s %14s %14s %10s %10s\n", "bodies", "theta",
+        "all-pairs ms", "barnes-hut ms", "rms err", "max err");
+    const size_t sizes[] = {1000, 10000, 100000};
+    const double thetas[] = {0.3, 0.5, 0.8};
+    for (size_t s = 0; s < 3; ++s) {
+        size_t n = sizes[s];
+        size_t sample = n >= 100000 ? 100 : 1000;
+        Universe* u = createDisk(n);
+
+        std::vector<vector2> exact;
+        u->setForceStrategy(new AllPairsStrategy());
+        double direct = timeForcePhase(u, sample, exact);
+
+        for (size_t t = 0; t < 3; ++t) {
+            u->setForceStrategy(new BarnesHutStrategy(thetas[t]));
+            std::vector<vector2> all;
+            double tree = timeForcePhase(u, n, all);
+            std::vector<vector2> approx;
+            timeForcePhase(u, sample, approx);
+
+            // The first sample is the sun, whose net force nearly cancels
+            // and which never moves, so it is left out of the error.
+            double sum = 0, worst = 0;
+            for (size_t i = 1; i < exact.size(); ++i) {
+                double err = (approx[i] - exact[i]).norm() / exact[i].norm();
+                sum += err * err;
+                worst = std::max(worst, err);
+            }
+            std::printf("%-8zu %-6.2f %14.2f %14.2f %10.2e %10.2e\n", n,
+                thetas[t], direct * 1e3, tree * 1e3,
+                std::sqrt(sum / (exact.size() - 1)), worst);
+        }
+    }
+    delete Universe::instance();
+}
+
+/**
+ *  Times double-buffered steps for an increasing number of threads, for
+ *  all-pairs at 10k bodies and Barnes-Hut at 100k bodies, and checks that
+ *  every thread count produces bitwise the same state as a single thread.
+ */
+void benchThreads() {
+    size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> counts;
+    for (size_t t = 1; t <= std::max<size_t>(4, 2 * hardware); t *= 2) {
+        counts.push_back(t);
+    }
+
+    std::printf("hardware threads: %zu\n", hardware);
+    std::printf("%-12s %-8s %8s %12s %8s %10s\n", "strategy", "bodies",
+        "threads", "ms/step", "speedup", "identical");
+    const int steps = 3;
+    for (int s = 0; s < 2; ++s) {
+        size_t n = s == 0 ? 10000 : 100000;
+        double serial = 0;
+        BodyStore reference;
+        for (size_t c = 0; c < counts.size(); ++c) {
+            Universe* u = createDisk(n);
+            if (s == 1) {
+                u->setForceStrategy(new BarnesHutStrategy());
+            }
+            u->setDoubleBuffered(true);
+            u->setThreadCount(counts[c]);
+            u->stepSimulation(100);
+
+            double start = now();
+            for (int i = 0; i < steps; ++i) {
+                u->stepSimulation(100);
+            }
+            double elapsed = (now() - start) / steps;
+
+            const BodyStore &bodies = u->getBodies();
+            if (c == 0) {
+                serial = elapsed;
+                reference = bodies;
+            }
+            bool identical = bodies.x == reference.x
+                && bodies.y == reference.y && bodies.vx == reference.vx
+                && bodies.vy == reference.vy;
+            std::printf("%-12s %-8zu %8zu %12.2f %8.2f %10s\n",
+                s == 0 ? "all-pairs" : "barnes-hut", n, counts[c],
+                elapsed * 1e3, serial / elapsed, identical ? "yes" : "NO");
+        }
+    }
+    delete Universe::instance();
+}
+
+/**
+ *  Measures pairwise interactions per second for a tile of 4096 sources:
+ *  first through Universe::getForce on detached objects, the per-pair path
+ *  the simulation used before the kernel, then through every GravityKernel
+ *  variant the CPU supports. The error column is the largest relative
+ *  difference from the scalar variant over the targets.
+ */
+void benchKernel() {
+    const size_t sources = 4096, targets = 256;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> coord(-AU, AU);
+    std::uniform_real_distribution<double> mass(1e22, 1e24);
+    BodyStore bodies;
+    std::vector<Object*> objects;
+    for (size_t j = 0; j < sources; ++j) {
+        vector2 pos = makeVector2(coord(rng), coord(rng));
+        double m = mass(rng);
+        bodies.set(j, pos, vector2(), m);
+        objects.push_back(new SimpleObject("body", m, pos, vector2()));
+    }
+    double pairs = double(sources) * targets;
+
+    double start = now();
+    double sink = 0;
+    for (size_t i = 0; i < targets; ++i) {
+        vector2 force;
+        for (size_t j = 0; j < sources; ++j) {
+            force += Universe::getForce(*objects[i], *objects[j]);
+        }
+        sink += force[0];
+    }
+    double baseline = pairs / (now() - start);
+
+    std::printf("%-10s %14s %8s %10s\n", "kernel", "Minteract/s",
+        "speedup", "max err");
+    std::printf("%-10s %14.1f %8.2f %10s\n", "getForce", baseline * 1e-6,
+        1.0, "-");
+
+    GravityKernel::Isa detected = GravityKernel::getIsa();
+    const GravityKernel::Isa isas[] = {GravityKernel::SCALAR,
+        GravityKernel::SSE2, GravityKernel::AVX2, GravityKernel::AVX512};
+    std::vector<double> reference;
+    for (size_t k = 0; k < 4; ++k) {
+        if (!GravityKernel::setIsa(isas[k])) {
+            continue;
+        }
+        std::vector<double> ax(targets), ay(targets);
+        int repeats = 20;
+        start = now();
+        for (int r = 0; r < repeats; ++r) {
+            for (size_t i = 0; i < targets; ++i) {
+                ax[i] = ay[i] = 0;
+                GravityKernel::accumulate(bodies.x.data(), bodies.y.data(),
+                    bodies.mass.data(), sources, bodies.x[i], bodies.y[i],
+                    ax[i], ay[i]);
+            }
+        }
+        double rate = pairs * repeats / (now() - start);
+        if (reference.empty()) {
+            reference = ax;
+            reference.insert(reference.end(), ay.begin(), ay.end());
+        }
+        double worst = 0;
+        for (size_t i = 0; i < targets; ++i) {
+            double norm = std::hypot(reference[i], reference[targets + i]);
+            worst = std::max(worst, std::hypot(ax[i] - reference[i],
+                ay[i] - reference[targets + i]) / norm);
+            sink += ax[i];
+        }
+        std::printf("%-10s %14.1f %8.2f %10.2e\n",
+            GravityKernel::getName(isas[k]), rate * 1e-6, rate / baseline,
+            worst);
+    }
+    GravityKernel::setIsa(detected);
+    std::printf("dispatched: %s\n", GravityKernel::getName(detected));
+    if (sink == 0) {
+        std::printf("\n");
+    }
+    std::for_each(objects.begin(), objects.end(), [](Object* obj){
+        delete obj;
+    });
+}
+
+/**
+ *  For every integrator and target energy error, finds the largest step of
+ *  the form 100 s * 2^k (k >= 0) whose worst relative energy error over one
+ *  year of createScene() stays under the target, then times that year
+ *  without the energy checks. A dash means even 100 s steps, the step the
+ *  drawing driver uses, miss the target.
+ */
+void benchIntegrators() {
+    struct Scheme {
+        const char* name;
+        int kicks;
+        Integrator* (*make)();
+    };
+    const Scheme schemes[] = {
+        {"euler", 1, []() -> Integrator* { return new EulerIntegrator(); }},
+        {"leapfrog", 1,
+            []() -> Integrator* { return new LeapfrogIntegrator(); }},
+        {"verlet", 2,
+            []() -> Integrator* { return new VelocityVerletIntegrator(); }},
+        {"yoshida4", 3,
+            []() -> Integrator* { return new YoshidaIntegrator(); }},
+    };
+    const double year = 31554195.932106005998594489072144;
+    const double targets[] = {1e-6, 1e-9};
+
+    std::printf("%-10s %8s %10s %8s %10s %10s %8s\n", "integrator",
+        "target", "step s", "steps", "forces", "ms/year", "speedup");
+    for (int t = 0; t < 2; ++t) {
+        double euler = 0;
+        for (int s = 0; s < 4; ++s) {
+            double step = 0;
+            for (int k = 13; k >= 0 && step == 0; --k) {
+                double dt = 100.0 * (1 << k);
+                Universe* u = createScene();
+                u->setDoubleBuffered(true);
+                u->setIntegrator(schemes[s].make());
+                double initial = totalEnergy(u);
+                bool within = true;
+                for (double time = 0; time < year && within; time += dt) {
+                    u->stepSimulation(dt);
+                    within = std::abs(totalEnergy(u) / initial - 1)
+                        <= targets[t];
+                }
+                if (within) {
+                    step = dt;
+                }
+            }
+            if (step == 0) {
+                std::printf("%-10s %8.0e %10s\n", schemes[s].name,
+                    targets[t], "-");
+                continue;
+            }
+
+            Universe* u = createScene();
+            u->setDoubleBuffered(true);
+            u->setIntegrator(schemes[s].make());
+            size_t steps = 0;
+            double start = now();
+            for (double time = 0; time < year; time += step, ++steps) {
+                u->stepSimulation(step);
+            }
+            double elapsed = now() - start;
+            if (s == 0) {
+                euler = elapsed;
+            }
+            std::printf("%-10s %8.0e %10.0f %8zu %10zu %10.2f",
+                schemes[s].name, targets[t], step, steps,
+                steps * schemes[s].kicks, elapsed * 1e3);
+            if (euler > 0) {
+                std::printf(" %8.1f\n", euler / elapsed);
+            } else {
+                std::printf(" %8s\n", "-");
+            }
+        }
+    }
+    delete Universe::instance();
+}
+
+/**
+ *  Barnes-Hut that rebuilds its tree for every set of active bodies,
+ *  however small, as the block timestep integrator did before
+ *  prepareFor().
+ */
+class RebuildingStrategy : public BarnesHutStrategy {
+public:
+
+    void prepareFor(const BodyStore &bodies, size_t targets) {
+        prepare(bodies);
+    }
+
+};
+
+/**
+ *  Fills a fresh Universe with a disk of n bodies plus a binary made of two
+ *  of createUniverse()'s cluster members, 20 km apart with a period of
+ *  about a second. (The four-body square of createUniverse() starts from
+ *  rest and collapses onto its center, which no unsoftened integrator
+ *  survives.)
+ */
+Universe* createBinaryDisk(size_t n) {
+    Universe* u = createDisk(n);
+    const double v = 29788.4676, m = 1.49355e24, r = 10000;
+    double spin = std::sqrt(Universe::G * m / (4 * r));
+    std::vector<Object*> members;
+    for (int i = -1; i <= 1; i += 2) {
+        members.push_back(new SimpleObject("member", m,
+            makeVector2(i * r, -AU), makeVector2(v, i * spin)));
+    }
+    Object* cluster = new AggregateObject("cluster", members);
+    cluster->setAggregateStrategy(new RealisticStrategy());
+    u->addObject(cluster);
+    return u;
+}
+
+/**
+ *  Runs the 1000-body binary disk through three 100 s steps of the block
+ *  timestep integrator. Reports the number of body force evaluations
+ *  against what a single global step at the deepest level in use would
+ *  need, and the relative energy error. Then times the same run with
+ *  Barnes-Hut, rebuilding the tree for every set of active bodies and
+ *  only for sets of at least getBreakEven() bodies.
+ */
+void benchBlockTimesteps() {
+    Universe* u = createBinaryDisk(1000);
+    BlockTimestepIntegrator* block = new BlockTimestepIntegrator(20);
+    u->setIntegrator(block);
+    u->setDoubleBuffered(true);
+    size_t count = u->end() - u->begin();
+    size_t bodies = u->getBodies().size();
+    double initial = totalEnergy(u);
+
+    const int steps = 3;
+    int deepest = 0;
+    double start = now();
+    for (int i = 0; i < steps; ++i) {
+        u->stepSimulation(100);
+        for (size_t j = 0; j < count; ++j) {
+            deepest = std::max(deepest, block->getLevel(j));
+        }
+    }
+    double elapsed = now() - start;
+
+    std::vector<size_t> histogram(21);
+    for (size_t j = 0; j < count; ++j) {
+        ++histogram[block->getLevel(j)];
+    }
+    double uniform = double(bodies) * (size_t(1) << deepest) * steps;
+    std::printf("bodies %zu, deepest level %d\n", bodies, deepest);
+    std::printf("%-24s %14zu\n", "block evaluations",
+        block->getForceEvaluations());
+    std::printf("%-24s %14.0f\n", "uniform evaluations", uniform);
+    std::printf("%-24s %14.1f\n", "reduction",
+        uniform / block->getForceEvaluations());
+    std::printf("%-24s %14.2f\n", "block seconds", elapsed);
+    std::printf("%-24s %14.2e\n", "energy error",
+        std::abs(totalEnergy(u) / initial - 1));
+    std::printf("objects per level:");
+    for (int l = 0; l <= 20; ++l) {
+        if (histogram[l] > 0) {
+            std::printf(" %d:%zu", l, histogram[l]);
+        }
+    }
+    std::printf("\n");
+
+    const char* const names[] = {"rebuild every set", "prepareFor"};
+    for (int i = 0; i < 2; ++i) {
+        u = createBinaryDisk(1000);
+        u->setForceStrategy(i == 0 ? new RebuildingStrategy()
+                                   : new BarnesHutStrategy());
+        u->setIntegrator(new BlockTimestepIntegrator(20));
+        u->setDoubleBuffered(true);
+        start = now();
+        for (int j = 0; j < steps; ++j) {
+            u->stepSimulation(100);
+        }
+        std::printf("%-24s %14.2f s\n", names[i], now() - start);
+    }
+    delete Universe::instance();
+}
+
+/**
+ *  Draws objects the way the drawing driver does, into a FrameWriter, on a
+ *  500 pixel square view 4 AU across.
+ */
+class FrameVisitor : public Visitor {
+public:
+
+    FrameVisitor(FrameWriter &writer) : writer_(writer) {}
+
+    void visit(SimpleObject &object) {
+        vector2 pos = object.getPosition();
+        writer_.add(toScreen(pos[0]), toScreen(-pos[1]), 10,
+            object.getNameId());
+    }
+
+    void visit(ImmobileObject &object) {
+        vector2 pos = object.getPosition();
+        writer_.add(toScreen(pos[0]), toScreen(-pos[1]), 20,
+            object.getNameId());
+    }
+
+    void visit(AggregateObject &object) {
+        std::for_each(object.begin(), object.end(), [&](Object* obj){
+            obj->accept(*this);
+        });
+    }
+
+    static int toScreen(double x) {
+        return 500 * (x + 2 * AU) / (4 * AU);
+    }
+
+private:
+
+    FrameWriter &writer_;
+
+};
+
+/**
+ *  The drawing driver's original IPC path: every field goes to the stream
+ *  on its own, followed by a flush.
+ */
+class FlushingVisitor : public Visitor {
+public:
+
+    FlushingVisitor(std::ostream &os) : os_(os) {}
+
+    void visit(SimpleObject &object) {
+        draw(object, 10);
+    }
+
+    void visit(ImmobileObject &object) {
+        draw(object, 20);
+    }
+
+    void visit(AggregateObject &object) {
+        std::for_each(object.begin(), object.end(), [&](Object* obj){
+            obj->accept(*this);
+        });
+    }
+
+    void endFrame() {
+        os_.put(0);
+        os_.flush();
+    }
+
+private:
+
+    void draw(Object &object, int r) {
+        vector2 pos = object.getPosition();
+        int x = FrameVisitor::toScreen(pos[0]);
+        int y = FrameVisitor::toScreen(-pos[1]);
+        int d = r / 2;
+        opcode(1);
+        integer(x - d);
+        integer(y - d);
+        integer(2 * r);
+        integer(2 * r);
+        opcode(2);
+        std::string name = object.getName();
+        os_.write(name.c_str(), name.length());
+        os_.put(0);
+        os_.flush();
+        integer(x);
+        integer(y);
+    }
+
+    void opcode(char op) {
+        os_.put(op);
+        os_.flush();
+    }
+
+    void integer(int i) {
+        os_.write((char*) &i, 4);
+        os_.flush();
+    }
+
+    std::ostream &os_;
+
+};
+
+/**
+ *  Encodes and writes frames of 10k objects to /dev/null, through the
+ *  original flush-per-field path and through FrameWriter in both formats,
+ *  and reports frames per second. The universe is not stepped, so only
+ *  the drawing path is timed.
+ */
+void benchDrawer() {
+    Universe* u = createDisk(10000);
+    const double budget = 1;
+    std::printf("%-10s %12s %12s %10s\n", "protocol", "bytes/frame",
+        "frames/s", "speedup");
+
+    std::ofstream sink("/dev/null", std::ios::binary);
+    FlushingVisitor flushing(sink);
+    int frames = 0;
+    double start = now();
+    while (now() - start < budget) {
+        for (Universe::iterator i = u->begin(); i != u->end(); ++i) {
+            (*i)->accept(flushing);
+        }
+        flushing.endFrame();
+        ++frames;
+    }
+    double legacy = frames / (now() - start);
+    std::printf("%-10s %12s %12.1f %10.1f\n", "flushing", "-", legacy, 1.0);
+
+    int fd = open("/dev/null", O_WRONLY);
+    const FrameWriter::Format formats[] = {FrameWriter::OPCODES,
+        FrameWriter::FRAMED};
+    const char* names[] = {"opcodes", "framed"};
+    for (int f = 0; f < 2; ++f) {
+        FrameWriter writer(fd, formats[f]);
+        FrameVisitor drawer(writer);
+        start = now();
+        while (now() - start < budget) {
+            for (Universe::iterator i = u->begin(); i != u->end(); ++i) {
+                (*i)->accept(drawer);
+            }
+            writer.endFrame();
+        }
+        double rate = writer.getFrameCount() / (now() - start);
+        std::printf("%-10s %12zu %12.1f %10.1f\n", names[f],
+            writer.getFrameSize(), rate, rate / legacy);
+    }
+    close(fd);
+    delete Universe::instance();
+}
+
+/**
+ *  Times loading a 1M-body disk from a script: once as written by
+ *  saveFile(), with 17-digit numbers that need the long double path, and
+ *  once with 7-digit numbers, which fit a double. The istream row only
+ *  reads the saved script's tokens with operator>>, for scale.
+ */
+void benchLoader() {
+    const size_t n = 1000000;
+    Universe* u = createDisk(n);
+    char exact[] = "/tmp/universe-benchXXXXXX";
+    char short7[] = "/tmp/universe-benchXXXXXX";
+    close(mkstemp(exact));
+    close(mkstemp(short7));
+    Parser().saveFile(exact);
+    FILE* file = std::fopen(short7, "w");
+    const BodyStore &b = u->getBodies();
+    std::fprintf(file, "immobile sun %.7g 0 0\n", b.mass[0]);
+    for (size_t i = 1; i < b.size(); ++i) {
+        std::fprintf(file, "simple body %.7g %.7g %.7g %.7g %.7g\n",
+            b.mass[i], b.x[i], b.y[i], b.vx[i], b.vy[i]);
+    }
+    std::fclose(file);
+    delete Universe::instance();
+
+    std::printf("%-10s %10s %10s %12s %10s\n", "script", "MB", "seconds",
+        "bodies/s", "MB/s");
+    const char* names[] = {"17-digit", "7-digit"};
+    const char* files[] = {exact, short7};
+    for (int f = 0; f < 2; ++f) {
+        std::ifstream in(files[f], std::ios::binary | std::ios::ate);
+        double mb = in.tellg() / 1e6;
+        double start = now();
+        Parser().loadFile(files[f]);
+        double seconds = now() - start;
+        size_t loaded = Universe::instance()->getBodies().size();
+        std::printf("%-10s %10.1f %10.3f %12.3g %10.1f\n", names[f], mb,
+            seconds, loaded / seconds, mb / seconds);
+        delete Universe::instance();
+    }
+
+    std::ifstream in(exact);
+    double start = now(), value;
+    std::string kind, name;
+    while (in >> kind >> name) {
+        for (int i = kind == "immobile" ? 3 : 5; i > 0; --i) {
+            in >> value;
+        }
+    }
+    double seconds = now() - start;
+    std::printf("%-10s %10s %10.3f %12.3g %10s\n", "istream", "-", seconds,
+        n / seconds, "-");
+    std::remove(exact);
+    std::remove(short7);
+}
+
+/**
+ *  Times checkpointing a 1M-body disk: how long saveCheckpoint() holds up
+ *  the caller, how long the background write takes to reach the disk and
+ *  how long loading the file back takes.
+ */
+void benchCheckpoint() {
+    Universe* u = createDisk(1000000);
+    char file[] = "/tmp/universe-benchXXXXXX";
+    close(mkstemp(file));
+    std::printf("%10s %10s %12s %12s %10s\n", "bodies", "MB", "stall ms",
+        "on disk ms", "load ms");
+    for (int i = 0; i < 3; ++i) {
+        double start = now();
+        u->saveCheckpoint(file);
+        double stall = now() - start;
+        u->waitForCheckpoint();
+        double written = now() - start;
+        std::ifstream in(file, std::ios::binary | std::ios::ate);
+        double mb = in.tellg() / 1e6;
+        start = now();
+        u->loadCheckpoint(file);
+        double load = now() - start;
+        std::printf("%10zu %10.1f %12.1f %12.1f %10.1f\n",
+            u->getBodies().size(), mb, stall * 1e3, written * 1e3,
+            load * 1e3);
+    }
+    std::remove(file);
+    delete Universe::instance();
+}
+
+/**
+ *  Compares the all-pairs force phase with the symmetric pair pass, which
+ *  evaluates each pair once. The error column is the maximum of
+ *  |F_sym - F| / |F| over the mobile bodies.
+ */
+void benchPairs() {
+    std::printf("%-8s %14s %14s %10s %10s\n", "bodies", "all-pairs ms",
+        "symmetric ms", "speedup", "max err");
+    const size_t sizes[] = {1000, 4000, 16000};
+    for (size_t s = 0; s < 3; ++s) {
+        size_t n = sizes[s];
+        Universe* u = createDisk(n);
+        std::vector<vector2> exact, paired;
+        u->setForceStrategy(new AllPairsStrategy());
+        double direct = timeForcePhase(u, n, exact);
+        u->setForceStrategy(new SymmetricPairsStrategy());
+        double symmetric = timeForcePhase(u, n, paired);
+        double worst = 0;
+        for (size_t i = 1; i < n; ++i) {
+            worst = std::max(worst,
+                (paired[i] - exact[i]).norm() / exact[i].norm());
+        }
+        std::printf("%-8zu %14.2f %14.2f %10.2f %10.2e\n", n, direct * 1e3,
+            symmetric * 1e3, direct / symmetric, worst);
+    }
+    delete Universe::instance();
+}
+
+struct Benchmark {
+    const char* name;
+    void (*run)();
+};
+
+/**
+ *  Finds where the fast multipole force phase overtakes all-pairs, from 1k
+ *  to 1M bodies at orders 4, 8 and 12. All-pairs is timed on a sample of
+ *  1000 targets and scaled. The error column is the maximum over the
+ *  sampled mobile bodies of |F_fmm - F| relative to the largest |F|, since
+ *  bodies whose pulls nearly cancel make |F_fmm - F| / |F| meaningless.
+ */
+void benchFmm() {
+    std::printf("%-8s %-6s %14s %14s %10s %10s\n", "bodies", "order",
+        "all-pairs ms", "fmm ms", "speedup", "max err");
+    const size_t sizes[] = {1000, 4000, 16000, 64000, 256000, 1000000};
+    const int orders[] = {4, 8, 12};
+    size_t crossover[] = {0, 0, 0};
+    for (size_t s = 0; s < 6; ++s) {
+        size_t n = sizes[s];
+        size_t sample = std::min<size_t>(n, 1000);
+        size_t stride = std::max<size_t>(1, n / sample);
+        Universe* u = createDisk(n);
+        std::vector<vector2> exact;
+        u->setForceStrategy(new AllPairsStrategy());
+        double direct = timeForcePhase(u, sample, exact);
+        double largest = 0;
+        for (size_t i = 1; i < exact.size(); ++i) {
+            largest = std::max(largest, exact[i].norm());
+        }
+
+        for (size_t o = 0; o < 3; ++o) {
+            u->setForceStrategy(new FastMultipoleStrategy(orders[o]));
+            std::vector<vector2> all;
+            double fmm = timeForcePhase(u, n, all);
+            double worst = 0;
+            for (size_t i = 1; i < exact.size(); ++i) {
+                worst = std::max(worst, (all[i * stride] - exact[i]).norm());
+            }
+            if (crossover[o] == 0 && fmm < direct) {
+                crossover[o] = n;
+            }
+            std::printf("%-8zu %-6d %14.2f %14.2f %10.2f %10.2e\n", n,
+                orders[o], direct * 1e3, fmm * 1e3, direct / fmm,
+                worst / largest);
+        }
+    }
+    for (size_t o = 0; o < 3; ++o) {
+        if (crossover[o] != 0) {
+            std::printf("order %d beats all-pairs from %zu bodies\n",
+                orders[o], crossover[o]);
+        } else {
+            std::printf("order %d never beats all-pairs\n", orders[o]);
+        }
+    }
+    delete Universe::instance();
+}
+
+/**
+ *  Compares the all-pairs force phase with FarFieldStrategy at thetas of
+ *  0.1, 0.2 and 0.4, for a sun and 250 to 16000 realistic clusters of
+ *  eight bodies on circular orbits, the members of each within 1e9 m of
+ *  its center. Each member's force is queried, as RealisticStrategy does,
+ *  on a sample of at most 2000 members for all-pairs. The error column is
+ *  the maximum of |F_ff - F| / |F| over the sampled members; the sun's
+ *  pull dominates F, so it is small even where the clusters' share of the
+ *  force is off by more.
+ */
+void benchClusters() {
+    std::printf("%-8s %-8s %-6s %14s %14s %10s %10s\n", "clusters",
+        "bodies", "theta", "all-pairs ms", "far-field ms", "speedup",
+        "max err");
+    const size_t counts[] = {250, 1000, 4000, 16000};
+    const double thetas[] = {0.1, 0.2, 0.4};
+    for (size_t c = 0; c < 4; ++c) {
+        delete Universe::instance();
+        Universe* u(Universe::instance());
+        u->addObject(new ImmobileObject("sun", SUN_MASS, vector2()));
+        std::mt19937 rng(c);
+        std::uniform_real_distribution<double> radius(0.5 * AU, 1.5 * AU);
+        std::uniform_real_distribution<double> angle(0, 2 * M_PI);
+        std::uniform_real_distribution<double> offset(-1e9, 1e9);
+        std::uniform_real_distribution<double> mass(1e22, 1e24);
+        for (size_t i = 0; i < counts[c]; ++i) {
+            double r = radius(rng);
+            double a = angle(rng);
+            double v = std::sqrt(Universe::G * SUN_MASS / r);
+            std::vector<Object*> members;
+            for (int j = 0; j < 8; ++j) {
+                members.push_back(new SimpleObject("member", mass(rng),
+                    makeVector2(r * std::cos(a) + offset(rng),
+                                r * std::sin(a) + offset(rng)),
+                    makeVector2(-v * std::sin(a), v * std::cos(a))));
+            }
+            Object* cluster = new AggregateObject("cluster", members);
+            cluster->setAggregateStrategy(new RealisticStrategy());
+            u->addObject(cluster);
+        }
+
+        // Times a force phase of the strategy over every stride-th member
+        // and scales it to all of them.
+        const BodyStore& bodies = u->getBodies();
+        size_t n = bodies.size();
+        auto phase = [&](ForceStrategy& strategy, size_t stride,
+                         std::vector<vector2>& forces) {
+            double start = now();
+            strategy.prepare(bodies);
+            size_t evaluated = 0;
+            for (size_t i = 1; i < n; i += stride, ++evaluated) {
+                forces.push_back(strategy.getForce(bodies.getPosition(i),
+                    bodies.mass[i], i, i + 1));
+            }
+            return (now() - start) * (n - 1) / evaluated;
+        };
+        size_t stride = std::max<size_t>(1, (n - 1) / 2000);
+        AllPairsStrategy exact;
+        std::vector<vector2> exactForces;
+        double direct = phase(exact, stride, exactForces);
+
+        for (size_t t = 0; t < 3; ++t) {
+            FarFieldStrategy* far = new FarFieldStrategy(thetas[t]);
+            u->setForceStrategy(far);
+            std::vector<vector2> forces;
+            double time = phase(*far, 1, forces);
+            double worst = 0;
+            for (size_t k = 0; k < exactForces.size(); ++k) {
+                vector2 f = exactForces[k];
+                worst = std::max(worst,
+                    (forces[k * stride] - f).norm() / f.norm());
+            }
+            std::printf("%-8zu %-8zu %-6.2f %14.2f %14.2f %10.2f %10.2e\n",
+                counts[c], n, thetas[t], direct * 1e3, time * 1e3,
+                direct / time, worst);
+        }
+    }
+    delete Universe::instance();
+}
+
+/**
+ *  Compares objects allocated from the ObjectPool with the global
+ *  allocator on the allocation-heavy paths: the snapshot and swap of the
+ *  cloning step alone on a 100k-body disk, whole cloning steps with
+ *  Barnes-Hut forces on a 10k-body disk, and loading a 1M-body script.
+ */
+void benchPool() {
+    char file[] = "/tmp/universe-benchXXXXXX";
+    close(mkstemp(file));
+    createDisk(1000000);
+    Parser().saveFile(file);
+    delete Universe::instance();
+
+    std::printf("%-10s %10s %10s %12s %10s\n", "phase", "bodies",
+        "global ms", "pool ms", "speedup");
+    const char* phases[] = {"snapshot", "step", "load"};
+    const size_t sizes[] = {100000, 10000, 1000000};
+    for (int p = 0; p < 3; ++p) {
+        double times[2];
+        for (int pooled = 0; pooled < 2; ++pooled) {
+            ObjectPool::instance().setEnabled(pooled == 1);
+            if (p == 2) {
+                double start = now();
+                Parser().loadFile(file);
+                times[pooled] = now() - start;
+                delete Universe::instance();
+                continue;
+            }
+            Universe* u = createDisk(sizes[p]);
+            u->setForceStrategy(new BarnesHutStrategy());
+            const int steps = 20;
+            double start = now();
+            for (int i = 0; i < steps; ++i) {
+                if (p == 0) {
+                    std::vector<Object*> snapshot = u->getSnapshot();
+                    u->swap(snapshot);
+                } else {
+                    u->stepSimulation(3600);
+                }
+            }
+            times[pooled] = (now() - start) / steps;
+            delete Universe::instance();
+        }
+        std::printf("%-10s %10zu %10.2f %12.2f %10.2f\n", phases[p],
+            sizes[p], times[0] * 1e3, times[1] * 1e3, times[0] / times[1]);
+    }
+    std::remove(file);
+}
+
+/**
+ *  Sum computed the way Vector's operator+ did before expression
+ *  templates: the argument by value, a temporary and a transform.
+ */
+vector2 eagerAdd(const vector2 &lhs, const vector2 rhs) {
+    vector2 tmp(lhs);
+    std::transform(&lhs[0], &lhs[0] + 2, &rhs[0], &tmp[0], add_x());
+    return tmp;
+}
+
+/**
+ *  Product computed the way Vector's operator* did before expression
+ *  templates.
+ */
+vector2 eagerScale(const vector2 &vec, double scalar) {
+    vector2 tmp(vec);
+    std::for_each(&tmp[0], &tmp[0] + 2, multiply_x(scalar));
+    return tmp;
+}
+
+/**
+ *  Times the integrators' per-body update expressions on 4096 bodies,
+ *  few enough to stay in cache, evaluated eagerly with a temporary per
+ *  operator as before and through the expression templates, and checks
+ *  both give the same bits.
+ */
+void benchExpressions() {
+    const size_t n = 4096;
+    const int rounds = 5000;
+    const double dt = 3600;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> value(-1, 1);
+    std::vector<vector2> pos(n), vel(n), acc(n);
+    std::vector<double> mass(n);
+    for (size_t i = 0; i < n; ++i) {
+        pos[i] = makeVector2(value(rng) * AU, value(rng) * AU);
+        vel[i] = makeVector2(value(rng) * 3e4, value(rng) * 3e4);
+        acc[i] = makeVector2(value(rng) * 1e20, value(rng) * 1e20);
+        mass[i] = 1e24 * (2 + value(rng));
+    }
+
+    std::printf("%-10s %14s %14s %10s %6s\n", "update", "eager ns/body",
+        "fused ns/body", "speedup", "same");
+    const char* names[] = {"drift", "kick", "verlet"};
+    for (int e = 0; e < 3; ++e) {
+        std::vector<vector2> eager(n), fused(n);
+        double times[2];
+        for (int fuse = 0; fuse < 2; ++fuse) {
+            std::vector<vector2> &out = fuse ? fused : eager;
+            double start = now();
+            for (int r = 0; r < rounds; ++r) {
+                double h = dt + r;
+                for (size_t i = 0; i < n; ++i) {
+                    const vector2 &p = pos[i], &v = vel[i], &a = acc[i];
+                    if (fuse && e == 0) {
+                        out[i] = p + v * h;
+                    } else if (e == 0) {
+                        out[i] = eagerAdd(p, eagerScale(v, h));
+                    } else if (fuse && e == 1) {
+                        out[i] = v + a * (h / mass[i]);
+                    } else if (e == 1) {
+                        out[i] = eagerAdd(v, eagerScale(a, h / mass[i]));
+                    } else if (fuse) {
+                        out[i] = p + v * h + a * (0.5 * h * h);
+                    } else {
+                        out[i] = eagerAdd(eagerAdd(p, eagerScale(v, h)),
+                            eagerScale(a, 0.5 * h * h));
+                    }
+                }
+            }
+            times[fuse] = (now() - start) / rounds / n;
+        }
+        std::printf("%-10s %14.2f %14.2f %10.2f %6s\n", names[e],
+            times[0] * 1e9, times[1] * 1e9, times[0] / times[1],
+            eager == fused ? "yes" : "no");
+    }
+}
+
+/**
+ *  Compares the cost per pair of bodies of the direct-sum double-buffered
+ *  step of a bare store in 2D and in 3D, on a disk and on the disk
+ *  thickened into a slab, through the scalar kernel, with the Universe's
+ *  step on the same disk for reference. Then times the 2D store through
+ *  the widest kernel, which only the 2D instantiation has.
+ */
+void benchDimensions() {
+    std::printf("%-8s %14s %14s %10s %14s %14s\n", "bodies", "2d ns/pair",
+        "3d ns/pair", "3d / 2d", "universe ns", "2d simd ns");
+    const size_t sizes[] = {1000, 4000};
+    GravityKernel::Isa isa = GravityKernel::getIsa();
+    for (size_t s = 0; s < 2; ++s) {
+        size_t n = sizes[s];
+        Universe* u = createDisk(n);
+        u->setDoubleBuffered(true);
+        u->setThreadCount(1);
+        BodyStore flat = u->getBodies(), next;
+        BasicBodyStore<3> slab, slabNext;
+        std::mt19937 rng(2);
+        std::uniform_real_distribution<double> height(-0.1 * AU, 0.1 * AU);
+        for (size_t i = 0; i < n; ++i) {
+            double pos[] = {flat.x[i], flat.y[i], height(rng)};
+            double vel[] = {flat.vx[i], flat.vy[i], 0};
+            slab.set(i, Vector<3>(pos), Vector<3>(vel), flat.mass[i]);
+        }
+        double pairs = double(n) * (n - 1), times[4];
+        for (int k = 0; k < 4; ++k) {
+            GravityKernel::setIsa(k == 3 ? isa : GravityKernel::SCALAR);
+            double start = now();
+            for (int step = 0; step < 3; ++step) {
+                if (k == 0 || k == 3) {
+                    flat.step(3600, next);
+                } else if (k == 1) {
+                    slab.step(3600, slabNext);
+                } else {
+                    u->stepSimulation(3600);
+                }
+            }
+            times[k] = (now() - start) / 3 / pairs;
+        }
+        std::printf("%-8zu %14.2f %14.2f %10.2f %14.2f %14.2f\n", n,
+            times[0] * 1e9, times[1] * 1e9, times[1] / times[0],
+            times[2] * 1e9, times[3] * 1e9);
+    }
+    GravityKernel::setIsa(isa);
+    delete Universe::instance();
+}
+
+/**
+ *  Compares the per-kind loops of the double-buffered step with the
+ *  visitors they replace, on one thread: drifting a 100k-body disk, where
+ *  the dispatch is the whole cost, and kicking it with Barnes-Hut forces.
+ */
+void benchDispatch() {
+    Universe* u = createDisk(100000);
+    u->setThreadCount(1);
+    u->setForceStrategy(new BarnesHutStrategy());
+    std::vector<size_t> all(u->end() - u->begin());
+    for (size_t i = 0; i < all.size(); ++i) {
+        all[i] = i;
+    }
+    std::printf("%-8s %14s %14s %10s\n", "phase", "visitor ms", "sorted ms",
+        "speedup");
+    const char* phases[] = {"drift", "kick"};
+    for (int p = 0; p < 2; ++p) {
+        const int rounds = p == 0 ? 200 : 5;
+        double times[2];
+        for (int sorted = 0; sorted < 2; ++sorted) {
+            double start = now();
+            for (int r = 0; r < rounds; ++r) {
+                if (p == 0 && sorted) {
+                    u->drift(1);
+                } else if (p == 0) {
+                    DriftVisitor drifter(1);
+                    u->visitObjects(drifter, all);
+                } else if (sorted) {
+                    u->kick(1);
+                } else {
+                    u->getForceStrategy()->prepare(u->getBodies());
+                    KickVisitor kicker(1);
+                    u->visitObjects(kicker, all);
+                }
+            }
+            times[sorted] = (now() - start) / rounds;
+        }
+        std::printf("%-8s %14.3f %14.3f %10.2f\n", phases[p], times[0] * 1e3,
+            times[1] * 1e3, times[0] / times[1]);
+    }
+    delete Universe::instance();
+}
+
+/**
+ *  Fills a fresh Universe with n bodies of 1e22 kg at rest, spread
+ *  uniformly over a disc of 1e9 m, which collapses within a few dozen
+ *  hour-long steps.
+ */
+Universe* createCloud(size_t n) {
+    delete Universe::instance();
+    Universe* u(Universe::instance());
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::uniform_real_distribution<double> angle(0, 2 * M_PI);
+    for (size_t i = 0; i < n; ++i) {
+        double r = 1e9 * std::sqrt(unit(rng));
+        double a = angle(rng);
+        u->addObject(new SimpleObject("rock", 1e22,
+            makeVector2(r * std::cos(a), r * std::sin(a)), vector2()));
+    }
+    return u;
+}
+
+/**
+ *  Times the collision phase against the step it follows while a 100k
+ *  body cloud collapses and merges under Barnes-Hut forces, then compares
+ *  the spatial hash with checking every pair on smaller clouds.
+ */
+void benchCollisions() {
+    const double density = 5000;
+    Universe* u = createCloud(100000);
+    u->setForceStrategy(new BarnesHutStrategy());
+    u->setDoubleBuffered(true);
+    std::printf("%-6s %10s %12s %14s %10s\n", "step", "bodies", "step ms",
+        "collision ms", "share");
+    for (int step = 1; step <= 40; ++step) {
+        double start = now();
+        u->stepSimulation(3600);
+        double stepped = now();
+        u->setCollisionDensity(density);
+        u->mergeCollisions();
+        u->setCollisionDensity(0);
+        double merged = now();
+        if (step % 5 == 0) {
+            std::printf("%-6d %10zu %12.2f %14.2f %9.1f%%\n", step,
+                size_t(u->end() - u->begin()), (stepped - start) * 1e3,
+                (merged - stepped) * 1e3,
+                100 * (merged - stepped) / (merged - start));
+        }
+    }
+
+    std::printf("\n%-8s %10s %12s %12s %10s\n", "bodies", "pairs",
+        "hash ms", "brute ms", "speedup");
+    const size_t sizes[] = {5000, 20000};
+    for (size_t s = 0; s < 2; ++s) {
+        u = createCloud(sizes[s]);
+        const BodyStore &b = u->getBodies();
+        std::vector<double> radius(b.size());
+        for (size_t i = 0; i < b.size(); ++i) {
+            radius[i] = std::cbrt(3 * b.mass[i] / (4 * M_PI * density));
+        }
+        std::vector<std::pair<size_t, size_t> > pairs;
+        SpatialHash hash;
+        double start = now();
+        for (int r = 0; r < 10; ++r) {
+            hash.findOverlaps(b, radius, pairs);
+        }
+        double hashed = (now() - start) / 10;
+        start = now();
+        size_t found = 0;
+        for (size_t i = 0; i < b.size(); ++i) {
+            for (size_t j = i + 1; j < b.size(); ++j) {
+                double dx = b.x[j] - b.x[i], dy = b.y[j] - b.y[i];
+                double reach = radius[i] + radius[j];
+                found += dx * dx + dy * dy < reach * reach;
+            }
+        }
+        double brute = now() - start;
+        if (found != pairs.size()) {
+            std::fprintf(stderr, "hash found %zu pairs, expected %zu\n",
+                pairs.size(), found);
+        }
+        std::printf("%-8zu %10zu %12.3f %12.3f %10.1f\n", sizes[s],
+            pairs.size(), hashed * 1e3, brute * 1e3, brute / hashed);
+    }
+    delete Universe::instance();
+}
+
+/**
+ *  Runs 300 Barnes-Hut steps of a 5k-body disk with a drawer that takes
+ *  twice as long per frame as a step: inline, the way the drawing driver
+ *  used to, and with the physics on its own thread behind a FrameRing
+ *  under each policy. Reports the physics rate, what reached the drawer
+ *  and the depth of the ring.
+ */
+void benchRing() {
+    const int steps = 300;
+    Universe* u = createDisk(5000);
+    u->setForceStrategy(new BarnesHutStrategy());
+    u->setDoubleBuffered(true);
+    double start = now();
+    for (int i = 0; i < 10; ++i) {
+        u->stepSimulation(3600);
+    }
+    const std::chrono::duration<double> lag(2 * (now() - start) / 10);
+
+    int fd = open("/dev/null", O_WRONLY);
+    std::printf("%-9s %10s %8s %8s %10s %8s %8s\n", "mode", "steps/s",
+        "drawn", "dropped", "decimated", "depth", "max");
+    FrameWriter direct(fd, FrameWriter::OPCODES);
+    FrameVisitor drawer(direct);
+    start = now();
+    for (int i = 0; i < steps; ++i) {
+        u->stepSimulation(3600);
+        for (Universe::iterator o = u->begin(); o != u->end(); ++o) {
+            (*o)->accept(drawer);
+        }
+        direct.endFrame();
+        std::this_thread::sleep_for(lag);
+    }
+    std::printf("%-9s %10.1f %8d %8d %10d %8s %8s\n", "inline",
+        steps / (now() - start), steps, 0, 0, "-", "-");
+
+    const FrameRing::Policy policies[] = {FrameRing::BLOCK,
+        FrameRing::DROP, FrameRing::DECIMATE};
+    const char* names[] = {"block", "drop", "decimate"};
+    for (int p = 0; p < 3; ++p) {
+        FrameRing ring(16, policies[p]);
+        double elapsed = 0;
+        std::thread physics([&]() {
+            double begin = now();
+            const BodyStore &b = u->getBodies();
+            for (int i = 0; i < steps; ++i) {
+                u->stepSimulation(3600);
+                FrameRing::Frame* frame = ring.acquire();
+                if (frame) {
+                    for (size_t k = 0; k < b.size(); ++k) {
+                        FrameRing::Body body = {b.x[k], b.y[k],
+                            k == 0 ? 20 : 10, 0};
+                        frame->bodies.push_back(body);
+                    }
+                    ring.publish();
+                }
+            }
+            elapsed = now() - begin;
+            ring.close();
+        });
+        FrameWriter writer(fd, FrameWriter::OPCODES);
+        for (const FrameRing::Frame* f; (f = ring.front()) != nullptr; ) {
+            for (size_t k = 0; k < f->bodies.size(); ++k) {
+                const FrameRing::Body &body = f->bodies[k];
+                writer.add(FrameVisitor::toScreen(body.x),
+                    FrameVisitor::toScreen(-body.y), body.radius,
+                    body.nameId);
+            }
+            writer.endFrame();
+            ring.pop();
+            std::this_thread::sleep_for(lag);
+        }
+        physics.join();
+        std::printf("%-9s %10.1f %8llu %8llu %10llu %8.1f %8zu\n",
+            names[p], steps / elapsed,
+            (unsigned long long) ring.getPublishedCount(),
+            (unsigned long long) ring.getDroppedCount(),
+            (unsigned long long) ring.getDecimatedCount(),
+            ring.getMeanDepth(), ring.getMaxDepth());
+    }
+    close(fd);
+    delete Universe::instance();
+}
+
+/**
+ *  Writes 100 steps of a 100k-body disk to a trajectory file with the
+ *  automatic chunk size, which is one step here, and with chunks of 16
+ *  and 64 steps, and with one fwrite per body as a baseline, and reports
+ *  the throughput in bodies * steps per second. The bodies are drifted
+ *  between steps rather than simulated, so only the output is timed. Then
+ *  reads 1000 random steps back through the mapping.
+ */
+void benchTrajectory() {
+    const size_t n = 100000;
+    const int steps = 100;
+    Universe* u = createDisk(n);
+    BodyStore bodies = u->getBodies();
+    char name[] = "/tmp/universe-benchXXXXXX";
+    int fd = mkstemp(name);
+    close(fd);
+
+    std::printf("%-10s %14s %10s %10s\n", "writer", "bodies*steps/s",
+        "MB/s", "speedup");
+    double baseline = 0;
+    const size_t chunks[] = {0, 0, 16, 64};
+    for (size_t c = 0; c < 4; ++c) {
+        double start = now();
+        if (c == 0) {
+            FILE* file = std::fopen(name, "wb");
+            for (int s = 0; s < steps; ++s) {
+                for (size_t i = 0; i < n; ++i) {
+                    double row[] = {bodies.x[i], bodies.y[i], bodies.vx[i],
+                        bodies.vy[i]};
+                    std::fwrite(row, sizeof(row), 1, file);
+                }
+                bodies.x[s % n] += 1;
+            }
+            std::fclose(file);
+        } else {
+            TrajectoryWriter writer(name, chunks[c]);
+            for (int s = 0; s < steps; ++s) {
+                writer.append(s, bodies);
+                bodies.x[s % n] += 1;
+            }
+            writer.close();
+        }
+        double rate = n * steps / (now() - start);
+        if (c == 0) {
+            baseline = rate;
+        }
+        char label[32];
+        std::snprintf(label, sizeof(label), c == 0 ? "fwrite"
+            : c == 1 ? "auto" : "chunk %zu", chunks[c]);
+        std::printf("%-10s %14.3g %10.1f %10.2f\n", label, rate,
+            rate * 4 * sizeof(double) / 1e6, rate / baseline);
+    }
+
+    TrajectoryReader reader(name);
+    std::mt19937 rng(4);
+    std::uniform_int_distribution<uint64_t> step(0, steps - 1);
+    double sum = 0, start = now();
+    for (int r = 0; r < 1000; ++r) {
+        const double *x = reader.getColumn(step(rng), TrajectoryReader::X);
+        for (size_t i = 0; i < n; i += 512) {
+            sum += x[i];
+        }
+    }
+    std::printf("\nrandom step: %.2f us (checksum %g)\n",
+        (now() - start) / 1000 * 1e6, sum);
+    std::remove(name);
+    delete Universe::instance();
+}
+
+/**
+ *  Records 40 hour-long Barnes-Hut steps of a 10k-body disk at full
+ *  precision and quantized to two error bounds, and reports the bytes
+ *  per body and step, the best write throughput of three runs and the
+ *  largest position error read back. The steps are simulated first, so
+ *  only the output is timed.
+ */
+void benchCompression() {
+    const int steps = 40;
+    Universe* u = createDisk(10000);
+    u->setForceStrategy(new BarnesHutStrategy());
+    u->setDoubleBuffered(true);
+    std::vector<BodyStore> states;
+    for (int s = 0; s < steps; ++s) {
+        u->stepSimulation(3600);
+        states.push_back(u->getBodies());
+    }
+    size_t n = states[0].size();
+    char name[] = "/tmp/universe-benchXXXXXX";
+    int fd = mkstemp(name);
+    close(fd);
+
+    std::printf("%-10s %14s %10s %10s %14s %12s\n", "encoding", "bytes/body",
+        "ratio", "MB", "bodies*steps/s", "max error m");
+    const double bounds[][2] = {{0, 0}, {1, 1e-6}, {1000, 1e-3}};
+    const char* names[] = {"raw", "1 m", "1 km"};
+    double raw = 0;
+    for (int b = 0; b < 3; ++b) {
+        // The best of three runs, the first of which also warms the cache.
+        double best = 0;
+        for (int r = 0; r < 3; ++r) {
+            double start = now();
+            TrajectoryWriter writer(name);
+            if (bounds[b][0] > 0) {
+                writer.setQuantization(bounds[b][0], bounds[b][1]);
+            }
+            for (int s = 0; s < steps; ++s) {
+                writer.append(s, states[s]);
+            }
+            writer.close();
+            best = r == 0 ? now() - start : std::min(best, now() - start);
+        }
+        double rate = double(n) * steps / best;
+        struct stat info;
+        stat(name, &info);
+        double perBody = double(info.st_size) / (n * steps);
+        if (b == 0) {
+            raw = perBody;
+        }
+        TrajectoryReader reader(name);
+        double error = 0;
+        for (int s = 0; s < steps; ++s) {
+            const double *x = reader.getColumn(s, TrajectoryReader::X);
+            for (size_t i = 0; i < n; ++i) {
+                error = std::max(error, std::fabs(x[i] - states[s].x[i]));
+            }
+        }
+        std::printf("%-10s %14.2f %10.2f %10.1f %14.3g %12.3g\n", names[b],
+            perBody, raw / perBody, info.st_size / 1e6, rate, error);
+    }
+    std::remove(name);
+    delete Universe::instance();
+}
+
+// Where a step's time goes, phase by phase, in the cloning mode with all
+// pairs and in the double-buffered mode with Barnes-Hut. The breakdown
+// needs a build configured with -DUNIVERSE_PROFILE=ON.
+void benchPhases() {
+    if (!Profiler::isEnabled()) {
+        std::printf("built without UNIVERSE_PROFILE; reconfigure with "
+            "-DUNIVERSE_PROFILE=ON for the breakdown\n");
+    }
+    const char* names[] = {"cloning, all pairs, 2000 bodies",
+                           "double-buffered, Barnes-Hut, 20000 bodies"};
+    const size_t sizes[] = {2000, 20000};
+    for (int m = 0; m < 2; ++m) {
+        Universe* u = createDisk(sizes[m]);
+        if (m == 1) {
+            u->setForceStrategy(new BarnesHutStrategy());
+            u->setDoubleBuffered(true);
+        }
+        Profiler::reset();
+        double start = now();
+        for (int i = 0; i < 20; ++i) {
+            u->stepSimulation(3600);
+        }
+        std::printf("%s: %.2f ms/step\n", names[m],
+            (now() - start) / 20 * 1e3);
+        if (Profiler::isEnabled()) {
+            Profiler::report(std::cout);
+            std::cout << std::endl;
+        }
+    }
+    delete Universe::instance();
+}
+
+// The suite: microbenchmarks of the building blocks and whole steps at
+// growing sizes, run in the manner of Google Benchmark. A case sets up
+// its data for one argument, then loops while State::keepRunning()
+// returns true; only the loop is timed, and the runner raises the number
+// of iterations until the loop lasts a minimum time. Results are printed
+// as a table or as JSON, with the names and fields Google Benchmark
+// uses, so that they can be kept and compared across commits.
+
+/**
+ *  Iterations of one run of a case, and what the run measured.
+ */
+class State {
+public:
+
+    State(long arg, uint64_t iterations) : arg_(arg),
+        iterations_(iterations), done_(0), start_(0), cpuStart_(0),
+        elapsed_(0), cpu_(0), items_(0), bytes_(0) {}
+
+    /**
+     *  Returns true while iterations remain, starting the clocks at the
+     *  first call and stopping them at the last.
+     */
+    bool keepRunning() {
+        if (done_ == 0) {
+            cpuStart_ = std::clock();
+            start_ = now();
+        }
+        if (done_ < iterations_) {
+            ++done_;
+            return true;
+        }
+        elapsed_ = now() - start_;
+        cpu_ = double(std::clock() - cpuStart_) / CLOCKS_PER_SEC;
+        return false;
+    }
+
+    long getArg() const { return arg_; }
+    uint64_t getIterations() const { return iterations_; }
+    double getElapsed() const { return elapsed_; }
+    double getCpuTime() const { return cpu_; }
+
+    /**
+     *  Sets the number of items or bytes processed by the whole run.
+     */
+    void setItemsProcessed(double items) { items_ = items; }
+    void setBytesProcessed(double bytes) { bytes_ = bytes; }
+    double getItemsProcessed() const { return items_; }
+    double getBytesProcessed() const { return bytes_; }
+
+private:
+    long arg_;
+    uint64_t iterations_, done_;
+    double start_;
+    std::clock_t cpuStart_;
+    double elapsed_, cpu_, items_, bytes_;
+};
+
+/**
+ *  Keeps the compiler from discarding a result.
+ */
+volatile double sink;
+
+void vector2Axpy(State& state) {
+    size_t n = state.getArg();
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> value(-AU, AU);
+    std::vector<vector2> a(n), b(n), c(n);
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = makeVector2(value(rng), value(rng));
+        b[i] = makeVector2(value(rng), value(rng));
+    }
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < n; ++i) {
+            c[i] = a[i] + b[i] * 0.5;
+        }
+        sink = c[n / 2][0];
+    }
+    state.setItemsProcessed(double(n) * state.getIterations());
+}
+
+void vector2Norm(State& state) {
+    size_t n = state.getArg();
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> value(-AU, AU);
+    std::vector<vector2> a(n);
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = makeVector2(value(rng), value(rng));
+    }
+    while (state.keepRunning()) {
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += a[i].norm();
+        }
+        sink = sum;
+    }
+    state.setItemsProcessed(double(n) * state.getIterations());
+}
+
+void vector2Normalize(State& state) {
+    size_t n = state.getArg();
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> value(-AU, AU);
+    std::vector<vector2> a(n), c(n);
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = makeVector2(value(rng), value(rng));
+    }
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < n; ++i) {
+            c[i] = a[i];
+            c[i].normalize();
+        }
+        sink = c[n / 2][0];
+    }
+    state.setItemsProcessed(double(n) * state.getIterations());
+}
+
+/**
+ *  Times getForce() on the bodies of a disk in turn, after one prepare().
+ */
+void getForce(State& state, ForceStrategy* strategy) {
+    Universe* u = createDisk(state.getArg());
+    u->setForceStrategy(strategy);
+    const BodyStore& bodies = u->getBodies();
+    strategy->prepare(bodies);
+    size_t n = bodies.size(), i = 1;
+    while (state.keepRunning()) {
+        vector2 f = strategy->getForce(bodies.getPosition(i),
+            bodies.mass[i], i, i + 1);
+        sink = f[0];
+        i = i + 1 < n ? i + 1 : 1;
+    }
+    state.setItemsProcessed(state.getIterations());
+}
+
+void getForceAllPairs(State& state) {
+    getForce(state, new AllPairsStrategy());
+}
+
+void getForceBarnesHut(State& state) {
+    getForce(state, new BarnesHutStrategy());
+}
+
+/**
+ *  Times a MoverVisitor moving the bodies of a disk in turn, each visit
+ *  cloning the body and evaluating its force over all pairs.
+ */
+void mover(State& state) {
+    Universe* u = createDisk(state.getArg());
+    u->getForceStrategy()->prepare(u->getBodies());
+    size_t n = u->end() - u->begin(), i = 1;
+    MoverVisitor visitor(3600);
+    while (state.keepRunning()) {
+        (*(u->begin() + i))->accept(visitor);
+        delete visitor.getObject();
+        i = i + 1 < n ? i + 1 : 1;
+    }
+    state.setItemsProcessed(state.getIterations());
+}
+
+/**
+ *  Times the strategy moving an aggregate of as many members as the
+ *  argument, in a disk of 1000 bodies, with forces over all pairs.
+ */
+void aggregateMove(State& state, AggregateStrategy* strategy) {
+    Universe* u = createDisk(1000);
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<double> offset(-1e9, 1e9);
+    double v = std::sqrt(Universe::G * SUN_MASS / AU);
+    std::vector<Object*> members;
+    for (long i = 0; i < state.getArg(); ++i) {
+        members.push_back(new SimpleObject("member", 1e22,
+            makeVector2(AU + offset(rng), offset(rng)), makeVector2(0, v)));
+    }
+    AggregateObject* aggregate = new AggregateObject("cluster", members);
+    aggregate->setAggregateStrategy(strategy);
+    u->addObject(aggregate);
+    u->getForceStrategy()->prepare(u->getBodies());
+    while (state.keepRunning()) {
+        aggregate->getStrategy()->move(60, *aggregate);
+    }
+    sink = aggregate->getPosition()[0];
+    state.setItemsProcessed(double(state.getArg()) * state.getIterations());
+}
+
+void rigidMove(State& state) {
+    aggregateMove(state, new RigidStrategy());
+}
+
+void realisticMove(State& state) {
+    aggregateMove(state, new RealisticStrategy());
+}
+
+/**
+ *  Times cloning every object of a disk with getSnapshot(), and deleting
+ *  the clones.
+ */
+void snapshot(State& state) {
+    Universe* u = createDisk(state.getArg());
+    while (state.keepRunning()) {
+        std::vector<Object*> objects = u->getSnapshot();
+        std::for_each(objects.begin(), objects.end(),
+            std::default_delete<Object>());
+    }
+    state.setItemsProcessed(double(state.getArg()) * state.getIterations());
+}
+
+/**
+ *  Times encoding and writing frames of as many bodies as the argument
+ *  to /dev/null.
+ */
+void frameWriter(State& state, FrameWriter::Format format) {
+    size_t n = state.getArg();
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> coordinate(0, 499);
+    std::vector<int> x(n), y(n);
+    for (size_t i = 0; i < n; ++i) {
+        x[i] = coordinate(rng);
+        y[i] = coordinate(rng);
+    }
+    uint32_t id = ObjectPool::instance().intern("body");
+    int fd = open("/dev/null", O_WRONLY);
+    FrameWriter writer(fd, format);
+    double bytes = 0;
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < n; ++i) {
+            writer.add(x[i], y[i], 10, id);
+        }
+        writer.endFrame();
+        bytes += writer.getFrameSize();
+    }
+    close(fd);
+    state.setItemsProcessed(double(n) * state.getIterations());
+    state.setBytesProcessed(bytes);
+}
+
+void frameWriterOpcodes(State& state) {
+    frameWriter(state, FrameWriter::OPCODES);
+}
+
+void frameWriterFramed(State& state) {
+    frameWriter(state, FrameWriter::FRAMED);
+}
+
+/**
+ *  Times handing frames of as many bodies as the argument through a
+ *  FrameRing, filled and drained on the same thread.
+ */
+void frameRing(State& state) {
+    size_t n = state.getArg();
+    FrameRing ring(8, FrameRing::BLOCK);
+    uint64_t step = 0;
+    while (state.keepRunning()) {
+        FrameRing::Frame* frame = ring.acquire();
+        frame->step = ++step;
+        for (size_t i = 0; i < n; ++i) {
+            FrameRing::Body body = {double(i), double(step), 10, 0};
+            frame->bodies.push_back(body);
+        }
+        ring.publish();
+        sink = ring.front()->bodies.back().x;
+        ring.pop();
+    }
+    state.setItemsProcessed(double(n) * state.getIterations());
+    state.setBytesProcessed(double(n) * sizeof(FrameRing::Body)
+        * state.getIterations());
+}
+
+/**
+ *  Times appending the state of a disk to a trajectory file, at full
+ *  precision or quantized to 1 m and 1 mm/s.
+ */
+void trajectory(State& state, bool quantized) {
+    Universe* u = createDisk(state.getArg());
+    char name[] = "/tmp/universe-benchXXXXXX";
+    close(mkstemp(name));
+    {
+        TrajectoryWriter writer(name);
+        if (quantized) {
+            writer.setQuantization(1, 1e-3);
+        }
+        double time = 0;
+        while (state.keepRunning()) {
+            writer.append(time, u->getBodies());
+            time += 3600;
+        }
+        writer.close();
+    }
+    std::remove(name);
+    state.setItemsProcessed(double(state.getArg()) * state.getIterations());
+    state.setBytesProcessed(4.0 * sizeof(double) * state.getArg()
+        * state.getIterations());
+}
+
+void trajectoryRaw(State& state) {
+    trajectory(state, false);
+}
+
+void trajectoryQuantized(State& state) {
+    trajectory(state, true);
+}
+
+/**
+ *  Times whole double-buffered steps of an hour on a disk of as many
+ *  bodies as the argument.
+ */
+void step(State& state, ForceStrategy* strategy) {
+    Universe* u = createDisk(state.getArg());
+    u->setForceStrategy(strategy);
+    u->setDoubleBuffered(true);
+    while (state.keepRunning()) {
+        u->stepSimulation(3600);
+    }
+    state.setItemsProcessed(double(state.getArg()) * state.getIterations());
+}
+
+void stepAllPairs(State& state) {
+    step(state, new AllPairsStrategy());
+}
+
+void stepBarnesHut(State& state) {
+    step(state, new BarnesHutStrategy());
+}
+
+struct Case {
+    const char* name;
+    void (*run)(State&);
+    std::vector<long> args;
+};
+
+const Case cases[] = {
+    {"vector2/axpy", vector2Axpy, {64, 4096, 262144}},
+    {"vector2/norm", vector2Norm, {64, 4096, 262144}},
+    {"vector2/normalize", vector2Normalize, {64, 4096, 262144}},
+    {"getForce/all-pairs", getForceAllPairs, {100, 1000, 10000}},
+    {"getForce/barnes-hut", getForceBarnesHut, {1000, 10000, 100000}},
+    {"MoverVisitor", mover, {100, 1000, 10000}},
+    {"RigidStrategy/move", rigidMove, {4, 64, 1024}},
+    {"RealisticStrategy/move", realisticMove, {4, 64, 1024}},
+    {"getSnapshot", snapshot, {100, 10000, 100000}},
+    {"FrameWriter/opcodes", frameWriterOpcodes, {100, 10000}},
+    {"FrameWriter/framed", frameWriterFramed, {100, 10000}},
+    {"FrameRing", frameRing, {100, 10000}},
+    {"TrajectoryWriter/raw", trajectoryRaw, {1000, 100000}},
+    {"TrajectoryWriter/quantized", trajectoryQuantized, {1000, 100000}},
+    {"step/all-pairs", stepAllPairs, {100, 1000, 10000}},
+    {"step/barnes-hut", stepBarnesHut,
+        {100, 1000, 10000, 100000, 1000000}},
+};
+
+/**
+ *  Measurements of a case at one argument.
+ */
+struct Result {
+    std::string name;
+    uint64_t iterations;
+    double seconds, cpuSeconds, items, bytes;
+};
+
+/**
+ *  Runs the case at the argument with more and more iterations until
+ *  the loop lasts minTime seconds, and returns the last run's results.
+ */
+Result measure(const Case& c, long arg, double minTime) {
+    uint64_t iterations = 1;
+    for (;;) {
+        State state(arg, iterations);
+        c.run(state);
+        double t = state.getElapsed();
+        if (t >= minTime || iterations >= 1000000000) {
+            Result result = {std::string(c.name) + "/" + std::to_string(arg),
+                iterations, t, state.getCpuTime(),
+                state.getItemsProcessed(), state.getBytesProcessed()};
+            return result;
+        }
+        // Aims 40% past the minimum, growing at most tenfold per run, as
+        // Google Benchmark does.
+        double factor = t <= 0 ? 10 : std::min(10.0, 1.4 * minTime / t);
+        iterations = std::max<uint64_t>(iterations + 1,
+            uint64_t(iterations * factor));
+    }
+}
+
+/**
+ *  Writes the results in Google Benchmark's JSON format.
+ */
+void writeJson(std::ostream& out, const std::vector<Result>& results) {
+    char date[32];
+    std::time_t t = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z",
+        std::localtime(&t));
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"executable\": \"universe-bench\",\n"
+        << "    \"num_cpus\": " << std::thread::hardware_concurrency()
+        << ",\n    \"kernel_isa\": \""
+        << GravityKernel::getName(GravityKernel::getIsa()) << "\",\n"
+        << "    \"profile\": " << (Profiler::isEnabled() ? "true" : "false")
+        << "\n  },\n  \"benchmarks\": [";
+    out.precision(10);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\n"
+            << "      \"name\": \"" << r.name << "\",\n"
+            << "      \"run_type\": \"iteration\",\n"
+            << "      \"iterations\": " << r.iterations << ",\n"
+            << "      \"real_time\": " << r.seconds * 1e9 / r.iterations
+            << ",\n      \"cpu_time\": "
+            << r.cpuSeconds * 1e9 / r.iterations
+            << ",\n      \"time_unit\": \"ns\"";
+        if (r.items > 0) {
+            out << ",\n      \"items_per_second\": " << r.items / r.seconds;
+        }
+        if (r.bytes > 0) {
+            out << ",\n      \"bytes_per_second\": " << r.bytes / r.seconds;
+        }
+        out << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+/**
+ *  Runs the suite's cases whose name matches the filter. Takes Google
+ *  Benchmark's flags: --benchmark_filter=<regex>,
+ *  --benchmark_min_time=<seconds>, --benchmark_format=<console|json>,
+ *  --benchmark_out=<file> for a JSON copy of the results, and
+ *  --benchmark_list_tests to only list the names. Returns the exit code.
+ */
+int runSuite(int argc, const char* argv[]) {
+    std::regex filter(".*");
+    double minTime = 0.5;
+    bool json = false, list = false;
+    std::string out;
+    for (int i = 0; i < argc; ++i) {
+        std::string arg(argv[i]);
+        std::string value = arg.substr(arg.find('=') + 1);
+        if (arg.compare(0, 19, "--benchmark_filter=") == 0) {
+            filter = std::regex(value);
+        } else if (arg.compare(0, 21, "--benchmark_min_time=") == 0) {
+            minTime = std::atof(value.c_str());
+        } else if (arg == "--benchmark_format=json") {
+            json = true;
+        } else if (arg == "--benchmark_format=console") {
+            json = false;
+        } else if (arg.compare(0, 16, "--benchmark_out=") == 0) {
+            out = value;
+        } else if (arg == "--benchmark_list_tests") {
+            list = true;
+        } else {
+            std::fprintf(stderr, "Unknown flag %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (!json && !list) {
+        std::printf("%-36s %14s %14s %12s %12s %12s\n", "Benchmark",
+            "Time ns", "CPU ns", "Iterations", "items/s", "bytes/s");
+    }
+    std::vector<Result> results;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(*cases); ++c) {
+        for (size_t a = 0; a < cases[c].args.size(); ++a) {
+            long arg = cases[c].args[a];
+            std::string name = std::string(cases[c].name) + "/"
+                + std::to_string(arg);
+            if (!std::regex_search(name, filter)) {
+                continue;
+            }
+            if (list) {
+                std::printf("%s\n", name.c_str());
+                continue;
+            }
+            Result r = measure(cases[c], arg, minTime);
+            results.push_back(r);
+            if (!json) {
+                std::printf("%-36s %14.1f %14.1f %12llu %12.4g %12.4g\n",
+                    r.name.c_str(), r.seconds * 1e9 / r.iterations,
+                    r.cpuSeconds * 1e9 / r.iterations,
+                    (unsigned long long) r.iterations, r.items / r.seconds,
+                    r.bytes / r.seconds);
+                std::fflush(stdout);
+            }
+        }
+    }
+    delete Universe::instance();
+    if (json) {
+        writeJson(std::cout, results);
+    }
+    if (!out.empty()) {
+        std::ofstream file(out.c_str());
+        writeJson(file, results);
+        if (!file) {
+            std::fprintf(stderr, "%s: cannot write the results\n",
+                out.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const Benchmark benchmarks[] = {
+    {"barnes-hut", benchBarnesHut},
+    {"threads", benchThreads},
+    {"kernel", benchKernel},
+    {"integrators", benchIntegrators},
+    {"block-timesteps", benchBlockTimesteps},
+    {"drawer", benchDrawer},
+    {"loader", benchLoader},
+    {"checkpoint", benchCheckpoint},
+    {"pairs", benchPairs},
+    {"fmm", benchFmm},
+    {"clusters", benchClusters},
+    {"pool", benchPool},
+    {"expressions", benchExpressions},
+    {"dimensions", benchDimensions},
+    {"dispatch", benchDispatch},
+    {"collisions", benchCollisions},
+    {"ring", benchRing},
+    {"trajectory", benchTrajectory},
+    {"compression", benchCompression},
+    {"phases", benchPhases},
+};
+
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "suite") == 0) {
+        return runSuite(argc - 2, argv + 2);
+    }
+    bool found = false;
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(*benchmarks); ++i) {
+        if (argc == 1 || std::strcmp(argv[1], benchmarks[i].name) == 0) {
+            std::printf("== %s\n", benchmarks[i].name);
+            benchmarks[i].run();
+            found = true;
+        }
+    }
+    if (!found) {
+        std::fprintf(stderr, "Unknown benchmark %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
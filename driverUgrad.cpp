@@ -6,48 +6,78 @@
 #include "Visitor.h"
 #include <cstdlib>
 #include <sstream>
+#include <cmath>
 
 #include "AggregateStrategy.h"
+#include "ForceStrategy.h"
+#include "Integrator.h"
+#include "FrameWriter.h"
+#include "FrameRing.h"
+#include "Parser.h"
+#include "GravityKernel.h"
+#include "SpatialHash.h"
+#include "Trajectory.h"
+#include "Cadence.h"
+#include "Profiler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
-// IPC code. Poorly written to give the grad students a hard time.
-void writeString(std::string str) {
-    const char* s = str.c_str();
-    std::cout.write(s, str.length());
-    std::cout.put(0);
-    std::cout.flush();
+// Counts every allocation made through operator new and every release.
+// The array and sized forms are replaced too, so that every block from
+// malloc() here goes back through free() here.
+size_t allocations = 0, releases = 0;
+
+void* countedNew(size_t size) {
+    ++allocations;
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void countedDelete(void* ptr) noexcept {
+    if (ptr != nullptr)
+        ++releases;
+    std::free(ptr);
 }
 
-void writeOpcode(char op) {
-    std::cout.put(op);
-    std::cout.flush();
+void* operator new(size_t size) {
+    return countedNew(size);
 }
 
-void writeInt(int i) {
-    std::cout.write((char*) &i, 4);
-    std::cout.flush();
+void* operator new[](size_t size) {
+    return countedNew(size);
 }
 
-void writeFlush() {
-    std::cout.put(0);
-    std::cout.flush();
+void operator delete(void* ptr) noexcept {
+    countedDelete(ptr);
 }
 
-void drawCircle(int x, int y, int r) {
-    writeOpcode(1);
-    int d = r / 2;
-    writeInt(x - d);
-    writeInt(y - d);
-    writeInt(2 * r);
-    writeInt(2 * r);
+void operator delete[](void* ptr) noexcept {
+    countedDelete(ptr);
 }
 
-void drawString(std::string str, int x, int y) {
-    writeOpcode(2);
-    writeString(str);
-    writeInt(x);
-    writeInt(y);
+void operator delete(void* ptr, size_t) noexcept {
+    countedDelete(ptr);
 }
 
+void operator delete[](void* ptr, size_t) noexcept {
+    countedDelete(ptr);
+}
+
+// IPC code. The physics thread copies the positions of each step into a
+// FrameRing; the drawing thread converts them to screen coordinates and
+// encodes them into a FrameWriter, which writes each frame to the drawer
+// with a single write.
 double minx, miny, maxx, maxy;
 int sw, sh;
 
@@ -61,21 +91,23 @@ int convertY(double y) {
     return sh * (maxy - y) / range;
 }
 
-class UgradDrawerVisitor : public Visitor {
+// Copies the bodies' positions into a frame of the ring, for the drawing
+// thread to convert and write.
+class SnapshotVisitor : public Visitor {
 public:
 
+    SnapshotVisitor() : frame_(nullptr) {}
+
+    void setFrame(FrameRing::Frame* frame) {
+        frame_ = frame;
+    }
+
     void visit(SimpleObject& object) {
-        drawCircle(convertX(object.getPosition()[0]),
-                   convertY(object.getPosition()[1]), 10);
-        drawString(object.getName(), convertX(object.getPosition()[0]),
-                   convertY(object.getPosition()[1]));
+        add(object, 10);
     }
 
     void visit(ImmobileObject& object) {
-        drawCircle(convertX(object.getPosition()[0]),
-                   convertY(object.getPosition()[1]), 20);
-        drawString(object.getName(), convertX(object.getPosition()[0]),
-                   convertY(object.getPosition()[1]));
+        add(object, 20);
     }
 
     void visit(AggregateObject& object) {
@@ -84,6 +116,15 @@ public:
             (**i).accept(*this);
     }
 
+private:
+
+    void add(Object& object, int radius) {
+        vector2 pos = object.getPosition();
+        FrameRing::Body body = {pos[0], pos[1], radius, object.getNameId()};
+        frame_->bodies.push_back(body);
+    }
+
+    FrameRing::Frame* frame_;
 };
 
 // end IPC code.
@@ -180,9 +221,1190 @@ void visitorTest() {
     }
 }
 
+void barnesHutTest() {
+    Universe* u(Universe::instance());
+    // The sun's net force nearly cancels and it never moves, so only the
+    // mobile objects and the aggregate members are checked.
+    std::vector<Object*> targets;
+    for (Universe::iterator i = u->begin(); i != u->end(); ++i) {
+        if (dynamic_cast<ImmobileObject*>(*i) == nullptr)
+            targets.push_back(*i);
+        AggregateObject* agg = dynamic_cast<AggregateObject*>(*i);
+        if (agg != nullptr)
+            targets.insert(targets.end(), agg->begin(), agg->end());
+    }
+
+    u->getForceStrategy()->prepare(u->getBodies());
+    std::vector<vector2> exact;
+    for (size_t i = 0; i < targets.size(); ++i)
+        exact.push_back(u->getTotalForce(*targets[i]));
+
+    // theta = 0 opens every cell; theta = 0.5 must stay within 1%.
+    const double thetas[] = {0, 0.5};
+    const double bounds[] = {1e-12, 1e-2};
+    for (int t = 0; t < 2; ++t) {
+        u->setForceStrategy(new BarnesHutStrategy(thetas[t]));
+        u->getForceStrategy()->prepare(u->getBodies());
+        for (size_t i = 0; i < targets.size(); ++i) {
+            vector2 f = u->getTotalForce(*targets[i]);
+            if ((f - exact[i]).norm() > bounds[t] * exact[i].norm()) {
+                std::cerr << "Failed Barnes-Hut test.";
+                std::exit(1);
+            }
+        }
+    }
+    u->setForceStrategy(new AllPairsStrategy());
+}
+
+double totalEnergy() {
+    const BodyStore& b = Universe::instance()->getBodies();
+    double energy = 0;
+    for (size_t i = 0; i < b.size(); ++i) {
+        energy += 0.5 * b.mass[i] * (b.vx[i] * b.vx[i] + b.vy[i] * b.vy[i]);
+        for (size_t j = 0; j < i; ++j) {
+            double dist = std::hypot(b.x[i] - b.x[j], b.y[i] - b.y[j]);
+            if (dist > 0)
+                energy -= Universe::G * b.mass[i] * b.mass[j] / dist;
+        }
+    }
+    return energy;
+}
+
+// Returns a snapshot of the universe for restoreScene and, if rigid is
+// set, makes every aggregate rigid. The realistic cluster is four bodies
+// 10 km apart that fall together in a fraction of a second, so only
+// sub-second steps can follow it.
+std::vector<Object*> saveScene(bool rigid) {
+    Universe* u(Universe::instance());
+    std::vector<Object*> saved = u->getSnapshot();
+    if (rigid)
+        for (Universe::iterator i = u->begin(); i != u->end(); ++i)
+            (*i)->setAggregateStrategy(new RigidStrategy());
+    return saved;
+}
+
+// Puts back the snapshot and the default step settings.
+void restoreScene(std::vector<Object*>& saved) {
+    Universe* u(Universe::instance());
+    u->setForceStrategy(new AllPairsStrategy());
+    u->setThreadCount(0);
+    u->setIntegrator(new EulerIntegrator());
+    u->setDoubleBuffered(false);
+    u->swap(saved);
+}
+
+void integratorTest() {
+    Universe* u(Universe::instance());
+    // Each scheme must beat the one it refines by at least a factor of 10
+    // in the worst relative energy error: over 100 daily steps with rigid
+    // aggregates, and over 10 steps of 1 ms as the realistic cluster
+    // starts to fall, which kicks and drifts its members one by one.
+    const double seconds[] = {86400, 1e-3};
+    const int steps[] = {100, 10};
+    for (int scene = 0; scene < 2; ++scene) {
+        std::vector<Object*> saved = saveScene(scene == 0);
+        Integrator* integrators[] = {new EulerIntegrator(),
+            new LeapfrogIntegrator(), new VelocityVerletIntegrator(),
+            new YoshidaIntegrator()};
+        double errors[4];
+        u->setDoubleBuffered(true);
+        for (int t = 0; t < 4; ++t) {
+            u->setIntegrator(integrators[t]);
+            double initial = totalEnergy();
+            errors[t] = 0;
+            for (int i = 0; i < steps[scene]; ++i) {
+                u->stepSimulation(seconds[scene]);
+                errors[t] = std::max(errors[t],
+                    std::abs(totalEnergy() / initial - 1));
+            }
+        }
+        if (errors[1] > errors[0] / 10 || errors[2] > errors[0] / 10
+                || errors[3] > errors[1] / 10) {
+            std::cerr << "Failed integrator test.";
+            std::exit(1);
+        }
+        restoreScene(saved);
+    }
+}
+
+void allocationTest() {
+    Universe* u(Universe::instance());
+    // The step allocates nothing with rigid aggregates at 100 s steps, nor
+    // with the realistic cluster at 0.1 ms steps, with every strategy,
+    // thread count and scheme. At 100 s steps the cluster's members
+    // scatter and keep deepening the tree instead.
+    const double seconds[] = {100, 1e-4};
+    for (int scene = 0; scene < 2; ++scene) {
+        std::vector<Object*> saved = saveScene(scene == 0);
+        u->setDoubleBuffered(true);
+        for (int t = 0; t < 4; ++t) {
+            if (t == 1)
+                u->setForceStrategy(new BarnesHutStrategy());
+            if (t == 2)
+                u->setThreadCount(4);
+            if (t == 3)
+                u->setIntegrator(new YoshidaIntegrator());
+
+            // Warm up so the back buffer and the tree reach their final
+            // size.
+            u->stepSimulation(seconds[scene]);
+            u->stepSimulation(seconds[scene]);
+            size_t before = allocations;
+            for (int i = 0; i < 100; ++i)
+                u->stepSimulation(seconds[scene]);
+            if (allocations != before) {
+                std::cerr << "Failed allocation test.";
+                std::exit(1);
+            }
+        }
+        restoreScene(saved);
+    }
+}
+
+void blockTimestepTest() {
+    Universe* u(Universe::instance());
+    // The realistic cluster falls faster than the deepest level resolves,
+    // so every aggregate is rigid for the hourly steps.
+    std::vector<Object*> saved = saveScene(true);
+    // Adds a binary with a period of about ten minutes to the year-long
+    // orbits, centered 1.5 AU from the sun.
+    const double au = 149597870700.0;
+    double spin = std::sqrt(Universe::G * 1e24 / 2e6);
+    double orbit = std::sqrt(Universe::G * 1.98892e30 / (1.5 * au));
+    u->addObject(makeSimpleObject("b1", 1e24, makeVector2(5e5, 1.5 * au),
+                                  makeVector2(-orbit, spin)));
+    u->addObject(makeSimpleObject("b2", 1e24, makeVector2(-5e5, 1.5 * au),
+                                  makeVector2(-orbit, -spin)));
+
+    BlockTimestepIntegrator* block = new BlockTimestepIntegrator();
+    u->setIntegrator(block);
+    u->setDoubleBuffered(true);
+    double initial = totalEnergy();
+    double error = 0;
+    size_t before = 0;
+    for (int i = 0; i < 10; ++i) {
+        // The first step sizes the integrator's arrays.
+        if (i == 1)
+            before = allocations;
+        u->stepSimulation(3600);
+        error = std::max(error, std::abs(totalEnergy() / initial - 1));
+    }
+    // The earth stays on the coarsest level and the binary goes deep.
+    size_t count = u->end() - u->begin();
+    if (block->getLevel(1) != 0 || block->getLevel(count - 1) < 8
+            || error > 1e-6 || allocations != before) {
+        std::cerr << "Failed block timestep test.";
+        std::exit(1);
+    }
+    restoreScene(saved);
+
+    // With a single level a call evaluates every body once to close its
+    // step, and only the first call evaluates them again to open it. The
+    // realistic cluster's members are evaluated one by one and must keep
+    // the energy of the 1 ms steps.
+    saved = saveScene(false);
+    block = new BlockTimestepIntegrator(0);
+    u->setIntegrator(block);
+    u->setDoubleBuffered(true);
+    size_t bodies = u->getBodies().size();
+    initial = totalEnergy();
+    error = 0;
+    for (int i = 0; i < 10; ++i) {
+        u->stepSimulation(1e-3);
+        error = std::max(error, std::abs(totalEnergy() / initial - 1));
+    }
+    // The cluster is the last object; its top and bottom members fall
+    // toward each other at about 10 km/s by now.
+    size_t first, last;
+    (*(u->end() - 1))->getSlots(first, last);
+    bool fell = u->getBodies().vy[first] < -5000
+        && u->getBodies().vy[first + 2] > 5000;
+    // Barnes-Hut prepared for a single target sums it directly.
+    BarnesHutStrategy tree;
+    AllPairsStrategy pairs;
+    tree.prepareFor(u->getBodies(), 1);
+    pairs.prepare(u->getBodies());
+    vector2 pos = makeVector2(u->getBodies().x[1], u->getBodies().y[1]);
+    if (block->getForceEvaluations() != 11 * bodies || error > 1e-6 || !fell
+            || tree.getForce(pos, 1, 1, 2)[0]
+                != pairs.getForce(pos, 1, 1, 2)[0]) {
+        std::cerr << "Failed block timestep test.";
+        std::exit(1);
+    }
+    restoreScene(saved);
+}
+
+// Writes text to a new temporary file and returns its name.
+std::string writeTemporary(const char* text) {
+    char name[] = "/tmp/universeXXXXXX";
+    int fd = mkstemp(name);
+    if (fd < 0 || write(fd, text, std::strlen(text)) < 0) {
+        std::cerr << "Failed parser test.";
+        std::exit(1);
+    }
+    close(fd);
+    return name;
+}
+
+// Returns true if the slots [first, first + n) of a and b hold the same
+// bits, starting at slot offset in b.
+bool sameBodies(const BodyStore& a, size_t first, const BodyStore& b,
+                size_t offset, size_t n) {
+    const std::vector<double> BodyStore::*fields[] = {&BodyStore::x,
+        &BodyStore::y, &BodyStore::vx, &BodyStore::vy, &BodyStore::mass};
+    for (size_t f = 0; f < 5; ++f)
+        if (std::memcmp(&(a.*fields[f])[first], &(b.*fields[f])[offset],
+                        n * sizeof(double)) != 0)
+            return false;
+    return true;
+}
+
+void parserTest() {
+    Universe* u(Universe::instance());
+    Parser parser;
+    bool ok = true;
+
+    // Saving and loading the universe appends an exact copy of it.
+    std::string saved = writeTemporary("");
+    parser.saveFile(saved.c_str());
+    BodyStore before = u->getBodies();
+    size_t count = u->end() - u->begin();
+    parser.loadFile(saved.c_str());
+    std::stringstream original, copy;
+    PrintVisitor printOriginal(original), printCopy(copy);
+    for (size_t i = 0; i < count; ++i) {
+        (*(u->begin() + i))->accept(printOriginal);
+        (*(u->begin() + count + i))->accept(printCopy);
+    }
+    ok = ok && size_t(u->end() - u->begin()) == 2 * count
+        && original.str() == copy.str()
+        && sameBodies(u->getBodies(), before.size(), before, 0,
+                      before.size());
+    std::remove(saved.c_str());
+
+    // Comments, blank lines, nesting, strategies and number formats.
+    const char* numbers[] = {"1.98892e30", "0", "-1e-3", "5.9742E+24",
+        "-149597870700.0", ".5", "0", "29788.4676", "1e24", "1", "2", "3",
+        "4", "0.000001", "-0", "1.7976931348623157e308",
+        "4.9406564584124654e-324", "123456789012345678901234"};
+    std::string script = writeTemporary(
+        "# a comment\n"
+        "immobile sun 1.98892e30 0 -1e-3\n"
+        "\n"
+        "simple earth 5.9742E+24 -149597870700.0 .5 0 29788.4676\r\n"
+        "aggregate pair realistic\n"
+        "    simple a 1e24 1 2 3 4\n"
+        "    # members may be aggregates\n"
+        "    aggregate inner\n"
+        "        simple b 0.000001 -0 1.7976931348623157e308\t"
+        "4.9406564584124654e-324 123456789012345678901234\n"
+        "    end\n"
+        "end");
+    size_t slots = u->getBodies().size();
+    count = u->end() - u->begin();
+    parser.loadFile(script.c_str());
+    std::stringstream names;
+    PrintVisitor printer(names);
+    for (Universe::iterator i = u->begin() + count; i != u->end(); ++i)
+        (*i)->accept(printer);
+    BodyStore expected;
+    expected.resize(4);
+    size_t fields[][5] = {{1, 2, 18, 18, 0}, {4, 5, 6, 7, 3},
+                          {9, 10, 11, 12, 8}, {14, 15, 16, 17, 13}};
+    for (size_t s = 0; s < 4; ++s) {
+        double v[5];
+        for (size_t f = 0; f < 5; ++f)
+            v[f] = fields[s][f] < 18
+                ? std::strtod(numbers[fields[s][f]], nullptr) : 0;
+        expected.x[s] = v[0];
+        expected.y[s] = v[1];
+        expected.vx[s] = v[2];
+        expected.vy[s] = v[3];
+        expected.mass[s] = v[4];
+    }
+    ok = ok && names.str() == "sunearthpairainner"
+        && sameBodies(u->getBodies(), slots, expected, 0, 4)
+        && dynamic_cast<RealisticStrategy*>(
+               (*(u->end() - 1))->getStrategy()) != nullptr;
+    std::remove(script.c_str());
+
+    // Random numbers convert exactly like strtod, whichever path they take.
+    std::mt19937_64 rng(9);
+    std::uniform_real_distribution<double> exponent(-30, 40);
+    // Mantissas of 19 and 20 digits scaled by large exponents, and a
+    // mantissa long enough to need a heap copy, are included.
+    std::vector<std::string> random = {"1844674407370955162e23",
+        "9999999999999999999e30", "12345678901234567890e40"};
+    char number[128];
+    std::snprintf(number, sizeof(number), "%.80e", 0.1);
+    random.push_back(number);
+    std::string text;
+    for (size_t i = 0; i < random.size(); ++i)
+        text += "simple r " + random[i] + " 0 0 0 0\n";
+    for (size_t i = 0; i < 5000; ++i) {
+        double value = (rng() % 2 ? -1 : 1) * (rng() >> 11)
+            * std::pow(10.0, exponent(rng)) / (1ULL << 53);
+        std::snprintf(number, sizeof(number), "%.*g", int(1 + i % 20),
+            value);
+        random.push_back(number);
+        text += "simple r " + random.back() + " 0 0 0 0\n";
+    }
+    script = writeTemporary(text.c_str());
+    slots = u->getBodies().size();
+    parser.loadFile(script.c_str());
+    for (size_t i = 0; i < random.size(); ++i) {
+        double value = std::strtod(random[i].c_str(), nullptr);
+        ok = ok && std::memcmp(&value, &u->getBodies().mass[slots + i],
+                               sizeof(double)) == 0;
+    }
+    ok = ok && u->getBodies().mass[slots] == 1.8446744073709552e+41
+        && u->getBodies().mass[slots + 3] == 0.1;
+    std::remove(script.c_str());
+
+    // Malformed scripts throw and leave the universe alone.
+    const char* malformed[] = {"simple x 1 2 3 4\n", "simple x 1 2 3 4 5z\n",
+        "simple x 1 2 3 4 5 6\n", "aggregate x\nsimple y 1 2 3 4 5\n",
+        "aggregate x\nend\n", "planet x 1 2 3\n", "immobile x 1e 2 3\n"};
+    count = u->end() - u->begin();
+    for (size_t i = 0; i < 7; ++i) {
+        std::string bad = writeTemporary(malformed[i]);
+        try {
+            parser.loadFile(bad.c_str());
+            ok = false;
+        } catch (const std::runtime_error&) {}
+        std::remove(bad.c_str());
+    }
+    ok = ok && size_t(u->end() - u->begin()) == count;
+
+    if (!ok) {
+        std::cerr << "Failed parser test.";
+        std::exit(1);
+    }
+}
+
+// Steps the universe count times and returns the final state.
+BodyStore run(int count, double step) {
+    Universe* u(Universe::instance());
+    for (int i = 0; i < count; ++i)
+        u->stepSimulation(step);
+    return u->getBodies();
+}
+
+void checkpointTest() {
+    Universe* u(Universe::instance());
+    std::string file = writeTemporary("");
+    bool ok = true;
+
+    // Restarting from a checkpoint retraces the run exactly, in both step
+    // modes, with the write still in flight while the run goes on.
+    for (int buffered = 0; buffered < 2; ++buffered) {
+        u->setDoubleBuffered(buffered);
+        if (buffered)
+            u->setIntegrator(new LeapfrogIntegrator());
+        run(3, 600);
+        size_t count = u->end() - u->begin();
+        double time = u->getTime();
+        u->saveCheckpoint(file);
+        BodyStore first = run(20, 600);
+        u->waitForCheckpoint();
+        u->loadCheckpoint(file);
+        ok = ok && u->getTime() == time
+            && size_t(u->end() - u->begin()) == count;
+        BodyStore second = run(20, 600);
+        ok = ok && first.size() == second.size()
+            && sameBodies(first, 0, second, 0, first.size());
+    }
+    u->setIntegrator(new EulerIntegrator());
+    u->setDoubleBuffered(false);
+
+    // Names, nesting and strategies survive as well.
+    std::stringstream before, after;
+    PrintVisitor printBefore(before), printAfter(after);
+    for (Universe::iterator i = u->begin(); i != u->end(); ++i)
+        (*i)->accept(printBefore);
+    size_t realistic = 0;
+    for (Universe::iterator i = u->begin(); i != u->end(); ++i)
+        realistic += dynamic_cast<RealisticStrategy*>(
+            (*i)->getStrategy()) != nullptr;
+    u->saveCheckpoint(file);
+    u->waitForCheckpoint();
+    u->loadCheckpoint(file);
+    for (Universe::iterator i = u->begin(); i != u->end(); ++i) {
+        (*i)->accept(printAfter);
+        realistic -= dynamic_cast<RealisticStrategy*>(
+            (*i)->getStrategy()) != nullptr;
+    }
+    ok = ok && before.str() == after.str() && realistic == 0;
+
+    // Damaged files are refused and leave the universe alone.
+    std::string damaged = writeTemporary("");
+    const char* contents[] = {"", "UCKP", "not a checkpoint at all, really"};
+    for (size_t i = 0; i < 4; ++i) {
+        if (i < 3) {
+            std::remove(damaged.c_str());
+            damaged = writeTemporary(contents[i]);
+        } else {
+            // Flips a bit in the middle of a valid checkpoint.
+            FILE* f = std::fopen(file.c_str(), "r+b");
+            std::fseek(f, 60, SEEK_SET);
+            int c = std::fgetc(f);
+            std::fseek(f, 60, SEEK_SET);
+            std::fputc(c ^ 1, f);
+            std::fclose(f);
+            std::remove(damaged.c_str());
+            damaged = file;
+        }
+        try {
+            u->loadCheckpoint(damaged);
+            ok = false;
+        } catch (const std::runtime_error&) {}
+    }
+    std::stringstream unchanged;
+    PrintVisitor printUnchanged(unchanged);
+    for (Universe::iterator i = u->begin(); i != u->end(); ++i)
+        (*i)->accept(printUnchanged);
+    ok = ok && unchanged.str() == before.str();
+    std::remove(file.c_str());
+
+    if (!ok) {
+        std::cerr << "Failed checkpoint test.";
+        std::exit(1);
+    }
+}
+
+void symmetricPairsTest() {
+    // A thousand bodies, enough to split the pairs into several parts.
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> coord(-1e11, 1e11);
+    std::uniform_real_distribution<double> mass(1e22, 1e25);
+    BodyStore store;
+    for (size_t i = 0; i < 1000; ++i)
+        store.set(i, makeVector2(coord(rng), coord(rng)), vector2(),
+                  i == 0 ? 1.98892e30 : mass(rng));
+    AllPairsStrategy exact;
+    SymmetricPairsStrategy single(1), pooled(4);
+    exact.prepare(store);
+    single.prepare(store);
+    pooled.prepare(store);
+    bool ok = true;
+    for (size_t i = 0; i < store.size(); ++i) {
+        vector2 pos = store.getPosition(i);
+        vector2 f = exact.getForce(pos, store.mass[i], i, i + 1);
+        vector2 f1 = single.getForce(pos, store.mass[i], i, i + 1);
+        vector2 f4 = pooled.getForce(pos, store.mass[i], i, i + 1);
+        ok = ok && f1 == f4 && (f1 - f).norm() <= 1e-12 * f.norm();
+    }
 
-void test(const double step = 100) {
+    // The sun stays put when the universe steps with the pair sums.
     Universe* u(Universe::instance());
+    vector2 sun = (*u->begin())->getPosition();
+    u->setForceStrategy(new SymmetricPairsStrategy());
+    u->setDoubleBuffered(true);
+    for (int i = 0; i < 10; ++i)
+        u->stepSimulation(100);
+    ok = ok && (*u->begin())->getPosition() == sun;
+    u->setForceStrategy(new AllPairsStrategy());
+    u->setDoubleBuffered(false);
+
+    if (!ok) {
+        std::cerr << "Failed symmetric pairs test.";
+        std::exit(1);
+    }
+}
+
+void fmmTest() {
+    // A sun, a uniform square and a tight cluster, so the leaves are
+    // uneven and one body dominates the expansions of its cells.
+    std::mt19937 rng(12);
+    std::uniform_real_distribution<double> coord(-1e11, 1e11);
+    std::normal_distribution<double> cluster(5e10, 1e9);
+    std::uniform_real_distribution<double> mass(1e22, 1e25);
+    BodyStore store;
+    for (size_t i = 0; i < 4000; ++i) {
+        vector2 pos = i < 3000 ? makeVector2(coord(rng), coord(rng))
+                               : makeVector2(cluster(rng), cluster(rng));
+        store.set(i, pos, vector2(), i == 0 ? 1.98892e30 : mass(rng));
+    }
+    AllPairsStrategy exact;
+    exact.prepare(store);
+    std::vector<vector2> forces;
+    double largest = 0;
+    for (size_t i = 0; i < store.size(); ++i) {
+        vector2 pos = store.getPosition(i);
+        forces.push_back(exact.getForce(pos, store.mass[i], i, i + 1));
+        largest = std::max(largest, forces.back().norm() / store.mass[i]);
+    }
+
+    // The error relative to the largest field falls with the order.
+    const int orders[] = {4, 8, 12};
+    double previous = 1;
+    bool ok = true;
+    for (int o = 0; o < 3; ++o) {
+        FastMultipoleStrategy fmm(orders[o]);
+        fmm.prepare(store);
+        double error = 0;
+        for (size_t i = 0; i < store.size(); ++i) {
+            vector2 pos = store.getPosition(i);
+            vector2 f = fmm.getForce(pos, store.mass[i], i, i + 1);
+            error = std::max(error, (f - forces[i]).norm() / store.mass[i]);
+        }
+        ok = ok && error < previous * largest / 10
+             && (orders[o] != 8 || error < 1e-6 * largest);
+        previous = error / largest;
+    }
+
+    if (!ok) {
+        std::cerr << "Failed fast multipole test.";
+        std::exit(1);
+    }
+}
+
+void aggregateTest() {
+    // The center of mass read from the store matches the members' average
+    // after the aggregates have moved.
+    Universe* u(Universe::instance());
+    u->stepSimulation(100);
+    bool ok = true;
+    for (Universe::iterator i = u->begin(); i != u->end(); ++i) {
+        AggregateObject* agg = dynamic_cast<AggregateObject*>(*i);
+        if (agg == nullptr)
+            continue;
+        vector2 pos, vel;
+        double mass = 0;
+        for (AggregateObject::iterator j = agg->begin(); j != agg->end();
+                ++j) {
+            pos += (*j)->getMass() * (*j)->getPosition();
+            vel += (*j)->getMass() * (*j)->getVelocity();
+            mass += (*j)->getMass();
+        }
+        ok = ok && agg->getMass() == mass && agg->getPosition() == pos / mass
+             && agg->getVelocity() == vel / mass;
+    }
+
+    // A clone owns copies of the members, and deleting either frees all
+    // of its members and its strategy. The first round interns the names
+    // and grows the object pool, so only the second is measured.
+    std::vector<Object*> members;
+    members.reserve(2);
+    for (int round = 0; round < 2; ++round) {
+        size_t live = allocations - releases;
+        size_t pooled = ObjectPool::instance().getLiveCount();
+        members.clear();
+        members.push_back(makeSimpleObject("a", 1, makeVector2(0, 0)));
+        members.push_back(makeSimpleObject("b", 3, makeVector2(4, 0)));
+        AggregateObject* agg = makeAggregateObject("pair", members);
+        agg->setAggregateStrategy(new RealisticStrategy());
+        AggregateObject* copy = agg->clone();
+        copy->setPosition(makeVector2(0, 5));
+        ok = ok && agg->getPosition() == makeVector2(3, 0)
+             && copy->getPosition() == makeVector2(0, 5)
+             && *copy->begin() != *agg->begin()
+             && copy->getStrategy() != agg->getStrategy();
+        delete agg;
+        delete copy;
+        ok = ok && ObjectPool::instance().getLiveCount() == pooled
+             && (round == 0 || allocations - releases == live);
+    }
+
+    if (!ok) {
+        std::cerr << "Failed aggregate test.";
+        std::exit(1);
+    }
+}
+
+void farFieldTest() {
+    // Two hundred realistic clusters of eight bodies, with no sun to
+    // dominate the forces between them.
+    Universe* u(Universe::instance());
+    std::vector<Object*> saved = u->getSnapshot(), clusters;
+    std::mt19937 rng(14);
+    std::uniform_real_distribution<double> coord(-1e12, 1e12);
+    std::uniform_real_distribution<double> offset(-2e10, 2e10);
+    std::uniform_real_distribution<double> mass(1e22, 1e25);
+    for (int c = 0; c < 200; ++c) {
+        vector2 center = makeVector2(coord(rng), coord(rng));
+        std::vector<Object*> members;
+        for (int i = 0; i < 8; ++i) {
+            members.push_back(makeSimpleObject("m", mass(rng),
+                center + makeVector2(offset(rng), offset(rng))));
+        }
+        clusters.push_back(makeAggregateObject("cluster", members));
+        clusters.back()->setAggregateStrategy(new RealisticStrategy());
+    }
+    u->swap(clusters);
+
+    // theta = 0 sums every body; theta = 0.1 stays within 1%.
+    const BodyStore& bodies = u->getBodies();
+    AllPairsStrategy exact;
+    exact.prepare(bodies);
+    const double thetas[] = {0, 0.1};
+    const double bounds[] = {1e-12, 1e-2};
+    bool ok = true;
+    for (int t = 0; t < 2; ++t) {
+        u->setForceStrategy(new FarFieldStrategy(thetas[t]));
+        u->getForceStrategy()->prepare(bodies);
+        for (size_t i = 0; i < bodies.size(); ++i) {
+            vector2 pos = bodies.getPosition(i);
+            vector2 f = exact.getForce(pos, bodies.mass[i], i, i + 1);
+            vector2 g = u->getForceStrategy()->getForce(pos, bodies.mass[i],
+                                                        i, i + 1);
+            ok = ok && (g - f).norm() <= bounds[t] * f.norm();
+        }
+    }
+    // Given the aggregates' slots, a strategy outside the Universe treats
+    // a copy of the store the same way.
+    BodyStore copy = bodies;
+    std::vector<size_t> first, last;
+    for (Universe::iterator i = u->begin(); i != u->end(); ++i) {
+        first.push_back(0);
+        last.push_back(0);
+        (*i)->getSlots(first.back(), last.back());
+    }
+    FarFieldStrategy far(thetas[1]);
+    far.setAggregates(first, last);
+    far.prepare(copy);
+    for (size_t i = 0; i < copy.size(); i += 97) {
+        vector2 pos = copy.getPosition(i);
+        vector2 f = far.getForce(pos, copy.mass[i], i, i + 1);
+        vector2 g = u->getForceStrategy()->getForce(pos, copy.mass[i],
+                                                    i, i + 1);
+        ok = ok && f[0] == g[0] && f[1] == g[1];
+    }
+    u->stepSimulation(100);
+    u->setForceStrategy(new AllPairsStrategy());
+    u->swap(saved);
+
+    if (!ok) {
+        std::cerr << "Failed far field test.";
+        std::exit(1);
+    }
+}
+
+void dimensionTest() {
+    // A sun and three planets stepped by the Universe's double-buffered
+    // step, with the scalar kernel, and by 3D stores holding them in the
+    // z = 0 and in the y = 0 planes agree bit for bit.
+    Universe* u(Universe::instance());
+    std::vector<Object*> saved = u->getSnapshot(), scene;
+    GravityKernel::Isa isa = GravityKernel::getIsa();
+    GravityKernel::setIsa(GravityKernel::SCALAR);
+    const double au = 149597870700.0, sun = 1.98892e30;
+    scene.push_back(makeSimpleObject("sun", sun));
+    for (int i = 1; i <= 3; ++i) {
+        double r = i * au, v = std::sqrt(Universe::G * sun / r);
+        scene.push_back(makeSimpleObject("planet", 1e24 * i,
+            makeVector2(r * std::cos(i), r * std::sin(i)),
+            makeVector2(-v * std::sin(i), v * std::cos(i))));
+    }
+    u->swap(scene);
+    u->setDoubleBuffered(true);
+    const BodyStore& b = u->getBodies();
+    BasicBodyStore<3> flat, upright, next;
+    for (size_t i = 0; i < b.size(); ++i) {
+        double p[] = {b.x[i], b.y[i], 0}, v[] = {b.vx[i], b.vy[i], 0};
+        double q[] = {b.x[i], 0, b.y[i]}, w[] = {b.vx[i], 0, b.vy[i]};
+        flat.set(i, Vector<3>(p), Vector<3>(v), b.mass[i]);
+        upright.set(i, Vector<3>(q), Vector<3>(w), b.mass[i]);
+    }
+    for (int step = 0; step < 10; ++step) {
+        u->stepSimulation(3600);
+        flat.step(3600, next);
+        upright.step(3600, next);
+    }
+    bool ok = true;
+    for (size_t i = 0; i < b.size(); ++i) {
+        ok = ok && flat.x[i] == b.x[i] && flat.y[i] == b.y[i]
+             && flat.z[i] == 0 && flat.vx[i] == b.vx[i]
+             && flat.vy[i] == b.vy[i] && flat.vz[i] == 0
+             && upright.x[i] == b.x[i] && upright.y[i] == 0
+             && upright.z[i] == b.y[i] && upright.vx[i] == b.vx[i]
+             && upright.vy[i] == 0 && upright.vz[i] == b.vy[i];
+    }
+    u->setDoubleBuffered(false);
+    GravityKernel::setIsa(isa);
+    u->swap(saved);
+
+    // A binary orbiting in the plane y = z keeps its y and z columns
+    // equal and its bodies opposite, bit for bit, as it turns.
+    const double r = 1e7, m = 1e24;
+    double v = std::sqrt(Universe::G * m / (4 * r)) / std::sqrt(2.0);
+    BasicBodyStore<3> tilted;
+    for (int i = 0; i < 2; ++i) {
+        double p[] = {i == 0 ? r : -r, 0, 0};
+        double w[] = {0, i == 0 ? v : -v, i == 0 ? v : -v};
+        tilted.set(i, Vector<3>(p), Vector<3>(w), m);
+    }
+    for (int step = 0; step < 1000; ++step)
+        tilted.step(60, next);
+    for (size_t k = 0; k < 3; ++k)
+        ok = ok && tilted.position(k)[0] == -tilted.position(k)[1]
+             && tilted.velocity(k)[0] == -tilted.velocity(k)[1];
+    ok = ok && tilted.y[0] == tilted.z[0] && tilted.vy[0] == tilted.vz[0]
+         && std::abs(tilted.getPosition(0).norm() / r - 1) < 1e-2
+         && tilted.x[0] < r / 2;
+    if (!ok) {
+        std::cerr << "Failed dimension test.";
+        std::exit(1);
+    }
+}
+
+void poolTest() {
+    // The cloning step recycles the blocks of the released objects, so
+    // once the slabs have grown it neither adds slabs nor names.
+    Universe* u(Universe::instance());
+    ObjectPool& pool(ObjectPool::instance());
+    u->stepSimulation(100);
+    size_t slabs = pool.getSlabCount(), names = pool.getNameCount();
+    size_t live = pool.getLiveCount();
+    for (int i = 0; i < 100; ++i)
+        u->stepSimulation(100);
+    bool ok = pool.getSlabCount() == slabs && pool.getNameCount() == names
+              && pool.getLiveCount() == live;
+
+    bool threw = false;
+    try {
+        pool.setEnabled(false);
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    if (!ok || !threw || !pool.isEnabled()) {
+        std::cerr << "Failed pool test.";
+        std::exit(1);
+    }
+}
+
+void framesTest() {
+    // Two FRAMED frames of the registered objects: the first carries each
+    // distinct name once, the second refers to all of them by ID.
+    Universe* u(Universe::instance());
+    char name[] = "/tmp/universeXXXXXX";
+    int fd = mkstemp(name);
+    FrameWriter writer(fd, FrameWriter::FRAMED);
+    for (int f = 0; f < 2; ++f) {
+        for (Universe::iterator i = u->begin(); i != u->end(); ++i)
+            writer.add(0, 0, 10, (*i)->getNameId());
+        writer.endFrame();
+    }
+    std::vector<char> data(lseek(fd, 0, SEEK_END));
+    bool ok = pread(fd, data.data(), data.size(), 0) == ssize_t(data.size());
+    close(fd);
+    std::remove(name);
+
+    std::vector<std::string> names;
+    size_t at = 0;
+    for (int f = 0; f < 2 && ok; ++f) {
+        uint32_t header[4];
+        std::memcpy(header, &data[at], sizeof(header));
+        at += sizeof(header);
+        size_t sent = 0;
+        for (Universe::iterator i = u->begin(); i != u->end(); ++i) {
+            uint32_t record[5];
+            std::memcpy(record, &data[at], sizeof(record));
+            at += sizeof(record);
+            if (record[3] >= names.size())
+                names.resize(record[3] + 1);
+            if (record[4] != 0) {
+                names[record[3]].assign(&data[at], record[4]);
+                at += record[4];
+                ++sent;
+            }
+            ok = ok && record[3] == (*i)->getNameId()
+                 && names[record[3]] == (*i)->getName();
+        }
+        ok = ok && header[0] == 0x4d524655 && header[1] == uint32_t(f)
+             && (f == 0 ? sent > 0 : sent == 0);
+    }
+
+    // A frame larger than a non-blocking pipe's buffer is written whole
+    // once a slow reader drains it.
+    int ends[2];
+    ok = ok && pipe(ends) == 0
+         && fcntl(ends[1], F_SETFL, O_NONBLOCK) == 0;
+    FrameWriter piped(ends[1], FrameWriter::FRAMED);
+    for (int i = 0; i < 20000; ++i)
+        piped.add(i, i, 10, u->begin()[0]->getNameId());
+    size_t received = 0;
+    std::thread reader([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        char chunk[4096];
+        for (ssize_t n; (n = read(ends[0], chunk, sizeof(chunk))) > 0; )
+            received += n;
+    });
+    ok = ok && piped.endFrame();
+    close(ends[1]);
+    reader.join();
+    close(ends[0]);
+    ok = ok && received == piped.getFrameSize() && received > 65536;
+    if (!ok || at != data.size()) {
+        std::cerr << "Failed frames test.";
+        std::exit(1);
+    }
+}
+
+void kindTest() {
+    // The loops grouped by kind kick and drift the bodies exactly as the
+    // visitors do.
+    Universe* u(Universe::instance());
+    std::vector<Object*> saved = u->getSnapshot();
+    u->kick(3600);
+    u->drift(3600);
+    BodyStore sorted = u->getBodies();
+
+    std::vector<Object*> copy;
+    for (size_t i = 0; i < saved.size(); ++i)
+        copy.push_back(saved[i]->clone());
+    u->swap(copy);
+    std::vector<size_t> all;
+    for (size_t i = 0; i < saved.size(); ++i)
+        all.push_back(i);
+    u->getForceStrategy()->prepare(u->getBodies());
+    KickVisitor kicker(3600);
+    u->visitObjects(kicker, all);
+    DriftVisitor drifter(3600);
+    u->visitObjects(drifter, all);
+    const BodyStore &visited = u->getBodies();
+    bool ok = sorted.x == visited.x && sorted.y == visited.y
+              && sorted.vx == visited.vx && sorted.vy == visited.vy;
+    u->swap(saved);
+
+    // Objects of different kinds are never equal.
+    SimpleObject* simple = makeSimpleObject("x", 1);
+    ImmobileObject* immobile = makeImmobileObject("x", 1);
+    ok = ok && *simple != *immobile && *immobile != *simple
+         && simple->getKind() == Object::SIMPLE
+         && immobile->getKind() == Object::IMMOBILE;
+    delete simple;
+    delete immobile;
+    if (!ok) {
+        std::cerr << "Failed kind test.";
+        std::exit(1);
+    }
+}
+
+void collisionTest() {
+    Universe* u(Universe::instance());
+    std::vector<Object*> saved = u->getSnapshot(), scene;
+
+    // The hash finds the same overlapping pairs as checking every pair,
+    // with a few large bodies kept out of the grid.
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> coord(-1000, 1000), size(1, 20);
+    BodyStore bodies;
+    std::vector<double> radius(2000);
+    bodies.resize(radius.size());
+    for (size_t i = 0; i < radius.size(); ++i) {
+        bodies.x[i] = coord(gen);
+        bodies.y[i] = coord(gen);
+        radius[i] = i % 500 == 0 ? 200 : i % 7 == 0 ? 0 : size(gen);
+    }
+    std::vector<std::pair<size_t, size_t> > hashed, brute;
+    SpatialHash hash;
+    hash.findOverlaps(bodies, radius, hashed);
+    for (size_t i = 0; i < radius.size(); ++i) {
+        for (size_t j = i + 1; j < radius.size(); ++j) {
+            double dx = bodies.x[j] - bodies.x[i];
+            double dy = bodies.y[j] - bodies.y[i];
+            double reach = radius[i] + radius[j];
+            if (radius[i] > 0 && radius[j] > 0
+                    && dx * dx + dy * dy < reach * reach)
+                brute.push_back(std::make_pair(i, j));
+        }
+    }
+    bool ok = hashed == brute && !brute.empty();
+
+    // Nothing merges while the phase is disabled.
+    scene.push_back(makeSimpleObject("a", 1e10, makeVector2(0, 0)));
+    scene.push_back(makeSimpleObject("b", 1e10, makeVector2(1, 0)));
+    u->swap(scene);
+    ok = ok && u->mergeCollisions() == 0 && u->getSnapshot().size() == 2;
+
+    // A head-on collision conserves mass and momentum and keeps the name
+    // of the heavier body; a chain of touching bodies merges into one.
+    scene.clear();
+    scene.push_back(makeSimpleObject("light", 1e10, makeVector2(0, 0),
+                                     makeVector2(3, 0)));
+    scene.push_back(makeSimpleObject("heavy", 3e10, makeVector2(1, 0),
+                                     makeVector2(-1, 0)));
+    scene.push_back(makeSimpleObject("c1", 1e10, makeVector2(0, 1e6)));
+    scene.push_back(makeSimpleObject("c2", 1e10, makeVector2(1, 1e6)));
+    scene.push_back(makeSimpleObject("c3", 1e10, makeVector2(2, 1e6)));
+    scene.push_back(makeSimpleObject("far", 1e10, makeVector2(0, -1e6)));
+    u->swap(scene);
+    u->setCollisionDensity(1000);
+    ok = ok && u->mergeCollisions() == 3;
+    std::vector<Object*> merged = u->getSnapshot();
+    ok = ok && merged.size() == 3 && merged[0]->getName() == "heavy"
+         && merged[0]->getMass() == 4e10
+         && std::fabs(merged[0]->getVelocity()[0]) < 1e-12
+         && std::fabs(merged[0]->getPosition()[0] - 0.75) < 1e-12
+         && merged[1]->getName() == "c1" && merged[1]->getMass() == 3e10
+         && std::fabs(merged[1]->getPosition()[0] - 1) < 1e-12
+         && merged[2]->getName() == "far";
+
+    // An immobile body absorbs whatever hits it and stays put.
+    scene.clear();
+    scene.push_back(makeSimpleObject("rock", 1e10, makeVector2(1, 0),
+                                     makeVector2(-5, 0)));
+    scene.push_back(makeImmobileObject("wall", 1e12, makeVector2(0, 0)));
+    u->swap(scene);
+    ok = ok && u->mergeCollisions() == 1;
+    merged = u->getSnapshot();
+    ok = ok && merged.size() == 1 && merged[0]->getName() == "wall"
+         && merged[0]->getKind() == Object::IMMOBILE
+         && merged[0]->getMass() == 1.01e12
+         && merged[0]->getPosition()[0] == 0;
+
+    u->setCollisionDensity(0);
+    u->swap(saved);
+    if (!ok) {
+        std::cerr << "Failed collision test.";
+        std::exit(1);
+    }
+}
+
+void ringTest() {
+    // Every policy delivers frames intact and in order; BLOCK delivers all
+    // of them, and the others account for every frame they skip.
+    const FrameRing::Policy policies[] = {FrameRing::BLOCK, FrameRing::DROP,
+                                          FrameRing::DECIMATE};
+    const uint64_t count = 20000;
+    bool ok = true;
+    for (int p = 0; p < 3; ++p) {
+        FrameRing ring(8, policies[p]);
+        std::thread producer([&]() {
+            for (uint64_t step = 1; step <= count; ++step) {
+                FrameRing::Frame* frame = ring.acquire();
+                if (!frame)
+                    continue;
+                frame->step = step;
+                frame->time = step;
+                for (uint64_t i = 0; i < step % 5; ++i) {
+                    FrameRing::Body body = {double(step), double(i), 0, 0};
+                    frame->bodies.push_back(body);
+                }
+                ring.publish();
+            }
+            ring.close();
+        });
+        uint64_t last = 0, drawn = 0;
+        for (const FrameRing::Frame* f; (f = ring.front()) != nullptr; ) {
+            ok = ok && f->step > last && f->time == f->step
+                 && f->bodies.size() == f->step % 5;
+            for (size_t i = 0; i < f->bodies.size(); ++i)
+                ok = ok && f->bodies[i].x == f->step && f->bodies[i].y == i;
+            last = f->step;
+            ++drawn;
+            // A slow drawer, so that the ring fills.
+            if (drawn % 16 == 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            ring.pop();
+        }
+        producer.join();
+        ok = ok && ring.getOfferedCount() == count
+             && drawn == ring.getPublishedCount()
+             && drawn + ring.getDroppedCount() + ring.getDecimatedCount()
+                == count
+             && ring.getMaxDepth() <= ring.getCapacity()
+             && ring.getDepth() == 0;
+        if (policies[p] == FrameRing::BLOCK)
+            ok = ok && drawn == count;
+        else
+            ok = ok && drawn < count;
+    }
+
+    // A drawer waiting on an empty ring sleeps instead of spinning, and
+    // closing the ring wakes it.
+    FrameRing idle(8, FrameRing::BLOCK);
+    FrameRing::Frame unset;
+    const FrameRing::Frame* waited = &unset;
+    std::clock_t cpu = std::clock();
+    std::thread drawer([&]() { waited = idle.front(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    idle.close();
+    drawer.join();
+    ok = ok && waited == nullptr
+         && std::clock() - cpu < CLOCKS_PER_SEC / 20;
+    if (!ok) {
+        std::cerr << "Failed ring test.";
+        std::exit(1);
+    }
+}
+
+void trajectoryTest() {
+    Universe* u(Universe::instance());
+    std::vector<Object*> saved = u->getSnapshot();
+    std::string file = writeTemporary("");
+    bool ok = true;
+
+    // Every step reads back bit for bit, in any order, across full chunks
+    // and a partial last one.
+    std::vector<BodyStore> states;
+    std::vector<double> times;
+    {
+        TrajectoryWriter writer(file, 8);
+        for (int i = 0; i < 20; ++i) {
+            u->stepSimulation(600);
+            writer.append(*u);
+            states.push_back(u->getBodies());
+            times.push_back(u->getTime());
+        }
+        ok = ok && writer.getStepCount() == 20;
+
+        // An unfinished file is refused.
+        try {
+            TrajectoryReader unfinished(file);
+            ok = false;
+        } catch (const std::runtime_error&) {}
+        writer.close();
+    }
+    struct stat raw, quantized;
+    ok = ok && stat(file.c_str(), &raw) == 0;
+    TrajectoryReader reader(file);
+    ok = ok && reader.getStepCount() == 20
+         && reader.getBodyCount() == states[0].size();
+    BodyStore read;
+    for (size_t i = 20; i-- > 0; ) {
+        reader.read(i, read);
+        ok = ok && sameBodies(read, 0, states[i], 0, read.size())
+             && reader.getTime(i) == times[i]
+             && reader.getColumn(i, TrajectoryReader::VY)[1]
+                == states[i].vy[1];
+    }
+    try {
+        reader.getTime(20);
+        ok = false;
+    } catch (const std::out_of_range&) {}
+
+    // The number of bodies is fixed by the first step.
+    {
+        TrajectoryWriter writer(file);
+        writer.append(0, states[0]);
+        BodyStore fewer = states[0];
+        fewer.resize(fewer.size() - 1);
+        try {
+            writer.append(1, fewer);
+            ok = false;
+        } catch (const std::runtime_error&) {}
+        try {
+            writer.setQuantization(1, 1);
+            ok = false;
+        } catch (const std::logic_error&) {}
+    }
+
+    // Quantized steps stay within the error bounds and take less room.
+    {
+        TrajectoryWriter writer(file, 8);
+        try {
+            writer.setQuantization(0, 1);
+            ok = false;
+        } catch (const std::invalid_argument&) {}
+        writer.setQuantization(1000, 0.001);
+        for (size_t i = 0; i < states.size(); ++i)
+            writer.append(times[i], states[i]);
+    }
+    ok = ok && stat(file.c_str(), &quantized) == 0
+         && quantized.st_size < raw.st_size;
+    TrajectoryReader lossy(file);
+    ok = ok && lossy.isQuantized() && lossy.getStepCount() == 20;
+    for (size_t i = 20; i-- > 0; ) {
+        lossy.read(i, read);
+        for (size_t b = 0; b < read.size(); ++b)
+            ok = ok && std::fabs(read.x[b] - states[i].x[b]) <= 1000
+                 && std::fabs(read.y[b] - states[i].y[b]) <= 1000
+                 && std::fabs(read.vx[b] - states[i].vx[b]) <= 0.001
+                 && std::fabs(read.vy[b] - states[i].vy[b]) <= 0.001
+                 && read.mass[b] == states[i].mass[b];
+        ok = ok && lossy.getTime(i) == times[i];
+    }
+
+    // Every third step is due, and at most one per 250 seconds.
+    Cadence steps(3), seconds(1, 250);
+    std::string due;
+    for (int i = 1; i <= 9; ++i)
+        due += char('0' + steps.due(100 * i) + 2 * seconds.due(100 * i));
+    ok = ok && due == "203021021" && steps.getDueCount() == 3
+         && seconds.getDueCount() == 4 && seconds.getStepCount() == 9;
+    std::remove(file.c_str());
+    u->swap(saved);
+    if (!ok) {
+        std::cerr << "Failed trajectory test.";
+        std::exit(1);
+    }
+}
+
+void profilerTest() {
+    Universe* u(Universe::instance());
+    std::vector<Object*> saved = u->getSnapshot();
+    size_t n = u->getBodies().size();
+    Profiler::reset();
+    for (int i = 0; i < 10; ++i)
+        u->stepSimulation(100);
+    std::ostringstream json;
+    Profiler::writeJson(json);
+
+    // With profiling every step is counted, every body is cloned and
+    // pulled by the others, and the phases of the step are timed; without
+    // it nothing is, and the log still reads the same way.
+    bool ok = json.str().compare(0, 12, "{\"seconds\":{") == 0
+              && json.str().find("\"bytes_written\":0}}\n")
+                 != std::string::npos;
+    if (Profiler::isEnabled()) {
+        ok = ok && Profiler::getCount(Profiler::STEPS) == 10
+             && Profiler::getCount(Profiler::ALLOCATIONS) >= 10 * n
+             && Profiler::getCount(Profiler::PAIRS) > 0
+             && Profiler::getCount(Profiler::PAIRS) <= 10 * n * (n - 1)
+             && Profiler::getNanoseconds(Profiler::STEP) > 0
+             && Profiler::getNanoseconds(Profiler::FORCES) > 0
+             && Profiler::getNanoseconds(Profiler::SNAPSHOT) > 0
+             && Profiler::getNanoseconds(Profiler::SWAP) > 0
+             && Profiler::getNanoseconds(Profiler::RENDER) == 0;
+
+        // The tree strategies count the pairs of their near fields; with
+        // no aggregates set the far field strategy sums every other body.
+        const BodyStore& bodies = u->getBodies();
+        FastMultipoleStrategy fmm;
+        Profiler::reset();
+        fmm.prepare(bodies);
+        ok = ok && Profiler::getCount(Profiler::PAIRS) > 0;
+        FarFieldStrategy far;
+        far.prepare(bodies);
+        Profiler::reset();
+        far.getForce(bodies.getPosition(0), bodies.mass[0], 0, 1);
+        ok = ok && Profiler::getCount(Profiler::PAIRS) == n - 1;
+    } else {
+        for (int c = 0; c < Profiler::COUNTERS; ++c)
+            ok = ok && Profiler::getCount(Profiler::Counter(c)) == 0;
+        for (int p = 0; p < Profiler::PHASES; ++p)
+            ok = ok && Profiler::getNanoseconds(Profiler::Phase(p)) == 0;
+    }
+    u->swap(saved);
+    Profiler::reset();
+    if (!ok) {
+        std::cerr << "Failed profiler test.";
+        std::exit(1);
+    }
+}
+
+// Settings of the drawing run, from the command line.
+struct Options {
+    Options() : format(FrameWriter::OPCODES), policy(FrameRing::BLOCK),
+                every(1), interval(0), positionError(0), velocityError(0) {}
+
+    FrameWriter::Format format;
+    FrameRing::Policy policy;
+    std::string checkpoint, trajectory;
+    // Log of the profiler's counters, one JSON line every 1000 steps.
+    std::string profile;
+    // Output cadence of the frames and the trajectory.
+    uint64_t every;
+    double interval;
+    // Error bounds of the quantized trajectory, 0 for full precision.
+    double positionError, velocityError;
+};
+
+void test(const Options& options, const double step = 100) {
+    Universe* u(Universe::instance());
+    const std::string& checkpoint = options.checkpoint;
 
     maxx = 200000000000.0;
     maxy = maxx;
@@ -193,14 +1415,83 @@ void test(const double step = 100) {
 
     const double year_s = 31554195.932106005998594489072144;
 
-    UgradDrawerVisitor v;
+    // Resumes from the checkpoint if there is one.
+    if (!checkpoint.empty() && access(checkpoint.c_str(), F_OK) == 0)
+        u->loadCheckpoint(checkpoint);
 
-    for (double time = 0; time < year_s; time += step) {
-        u->stepSimulation(step);
-        for (Universe::const_iterator i = u->begin(); i != u->end(); ++i)
-            (**i).accept(v);
-        writeFlush();
+    // The physics runs on its own thread and hands a snapshot of every due
+    // step to this one through the ring, refreshing the checkpoint every
+    // 1000 steps and recording the due steps in the trajectory file if
+    // one was given.
+    std::unique_ptr<TrajectoryWriter> recorder;
+    if (!options.trajectory.empty()) {
+        recorder.reset(new TrajectoryWriter(options.trajectory));
+        if (options.positionError > 0)
+            recorder->setQuantization(options.positionError,
+                                      options.velocityError);
+    }
+    Cadence cadence(options.every, options.interval);
+    FrameRing ring(64, options.policy);
+    std::ofstream profile;
+    if (!options.profile.empty())
+        profile.open(options.profile.c_str());
+    std::thread physics([&]() {
+        SnapshotVisitor v;
+        uint64_t steps = 0;
+        for (double time = u->getTime(); time < year_s && !ring.isClosed();
+                time += step) {
+            u->stepSimulation(step);
+            ++steps;
+            FrameRing::Frame* frame = nullptr;
+            if (cadence.due(u->getTime())) {
+                if (recorder)
+                    recorder->append(*u);
+                frame = ring.acquire();
+            }
+            if (frame) {
+                PROFILE_PHASE(SNAPSHOT);
+                frame->step = steps;
+                frame->time = u->getTime();
+                v.setFrame(frame);
+                for (Universe::const_iterator i = u->begin(); i != u->end();
+                        ++i)
+                    (**i).accept(v);
+                ring.publish();
+            }
+            if (!checkpoint.empty() && steps % 1000 == 0)
+                u->saveCheckpoint(checkpoint);
+            if (profile.is_open() && steps % 1000 == 0)
+                Profiler::writeJson(profile);
+        }
+        ring.close();
+    });
+
+    FrameWriter writer(1, options.format);
+    for (const FrameRing::Frame* frame; (frame = ring.front()) != nullptr; ) {
+        PROFILE_PHASE(RENDER);
+        for (size_t i = 0; i < frame->bodies.size(); ++i) {
+            const FrameRing::Body& body = frame->bodies[i];
+            writer.add(convertX(body.x), convertY(body.y), body.radius,
+                       body.nameId);
+        }
+        ring.pop();
+        if (!writer.endFrame())
+            ring.close();
     }
+    physics.join();
+    if (recorder)
+        recorder->close();
+
+    std::cerr << "frames: " << ring.getOfferedCount() << " offered, "
+              << ring.getPublishedCount() << " drawn, "
+              << ring.getDroppedCount() << " dropped, "
+              << ring.getDecimatedCount() << " decimated; queue depth: "
+              << ring.getMeanDepth() << " mean, " << ring.getMaxDepth()
+              << " max" << std::endl;
+    if (profile.is_open())
+        Profiler::writeJson(profile);
+    if (Profiler::isEnabled())
+        Profiler::report(std::cerr);
 }
 
 int getIntSize() {
@@ -232,9 +1523,52 @@ int main(int argc, const char* argv[]) {
     if (argc == 1) {
         assertPreconditions();
         visitorTest();
+        barnesHutTest();
+        integratorTest();
+        allocationTest();
+        blockTimestepTest();
+        checkpointTest();
+        symmetricPairsTest();
+        fmmTest();
+        aggregateTest();
+        farFieldTest();
+        dimensionTest();
+        poolTest();
+        framesTest();
+        kindTest();
+        collisionTest();
+        ringTest();
+        trajectoryTest();
+        profilerTest();
+        parserTest();
 
-    } else
-        test();
+    } else {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg(argv[i]);
+            if (arg == "--frames")
+                options.format = FrameWriter::FRAMED;
+            else if (arg == "--drop")
+                options.policy = FrameRing::DROP;
+            else if (arg == "--decimate")
+                options.policy = FrameRing::DECIMATE;
+            else if (arg == "--checkpoint" && i + 1 < argc)
+                options.checkpoint = argv[++i];
+            else if (arg == "--trajectory" && i + 1 < argc)
+                options.trajectory = argv[++i];
+            else if (arg == "--profile" && i + 1 < argc)
+                options.profile = argv[++i];
+            else if (arg == "--every" && i + 1 < argc)
+                options.every = std::strtoull(argv[++i], nullptr, 10);
+            else if (arg == "--interval" && i + 1 < argc)
+                options.interval = std::atof(argv[++i]);
+            else if (arg == "--quantize" && i + 2 < argc) {
+                options.positionError = std::atof(argv[++i]);
+                options.velocityError = std::atof(argv[++i]);
+            }
+        }
+        test(options);
+    }
 
     return 0;
 }